@@ -159,6 +159,7 @@ void STKConfig::load(const std::string &filename)
     CHECK_NEG(m_no_explosive_items_timeout,"powerup no-explosive-items-timeout"    );
     CHECK_NEG(m_max_moveable_objects,      "network max-moveable-objects");
     CHECK_NEG(m_network_steering_reduction,"network steering-reduction" );
+    CHECK_NEG(m_network_position_resolution,"network position-resolution");
     CHECK_NEG(m_default_moveable_friction, "physics default-moveable-friction");
     CHECK_NEG(m_solver_iterations,         "physics: solver-iterations"       );
     CHECK_NEG(m_solver_split_impulse_thresh,"physics: solver-split-impulse-threshold");
@@ -214,6 +215,7 @@ void STKConfig::init_defaults()
     m_solver_set_flags           = 0;
     m_solver_reset_flags         = 0;
     m_network_steering_reduction = -100;
+    m_network_position_resolution = -100;
     m_title_music                = NULL;
     m_default_music              = NULL;
     m_solver_split_impulse       = false;
@@ -471,6 +473,8 @@ void STKConfig::getAllData(const XMLNode * root)
     {
         networking_node->get("max-moveable-objects", &m_max_moveable_objects);
         networking_node->get("steering-reduction", &m_network_steering_reduction);
+        networking_node->get("position-resolution",
+            &m_network_position_resolution);
     }
 
     if(const XMLNode *replay_node = root->getNode("replay"))
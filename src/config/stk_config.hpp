@@ -98,6 +98,10 @@ public:
      *  steering adjustments. */
     float m_network_steering_reduction;
 
+    /** Distance between two positions of a kart or other moving object which
+     *  can be sent in bit packed game states. */
+    float m_network_position_resolution;
+
     /** If the angle between a normal on a vertex and the normal of the
      *  triangle are more than this value, the physics will use the normal
      *  of the triangle in smoothing normal. */
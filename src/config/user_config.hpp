@@ -691,6 +691,11 @@ namespace UserConfigParams
         PARAM_DEFAULT(IntUserConfigParam(30, "record_fps",
         &m_recording_group, "Specify the fps of recording video"));
 
+    PARAM_PREFIX BoolUserConfigParam        m_binary_replay
+        PARAM_DEFAULT(BoolUserConfigParam(false, "binary_replay",
+        &m_recording_group, "Save race replays in the compact binary format "
+                            "instead of the text format."));
+
     // ---- Debug - not saved to config file
     /** If gamepad debugging is enabled. */
     PARAM_PREFIX bool m_unit_testing PARAM_DEFAULT(false);
@@ -793,6 +798,21 @@ namespace UserConfigParams
      PARAM_PREFIX IntUserConfigParam m_timer_sync_difference_tolerance
         PARAM_DEFAULT(IntUserConfigParam(5, "timer-sync-difference-tolerance",
         &m_network_group, "Max time difference tolerance (in ms) to synchronize timer with server."));
+    PARAM_PREFIX IntUserConfigParam m_rewind_budget
+        PARAM_DEFAULT(IntUserConfigParam(0, "rewind-budget",
+        &m_network_group, "Max time (in ms) a rewind should take on a client. "
+        "After a longer rewind further rewinds are combined into one until "
+        "the same time has passed, 0 to always rewind immediately."));
+    PARAM_PREFIX BoolUserConfigParam m_rewind_stats
+        PARAM_DEFAULT(BoolUserConfigParam(false, "rewind-stats",
+        &m_network_group, "If statistics of each rewind should be written to "
+        "a file (ticks replayed, time taken and the largest error)."));
+    PARAM_PREFIX IntUserConfigParam m_graph_cache_size
+        PARAM_DEFAULT(IntUserConfigParam(64, "graph-cache-size",
+        &m_network_group, "Memory (in MB) a server without graphics uses to "
+        "keep the drive and arena graphs of recently played tracks, so that "
+        "they don't need to be built again. Collision meshes and items are "
+        "still created for each race. 0 to disable."));
 
     // ---- Gamemode setup
     PARAM_PREFIX UIntToUIntUserConfigParam m_num_karts_per_gamemode
@@ -19,6 +19,7 @@
 
 #include "graphics/material_manager.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <sstream>
 
@@ -67,6 +68,8 @@ MaterialManager::~MaterialManager()
         delete m_materials[i];
     }
     m_materials.clear();
+    m_full_path_index.clear();
+    m_fname_index.clear();
 
     for (std::map<std::string, Material*> ::iterator it =
          m_default_sp_materials.begin(); it != m_default_sp_materials.end();
@@ -100,48 +103,28 @@ Material* MaterialManager::getMaterialSPM(std::string lay_one_tex_lc,
     const bool is_full_path = !lay_one_tex_lc.empty() &&
         (lay_one_tex_lc.find('/') != std::string::npos ||
         lay_one_tex_lc.find('\\') != std::string::npos);
-    if (is_full_path)
+    const std::vector<int>* indices = lay_one_tex_lc.empty() ? NULL :
+        findIndices(is_full_path ? m_full_path_index : m_fname_index,
+                    lay_one_tex_lc);
+    if (indices)
     {
         // Search backward so that temporary (track) textures are found first
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
+        for (int j = (int)indices->size() - 1; j >= 0; j--)
         {
-            if (m_materials[i]->getTexFullPath() == lay_one_tex_lc)
+            Material* m = m_materials[(*indices)[j]];
+            const std::string& mat_lay_two = m->getUVTwoTexture();
+            if (mat_lay_two.empty() && lay_two_tex_lc.empty())
             {
-                const std::string& mat_lay_two = m_materials[i]->getUVTwoTexture();
-                if (mat_lay_two.empty() && lay_two_tex_lc.empty())
-                {
-                    return m_materials[i];
-                }
-                else if (!mat_lay_two.empty() && !lay_two_tex_lc.empty())
-                {
-                    if (mat_lay_two == lay_two_tex_lc)
-                    {
-                        return m_materials[i];
-                    }
-                }
+                return m;
             }
-        }
-    }
-    else if (!lay_one_tex_lc.empty())
-    {
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFname() == lay_one_tex_lc)
+            else if (!mat_lay_two.empty() && !lay_two_tex_lc.empty())
             {
-                const std::string& mat_lay_two = m_materials[i]->getUVTwoTexture();
-                if (mat_lay_two.empty() && lay_two_tex_lc.empty())
-                {
-                    return m_materials[i];
-                }
-                else if (!mat_lay_two.empty() && !lay_two_tex_lc.empty())
+                if (mat_lay_two == lay_two_tex_lc)
                 {
-                    if (mat_lay_two == lay_two_tex_lc)
-                    {
-                        return m_materials[i];
-                    }
+                    return m;
                 }
             }
-        }   // for i
+        }   // for j
     }
     return getDefaultSPMaterial(def_shader_name,
         is_full_path ?
@@ -154,30 +137,20 @@ Material* MaterialManager::getMaterialFor(video::ITexture* t)
 {
     const io::path& img_path = t->getName().getInternalName();
 
+    const std::vector<int>* indices = NULL;
     if (!img_path.empty() && (img_path.findFirst('/') != -1 || img_path.findFirst('\\') != -1))
     {
-        // Search backward so that temporary (track) textures are found first
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFullPath() == img_path.c_str())
-            {
-                return m_materials[i];
-            }
-        }
+        indices = findIndices(m_full_path_index, img_path.c_str());
     }
     else
     {
         core::stringc image(StringUtils::getBasename(img_path.c_str()).c_str());
         image.make_lower();
-
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFname() == image.c_str())
-            {
-                return m_materials[i];
-            }
-        }   // for i
+        indices = findIndices(m_fname_index, image.c_str());
     }
+    // The last index is the most recently added (e.g. track) material
+    if (indices)
+        return m_materials[indices->back()];
     return NULL;
 }
 
@@ -251,10 +224,90 @@ void MaterialManager::setAllUntexturedMaterialFlags(scene::IMeshBuffer *mb)
 //-----------------------------------------------------------------------------
 int MaterialManager::addEntity(Material *m)
 {
-    m_materials.push_back(m);
+    addMaterial(m);
     return (int)m_materials.size()-1;
 }
 
+//-----------------------------------------------------------------------------
+/** Appends a material to m_materials and adds it to the name indices.
+ */
+void MaterialManager::addMaterial(Material *m)
+{
+    const int index = (int)m_materials.size();
+    m_materials.push_back(m);
+    m_full_path_index[m->getTexFullPath()].push_back(index);
+    m_fname_index[m->getTexFname()].push_back(index);
+}   // addMaterial
+
+//-----------------------------------------------------------------------------
+/** Removes the last material from m_materials and from the name indices,
+ *  and deletes it.
+ */
+void MaterialManager::removeLastMaterial()
+{
+    Material* m = m_materials.back();
+    // The last material has the largest index, so it is at the end of
+    // the index lists of its names.
+    MaterialIndex::iterator it = m_full_path_index.find(m->getTexFullPath());
+    assert(it != m_full_path_index.end() &&
+           it->second.back() == (int)m_materials.size() - 1);
+    it->second.pop_back();
+    if (it->second.empty())
+        m_full_path_index.erase(it);
+    it = m_fname_index.find(m->getTexFname());
+    assert(it != m_fname_index.end() &&
+           it->second.back() == (int)m_materials.size() - 1);
+    it->second.pop_back();
+    if (it->second.empty())
+        m_fname_index.erase(it);
+    m_materials.pop_back();
+    delete m;
+}   // removeLastMaterial
+
+//-----------------------------------------------------------------------------
+/** Returns the indices of all materials with the given name in the given
+ *  index, or NULL if there is no such material.
+ */
+const std::vector<int>* MaterialManager::findIndices(const MaterialIndex &index,
+                                                     const std::string &name) const
+{
+    MaterialIndex::const_iterator it = index.find(name);
+    if (it == index.end())
+        return NULL;
+    return &it->second;
+}   // findIndices
+
+//-----------------------------------------------------------------------------
+/** Called by a material when its texture file name changes (which happens
+ *  when the texture is installed), to keep the name index up to date.
+ *  \param m The material.
+ *  \param old_fname The previous texture file name of the material.
+ */
+void MaterialManager::renameMaterial(Material *m, const std::string &old_fname)
+{
+    MaterialIndex::iterator it = m_fname_index.find(old_fname);
+    if (it == m_fname_index.end())
+        return;
+    std::vector<int>& old_list = it->second;
+    for (unsigned int i = 0; i < old_list.size(); i++)
+    {
+        const int index = old_list[i];
+        if (m_materials[index] != m)
+            continue;
+        old_list.erase(old_list.begin() + i);
+        if (old_list.empty())
+            m_fname_index.erase(it);
+        // Keep the new list sorted, so that the last entry is still the
+        // most recently added material.
+        std::vector<int>& new_list = m_fname_index[m->getTexFname()];
+        new_list.insert(std::lower_bound(new_list.begin(), new_list.end(),
+                                         index), index);
+        return;
+    }
+    // Not found: the material is not (yet) managed, e.g. it is installed
+    // in its constructor, or it is a default SP material.
+}   // renameMaterial
+
 //-----------------------------------------------------------------------------
 void MaterialManager::loadMaterial()
 {
@@ -322,7 +375,7 @@ bool MaterialManager::pushTempMaterial(const XMLNode *root,
         }
         try
         {
-            m_materials.push_back(new Material(node, deprecated));
+            addMaterial(new Material(node, deprecated));
         }
         catch(std::exception& e)
         {
@@ -339,8 +392,7 @@ void MaterialManager::popTempMaterial()
 {
     for(int i=(int)m_materials.size()-1; i>=this->m_shared_material_index; i--)
     {
-        delete m_materials[i];
-        m_materials.pop_back();
+        removeLastMaterial();
     }   // for i6
 }   // popTempMaterial
 
@@ -385,16 +437,15 @@ Material *MaterialManager::getMaterial(const std::string& fname,
     core::stringc basename_lower(basename.c_str());
     basename_lower.make_lower();
 
-    // Search backward so that temporary (track) textures are found first
-    for (int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname() == basename_lower.c_str())
-            return m_materials[i];
-    }
+    // The last index is the most recently added (e.g. track) material
+    const std::vector<int>* indices = findIndices(m_fname_index,
+                                                  basename_lower.c_str());
+    if (indices)
+        return m_materials[indices->back()];
 
     // Add the new material
     Material* m = new Material(fname, is_full_path, complain_if_not_found, install);
-    m_materials.push_back(m);
+    addMaterial(m);
     if(make_permanent)
     {
         assert(m_shared_material_index==(int)m_materials.size()-1);
@@ -441,10 +492,5 @@ bool MaterialManager::hasMaterial(const std::string& fname)
 {
     std::string basename=StringUtils::getBasename(fname);
 
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return true;
-    }
-    return false;
+    return findIndices(m_fname_index, basename) != NULL;
 }
@@ -33,6 +33,7 @@ using namespace irr;
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 class Material;
 class XMLReader;
@@ -50,8 +51,25 @@ private:
 
     std::vector<Material*> m_materials;
 
+    /** Maps a (lower case) full path or texture file name to the indices of
+     *  all materials in m_materials with that name, in increasing order.
+     *  The last index is the one a backward search through m_materials
+     *  would find, i.e. temporary (track) materials come first. */
+    typedef std::unordered_map<std::string, std::vector<int> > MaterialIndex;
+
+    /** Indices of materials by their full path. */
+    MaterialIndex m_full_path_index;
+
+    /** Indices of materials by their texture file name. */
+    MaterialIndex m_fname_index;
+
     std::map<std::string, Material*> m_default_sp_materials;
 
+    void    addMaterial(Material *m);
+    void    removeLastMaterial();
+    const std::vector<int>* findIndices(const MaterialIndex &index,
+                                        const std::string &name) const;
+
 public:
               MaterialManager();
              ~MaterialManager();
@@ -82,6 +100,7 @@ public:
     bool      hasMaterial(const std::string& fname);
 
     void      unloadAllTextures();
+    void      renameMaterial(Material *m, const std::string &old_fname);
 
     Material* getDefaultSPMaterial(const std::string& shader_name,
                                    const std::string& layer_one_lc = "",
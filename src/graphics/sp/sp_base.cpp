@@ -32,6 +32,7 @@
 #include "graphics/rtts.hpp"
 #include "graphics/shaders.hpp"
 #include "graphics/sp/sp_dynamic_draw_call.hpp"
+#include "graphics/sp/sp_frustum_culler.hpp"
 #include "graphics/sp/sp_instanced_data.hpp"
 #include "graphics/sp/sp_per_object_uniform.hpp"
 #include "graphics/sp/sp_mesh.hpp"
@@ -105,6 +106,8 @@ std::vector<std::shared_ptr<SPDynamicDrawCall> > g_dy_dc;
 // ----------------------------------------------------------------------------
 float g_frustums[5][24] = { { } };
 // ----------------------------------------------------------------------------
+SPFrustumCuller g_frustum_culler;
+// ----------------------------------------------------------------------------
 unsigned sp_solid_poly_count = 0;
 // ----------------------------------------------------------------------------
 unsigned sp_shadow_poly_count = 0;
@@ -770,6 +773,7 @@ void prepareDrawCalls()
         mathPlaneFrustumf(g_frustums[4],
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[3]);
     }
+    g_frustum_culler.setFrustums(g_frustums, g_handle_shadow ? 5 : 1);
 
     for (auto& p : g_draw_calls)
     {
@@ -808,39 +812,12 @@ void addObject(SPMeshNode* node)
         }
         core::aabbox3df bb = mb->getBoundingBox();
         model_matrix.transformBoxEx(bb);
-        std::vector<bool> discard;
         const bool handle_shadow = node->isInShadowPass() &&
             g_handle_shadow && shader->hasShader(RP_SHADOW);
-        discard.resize((handle_shadow ? 5 : 1), false);
-
-        for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
-        {
-            for (int i = 0; i < 24; i += 4)
-            {
-                bool outside = true;
-                for (int j = 0; j < 8; j++)
-                {
-                    const float dist =
-                        getCorner(bb, j).X * g_frustums[dc_type][i] +
-                        getCorner(bb, j).Y * g_frustums[dc_type][i + 1] +
-                        getCorner(bb, j).Z * g_frustums[dc_type][i + 2] +
-                        g_frustums[dc_type][i + 3];
-                    outside = outside && dist < 0.0f;
-                    if (!outside)
-                    {
-                        break;
-                    }
-                }
-                if (outside)
-                {
-                    discard[dc_type] = true;
-                    break;
-                }
-            }
-        }
-        if (handle_shadow ?
-            (discard[0] && discard[1] && discard[2] && discard[3] &&
-            discard[4]) : discard[0])
+        const unsigned frustum_count = handle_shadow ? 5 : 1;
+        // Bit dc_type is set if the box is outside of that frustum
+        const unsigned discard = g_frustum_culler.cull(bb, frustum_count);
+        if (discard == (1u << frustum_count) - 1)
         {
             continue;
         }
@@ -888,7 +865,7 @@ void addObject(SPMeshNode* node)
 
         for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
         {
-            if (discard[dc_type])
+            if ((discard >> dc_type) & 1)
             {
                 continue;
             }
@@ -978,38 +955,12 @@ void handleDynamicDrawCall()
         SPShader* shader = dydc->getShader();
         core::aabbox3df bb = dydc->getBoundingBox();
         dydc->getAbsoluteTransformation().transformBoxEx(bb);
-        std::vector<bool> discard;
         const bool handle_shadow =
             g_handle_shadow && shader->hasShader(RP_SHADOW);
-        discard.resize((handle_shadow ? 5 : 1), false);
-        for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
-        {
-            for (int i = 0; i < 24; i += 4)
-            {
-                bool outside = true;
-                for (int j = 0; j < 8; j++)
-                {
-                    const float dist =
-                        getCorner(bb, j).X * g_frustums[dc_type][i] +
-                        getCorner(bb, j).Y * g_frustums[dc_type][i + 1] +
-                        getCorner(bb, j).Z * g_frustums[dc_type][i + 2] +
-                        g_frustums[dc_type][i + 3];
-                    outside = outside && dist < 0.0f;
-                    if (!outside)
-                    {
-                        break;
-                    }
-                }
-                if (outside)
-                {
-                    discard[dc_type] = true;
-                    break;
-                }
-            }
-        }
-        if (handle_shadow ?
-            (discard[0] && discard[1] && discard[2] && discard[3] &&
-            discard[4]) : discard[0])
+        const unsigned frustum_count = handle_shadow ? 5 : 1;
+        // Bit dc_type is set if the box is outside of that frustum
+        const unsigned discard = g_frustum_culler.cull(bb, frustum_count);
+        if (discard == (1u << frustum_count) - 1)
         {
             continue;
         }
@@ -1032,7 +983,7 @@ void handleDynamicDrawCall()
 
         for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
         {
-            if (discard[dc_type])
+            if ((discard >> dc_type) & 1)
             {
                 continue;
             }
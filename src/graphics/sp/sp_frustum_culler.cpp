@@ -0,0 +1,260 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/sp/sp_frustum_culler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+
+#if defined(__AVX__)
+ #include <immintrin.h>
+ #define SP_CULL_AVX 1
+#elif __SSE2__ || _M_X64 || _M_IX86_FP >= 2
+ #include <emmintrin.h>
+ #define SP_CULL_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #include <arm_neon.h>
+ #define SP_CULL_NEON 1
+#endif
+
+namespace SP
+{
+// ----------------------------------------------------------------------------
+/** Tests all boxes against random frustums and compares the result with
+ *  testing all 8 corners of the box against each plane.
+ */
+void SPFrustumCuller::unitTesting()
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+    float frustums[MAX_FRUSTUMS][24];
+    SPFrustumCuller culler;
+
+    // Nothing is culled without frustums
+    core::aabbox3df far_away(core::vector3df(1000.0f, 1000.0f, 1000.0f));
+    assert(culler.cull(far_away, MAX_FRUSTUMS) == 0);
+
+    // An axis aligned cube from -1 to 1 as first frustum
+    for (unsigned i = 0; i < 6; i++)
+    {
+        float* plane = &frustums[0][i * 4];
+        plane[0] = plane[1] = plane[2] = 0.0f;
+        plane[i / 2] = i % 2 == 0 ? 1.0f : -1.0f;
+        plane[3] = 1.0f;
+    }
+    culler.setFrustums(frustums, 1);
+    assert(culler.cull(core::aabbox3df(-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f),
+        1) == 0);
+    assert(culler.cull(core::aabbox3df(0.5f, 0.5f, 0.5f, 5.0f, 5.0f, 5.0f),
+        1) == 0);
+    assert(culler.cull(far_away, 1) == 1);
+    // The other frustums are not set and never cull
+    assert(culler.cull(far_away, MAX_FRUSTUMS) == 1);
+
+    for (unsigned test = 0; test < 100; test++)
+    {
+        for (unsigned f = 0; f < MAX_FRUSTUMS; f++)
+        {
+            for (unsigned i = 0; i < 24; i += 4)
+            {
+                core::vector3df normal(dist(rng), dist(rng), dist(rng));
+                normal.normalize();
+                frustums[f][i] = normal.X;
+                frustums[f][i + 1] = normal.Y;
+                frustums[f][i + 2] = normal.Z;
+                frustums[f][i + 3] = dist(rng);
+            }
+        }
+        const unsigned count = 1 + test % MAX_FRUSTUMS;
+        culler.setFrustums(frustums, count);
+        for (unsigned box = 0; box < 100; box++)
+        {
+            core::aabbox3df bb(core::vector3df(dist(rng), dist(rng),
+                dist(rng)));
+            bb.addInternalPoint(dist(rng), dist(rng), dist(rng));
+            unsigned expected = 0;
+            bool near_plane = false;
+            for (unsigned f = 0; f < count; f++)
+            {
+                for (unsigned i = 0; i < 24; i += 4)
+                {
+                    float max_distance = -1e30f;
+                    for (unsigned j = 0; j < 8; j++)
+                    {
+                        const float x = j & 1 ? bb.MaxEdge.X : bb.MinEdge.X;
+                        const float y = j & 2 ? bb.MaxEdge.Y : bb.MinEdge.Y;
+                        const float z = j & 4 ? bb.MaxEdge.Z : bb.MinEdge.Z;
+                        max_distance = std::max(max_distance,
+                            x * frustums[f][i] + y * frustums[f][i + 1] +
+                            z * frustums[f][i + 2] + frustums[f][i + 3]);
+                    }
+                    // Rounding can differ if the box touches the plane
+                    near_plane |= fabsf(max_distance) < 0.001f;
+                    if (max_distance < 0.0f)
+                        expected |= 1 << f;
+                }
+            }
+            assert(near_plane || culler.cull(bb, count) == expected);
+        }
+    }
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Initializes all planes so that no box is ever outside of them. */
+SPFrustumCuller::SPFrustumCuller()
+{
+    for (unsigned i = 0; i < MAX_PLANES; i++)
+    {
+        m_normal_x[i] = m_normal_y[i] = m_normal_z[i] = 0.0f;
+        m_distance[i] = 1.0f;
+    }
+}   // SPFrustumCuller
+
+// ----------------------------------------------------------------------------
+/** Sets the frustums to test against.
+ *  \param frustums 6 planes (a, b, c, d) of each frustum, a point is inside
+ *         of a plane if a * x + b * y + c * z + d >= 0.
+ *  \param count Number of frustums, at most MAX_FRUSTUMS.
+ */
+void SPFrustumCuller::setFrustums(const float frustums[][24], unsigned count)
+{
+    assert(count <= MAX_FRUSTUMS);
+    for (unsigned f = 0; f < count; f++)
+    {
+        for (unsigned i = 0; i < 6; i++)
+        {
+            const float* plane = &frustums[f][i * 4];
+            m_normal_x[f * 6 + i] = plane[0];
+            m_normal_y[f * 6 + i] = plane[1];
+            m_normal_z[f * 6 + i] = plane[2];
+            m_distance[f * 6 + i] = plane[3];
+        }
+    }
+}   // setFrustums
+
+// ----------------------------------------------------------------------------
+/** Tests a box against the first frustums.
+ *  \param bb The box.
+ *  \param frustum_count Number of frustums to test.
+ *  \return Bit i is set if the box is outside of frustum i.
+ */
+unsigned SPFrustumCuller::cull(const core::aabbox3df& bb,
+                               unsigned frustum_count) const
+{
+    assert(frustum_count <= MAX_FRUSTUMS);
+    const unsigned plane_count = frustum_count * 6;
+    // Bit i is set if the box is outside of plane i
+    uint32_t outside = 0;
+
+#if SP_CULL_AVX
+    const __m256 min_x = _mm256_set1_ps(bb.MinEdge.X);
+    const __m256 min_y = _mm256_set1_ps(bb.MinEdge.Y);
+    const __m256 min_z = _mm256_set1_ps(bb.MinEdge.Z);
+    const __m256 max_x = _mm256_set1_ps(bb.MaxEdge.X);
+    const __m256 max_y = _mm256_set1_ps(bb.MaxEdge.Y);
+    const __m256 max_z = _mm256_set1_ps(bb.MaxEdge.Z);
+    for (unsigned i = 0; i < plane_count; i += 8)
+    {
+        const __m256 nx = _mm256_loadu_ps(m_normal_x + i);
+        const __m256 ny = _mm256_loadu_ps(m_normal_y + i);
+        const __m256 nz = _mm256_loadu_ps(m_normal_z + i);
+        __m256 distance = _mm256_max_ps(_mm256_mul_ps(min_x, nx),
+            _mm256_mul_ps(max_x, nx));
+        distance = _mm256_add_ps(distance, _mm256_max_ps(
+            _mm256_mul_ps(min_y, ny), _mm256_mul_ps(max_y, ny)));
+        distance = _mm256_add_ps(distance, _mm256_max_ps(
+            _mm256_mul_ps(min_z, nz), _mm256_mul_ps(max_z, nz)));
+        distance = _mm256_add_ps(distance, _mm256_loadu_ps(m_distance + i));
+        outside |= (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(distance,
+            _mm256_setzero_ps(), _CMP_LT_OQ)) << i;
+    }
+#elif SP_CULL_SSE2
+    const __m128 min_x = _mm_set1_ps(bb.MinEdge.X);
+    const __m128 min_y = _mm_set1_ps(bb.MinEdge.Y);
+    const __m128 min_z = _mm_set1_ps(bb.MinEdge.Z);
+    const __m128 max_x = _mm_set1_ps(bb.MaxEdge.X);
+    const __m128 max_y = _mm_set1_ps(bb.MaxEdge.Y);
+    const __m128 max_z = _mm_set1_ps(bb.MaxEdge.Z);
+    for (unsigned i = 0; i < plane_count; i += 4)
+    {
+        const __m128 nx = _mm_loadu_ps(m_normal_x + i);
+        const __m128 ny = _mm_loadu_ps(m_normal_y + i);
+        const __m128 nz = _mm_loadu_ps(m_normal_z + i);
+        __m128 distance = _mm_max_ps(_mm_mul_ps(min_x, nx),
+            _mm_mul_ps(max_x, nx));
+        distance = _mm_add_ps(distance, _mm_max_ps(_mm_mul_ps(min_y, ny),
+            _mm_mul_ps(max_y, ny)));
+        distance = _mm_add_ps(distance, _mm_max_ps(_mm_mul_ps(min_z, nz),
+            _mm_mul_ps(max_z, nz)));
+        distance = _mm_add_ps(distance, _mm_loadu_ps(m_distance + i));
+        outside |= (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(distance,
+            _mm_setzero_ps())) << i;
+    }
+#elif SP_CULL_NEON
+    const float32x4_t min_x = vdupq_n_f32(bb.MinEdge.X);
+    const float32x4_t min_y = vdupq_n_f32(bb.MinEdge.Y);
+    const float32x4_t min_z = vdupq_n_f32(bb.MinEdge.Z);
+    const float32x4_t max_x = vdupq_n_f32(bb.MaxEdge.X);
+    const float32x4_t max_y = vdupq_n_f32(bb.MaxEdge.Y);
+    const float32x4_t max_z = vdupq_n_f32(bb.MaxEdge.Z);
+    const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+    const uint32x4_t bits = vld1q_u32(lane_bits);
+    for (unsigned i = 0; i < plane_count; i += 4)
+    {
+        const float32x4_t nx = vld1q_f32(m_normal_x + i);
+        const float32x4_t ny = vld1q_f32(m_normal_y + i);
+        const float32x4_t nz = vld1q_f32(m_normal_z + i);
+        float32x4_t distance = vmaxq_f32(vmulq_f32(min_x, nx),
+            vmulq_f32(max_x, nx));
+        distance = vaddq_f32(distance, vmaxq_f32(vmulq_f32(min_y, ny),
+            vmulq_f32(max_y, ny)));
+        distance = vaddq_f32(distance, vmaxq_f32(vmulq_f32(min_z, nz),
+            vmulq_f32(max_z, nz)));
+        distance = vaddq_f32(distance, vld1q_f32(m_distance + i));
+        const uint32x4_t mask = vandq_u32(
+            vcltq_f32(distance, vdupq_n_f32(0.0f)), bits);
+        const uint32x2_t half = vorr_u32(vget_low_u32(mask),
+            vget_high_u32(mask));
+        outside |= (vget_lane_u32(half, 0) | vget_lane_u32(half, 1)) << i;
+    }
+#else
+    for (unsigned i = 0; i < plane_count; i++)
+    {
+        const float distance =
+            std::max(bb.MinEdge.X * m_normal_x[i],
+                     bb.MaxEdge.X * m_normal_x[i]) +
+            std::max(bb.MinEdge.Y * m_normal_y[i],
+                     bb.MaxEdge.Y * m_normal_y[i]) +
+            std::max(bb.MinEdge.Z * m_normal_z[i],
+                     bb.MaxEdge.Z * m_normal_z[i]) + m_distance[i];
+        if (distance < 0.0f)
+            outside |= 1 << i;
+    }
+#endif
+
+    unsigned result = 0;
+    for (unsigned f = 0; f < frustum_count; f++)
+    {
+        if ((outside >> (f * 6)) & 63)
+            result |= 1 << f;
+    }
+    return result;
+}   // cull
+
+}
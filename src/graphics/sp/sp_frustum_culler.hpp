@@ -0,0 +1,69 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SP_FRUSTUM_CULLER_HPP
+#define HEADER_SP_FRUSTUM_CULLER_HPP
+
+#include "utils/types.hpp"
+
+#include <aabbox3d.h>
+
+using namespace irr;
+
+namespace SP
+{
+
+/** Tests bounding boxes against the camera frustum and the frustums of the
+ *  shadow cascades. The planes of all frustums are stored as structure of
+ *  arrays, so that 4 planes (8 with AVX) are tested at once with SSE or
+ *  NEON. Only the corner of a box farthest along the normal of a plane is
+ *  tested, if it is outside of the plane all other corners are too. It
+ *  doesn't need a GPU, so it is also used in unit testing.
+ */
+class SPFrustumCuller
+{
+public:
+    /** The camera frustum and the 4 shadow cascades. */
+    static const unsigned MAX_FRUSTUMS = 5;
+
+private:
+    /** 6 planes of each frustum, padded to a multiple of 8 planes. */
+    static const unsigned MAX_PLANES = 32;
+
+    float m_normal_x[MAX_PLANES];
+
+    float m_normal_y[MAX_PLANES];
+
+    float m_normal_z[MAX_PLANES];
+
+    float m_distance[MAX_PLANES];
+
+public:
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    SPFrustumCuller();
+    // ------------------------------------------------------------------------
+    void setFrustums(const float frustums[][24], unsigned count);
+    // ------------------------------------------------------------------------
+    unsigned cull(const core::aabbox3df& bb, unsigned frustum_count) const;
+
+};   // class SPFrustumCuller
+
+}
+
+#endif
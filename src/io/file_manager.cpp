@@ -32,6 +32,7 @@
 #include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 #ifdef ANDROID
 #include "io/assets_android.hpp"
@@ -39,12 +40,14 @@
 
 #include <irrlicht.h>
 
+#include <algorithm>
 #include <stdio.h>
 #include <stdexcept>
 #include <sstream>
 #include <sys/stat.h>
 #include <iostream>
 #include <string>
+#include <thread>
 
 namespace irr {
     namespace io
@@ -53,6 +56,11 @@ namespace irr {
     }
 }
 
+/** Identifies a manifest of XML trees, see FileManager::preloadXMLTrees. */
+static const uint32_t XML_MANIFEST_MAGIC = 0x4d4c4d58;   // "XMLM"
+/** Increase this whenever the layout of the manifest changes. */
+static const uint32_t XML_MANIFEST_VERSION = 2;
+
 // For mkdir
 #if !defined(WIN32)
 #  include <sys/stat.h>
@@ -252,6 +260,7 @@ FileManager::FileManager()
     checkAndCreateScreenshotDir();
     checkAndCreateReplayDir();
     checkAndCreateCachedTexturesDir();
+    checkAndCreateCachedDataDir();
     checkAndCreateGPDir();
 
     redirectOutput();
@@ -449,6 +458,8 @@ void FileManager::reinitAfterDownloadAssets()
 //-----------------------------------------------------------------------------
 FileManager::~FileManager()
 {
+    clearPreloadedXMLTrees();
+
     // Clean up left-over files in addons/tmp that are older than 24h
     // ==============================================================
     // (The 24h delay is useful when debugging a problem with a zip file)
@@ -550,6 +561,17 @@ io::IXMLReader *FileManager::createXMLReader(const std::string &filename)
  */
 XMLNode *FileManager::createXMLTree(const std::string &filename)
 {
+    {
+        std::lock_guard<std::mutex> lock(m_preloaded_xml_lock);
+        std::map<std::string, XMLNode*>::iterator it =
+            m_preloaded_xml_trees.find(filename);
+        if (it != m_preloaded_xml_trees.end())
+        {
+            XMLNode* node = it->second;
+            m_preloaded_xml_trees.erase(it);
+            return node;
+        }
+    }
     try
     {
         XMLNode* node = new XMLNode(filename);
@@ -595,6 +617,244 @@ XMLNode *FileManager::createXMLTreeFromString(const std::string & content)
     }
 }   // createXMLTreeFromString
 
+//-----------------------------------------------------------------------------
+/** Reads a XML file and converts it into a XMLNode tree. Unlike
+ *  createXMLTree() this does not use irrlicht's file system to find the
+ *  file, so it can be called by several threads at the same time.
+ *  \param filename Full path of the XML file.
+ *  \return The tree, or NULL if the file can't be read.
+ */
+XMLNode *FileManager::readXMLTree(const std::string &filename)
+{
+    FILE* fp = FileUtils::fopenU8Path(filename, "rb");
+    if (!fp)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size <= 0)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    c8* buffer = new c8[size];
+    const bool success = fread(buffer, size, 1, fp) == 1;
+    fclose(fp);
+    if (!success)
+    {
+        delete [] buffer;
+        return NULL;
+    }
+    // The memory file deletes the buffer
+    io::IReadFile* file = m_file_system->createMemoryReadFile(buffer,
+        (s32)size, filename.c_str(), /*deleteMemoryWhenDropped*/true);
+    io::IXMLReader* reader = m_file_system->createXMLReader(file);
+    file->drop();
+    if (!reader)
+        return NULL;
+    XMLNode* node = new XMLNode(reader, filename);
+    reader->drop();
+    return node;
+}   // readXMLTree
+
+//-----------------------------------------------------------------------------
+/** Reads several XML files in parallel, which are then returned by
+ *  createXMLTree() (once for each file). This is used to speed up the
+ *  loading of all karts and tracks. Files which don't exist are ignored.
+ *  If a manifest name is given, the trees are also saved in a manifest in
+ *  the cached data directory, together with the modification time and size
+ *  of each file. The next time files which didn't change are taken from the
+ *  manifest instead of being parsed again.
+ *  \param filenames Full paths of the XML files.
+ *  \param manifest Name of the manifest, e.g. the directory of the files,
+ *         or an empty string to not use a manifest.
+ */
+void FileManager::preloadXMLTrees(const std::vector<std::string> &filenames,
+                                  const std::string &manifest)
+{
+    if (filenames.size() < 2)
+        return;
+
+    std::vector<ManifestEntry> entries(filenames.size());
+    for (unsigned i = 0; i < filenames.size(); i++)
+    {
+        struct stat st;
+        if (FileUtils::statU8Path(filenames[i], &st) != 0)
+            continue;
+        entries[i].m_exists = true;
+        entries[i].m_mtime = (uint64_t)st.st_mtime;
+        entries[i].m_size = (uint64_t)st.st_size;
+    }
+    std::string manifest_data;
+    std::map<std::string, ManifestEntry> old_entries;
+    if (!manifest.empty())
+        loadXMLManifest(manifest, &manifest_data, &old_entries);
+
+    std::vector<XMLNode*> trees(filenames.size(), NULL);
+    std::vector<bool> from_manifest(filenames.size(), false);
+    {
+        const unsigned threads =
+            std::min(std::thread::hardware_concurrency(), 8u);
+        WorkerPool pool(threads > 1 ? threads - 1 : 0, "XMLPreload");
+        pool.run((unsigned)filenames.size(),
+            [this, &filenames, &trees, &entries, &old_entries,
+             &manifest_data, &from_manifest](unsigned i)
+            {
+                if (!entries[i].m_exists)
+                    return;
+                auto it = old_entries.find(filenames[i]);
+                if (it != old_entries.end() &&
+                    it->second.m_mtime == entries[i].m_mtime &&
+                    it->second.m_size == entries[i].m_size)
+                {
+                    size_t pos = it->second.m_tree_offset;
+                    trees[i] = XMLNode::load(manifest_data, &pos,
+                                             filenames[i]);
+                    from_manifest[i] = trees[i] != NULL;
+                }
+                if (!trees[i])
+                    trees[i] = readXMLTree(filenames[i]);
+            });
+    }
+
+    if (!manifest.empty())
+    {
+        bool changed = false;
+        unsigned count = 0;
+        for (unsigned i = 0; i < filenames.size(); i++)
+        {
+            if (trees[i])
+                count++;
+            changed |= trees[i] && !from_manifest[i];
+        }
+        if (changed || count != old_entries.size())
+            saveXMLManifest(manifest, filenames, entries, trees);
+    }
+
+    std::lock_guard<std::mutex> lock(m_preloaded_xml_lock);
+    for (unsigned i = 0; i < filenames.size(); i++)
+    {
+        if (!trees[i])
+            continue;
+        XMLNode*& node = m_preloaded_xml_trees[filenames[i]];
+        delete node;
+        node = trees[i];
+    }
+}   // preloadXMLTrees
+
+//-----------------------------------------------------------------------------
+std::string FileManager::getXMLManifestFileName(const std::string &manifest)
+    const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "xml-manifest-%016llx.bin",
+        (unsigned long long)FileUtils::checksum(manifest.data(),
+                                                manifest.size()));
+    return m_cached_data_dir + name;
+}   // getXMLManifestFileName
+
+//-----------------------------------------------------------------------------
+/** Reads a manifest written by saveXMLManifest. The trees are not created
+ *  here, only their position in the data is stored.
+ *  \param manifest Name of the manifest.
+ *  \param data On return the content of the manifest file.
+ *  \param entries On return the files in the manifest.
+ */
+void FileManager::loadXMLManifest(const std::string &manifest,
+                                  std::string *data,
+                                  std::map<std::string, ManifestEntry> *entries)
+{
+    const std::string file_name = getXMLManifestFileName(manifest);
+    if (!FileUtils::readCacheFile(file_name, XML_MANIFEST_MAGIC,
+            XML_MANIFEST_VERSION,
+            FileUtils::checksum(manifest.data(), manifest.size()),
+            256 * 1024 * 1024, data))
+        return;
+
+    // Each file is stored as name, modification time, size, size of the
+    // tree and the tree
+    size_t pos = 0;
+    bool success = true;
+    while (success && pos < data->size())
+    {
+        uint32_t len;
+        ManifestEntry entry;
+        uint64_t tree_size;
+        success = data->size() - pos >= sizeof(len);
+        if (!success)
+            break;
+        memcpy(&len, data->data() + pos, sizeof(len));
+        pos += sizeof(len);
+        success = data->size() - pos >= len + 3 * sizeof(uint64_t);
+        if (!success)
+            break;
+        const std::string name = data->substr(pos, len);
+        pos += len;
+        memcpy(&entry.m_mtime, data->data() + pos, sizeof(uint64_t));
+        memcpy(&entry.m_size, data->data() + pos + 8, sizeof(uint64_t));
+        memcpy(&tree_size, data->data() + pos + 16, sizeof(uint64_t));
+        pos += 3 * sizeof(uint64_t);
+        success = data->size() - pos >= tree_size;
+        entry.m_exists = true;
+        entry.m_tree_offset = pos;
+        pos += (size_t)tree_size;
+        (*entries)[name] = entry;
+    }
+    if (!success)
+    {
+        Log::warn("FileManager", "Ignoring invalid manifest '%s'.",
+                  file_name.c_str());
+        entries->clear();
+        data->clear();
+    }
+}   // loadXMLManifest
+
+//-----------------------------------------------------------------------------
+/** Saves the trees of all existing files in a manifest.
+ *  \param manifest Name of the manifest.
+ *  \param filenames Full paths of the XML files.
+ *  \param entries Modification time and size of each file.
+ *  \param trees The tree of each file, or NULL if it could not be read.
+ */
+void FileManager::saveXMLManifest(const std::string &manifest,
+                                  const std::vector<std::string> &filenames,
+                                  const std::vector<ManifestEntry> &entries,
+                                  const std::vector<XMLNode*> &trees) const
+{
+    std::string data;
+    for (unsigned i = 0; i < filenames.size(); i++)
+    {
+        if (!trees[i])
+            continue;
+        const uint32_t len = (uint32_t)filenames[i].size();
+        data.append((const char*)&len, sizeof(len));
+        data.append(filenames[i]);
+        data.append((const char*)&entries[i].m_mtime, sizeof(uint64_t));
+        data.append((const char*)&entries[i].m_size, sizeof(uint64_t));
+        std::string tree;
+        trees[i]->save(&tree);
+        const uint64_t tree_size = tree.size();
+        data.append((const char*)&tree_size, sizeof(tree_size));
+        data.append(tree);
+    }
+
+    FileUtils::writeCacheFile(getXMLManifestFileName(manifest),
+        XML_MANIFEST_MAGIC, XML_MANIFEST_VERSION,
+        FileUtils::checksum(manifest.data(), manifest.size()), data.data(),
+        data.size());
+}   // saveXMLManifest
+
+//-----------------------------------------------------------------------------
+/** Deletes all preloaded XML trees which were not used.
+ */
+void FileManager::clearPreloadedXMLTrees()
+{
+    std::lock_guard<std::mutex> lock(m_preloaded_xml_lock);
+    for (auto& tree : m_preloaded_xml_trees)
+        delete tree.second;
+    m_preloaded_xml_trees.clear();
+}   // clearPreloadedXMLTrees
+
 //-----------------------------------------------------------------------------
 /** In order to add and later remove paths we have to specify the absolute
  *  filename (and replace '\' with '/' on windows).
@@ -826,6 +1086,15 @@ std::string FileManager::getCachedTexturesDir() const
     return m_cached_textures_dir;
 }   // getCachedTexturesDir
 
+//-----------------------------------------------------------------------------
+/** Returns the directory in which data computed from the assets (e.g. the
+ *  shortest paths of an arena) is cached.
+ */
+std::string FileManager::getCachedDataDir() const
+{
+    return m_cached_data_dir;
+}   // getCachedDataDir
+
 //-----------------------------------------------------------------------------
 /** Returns the directory in which user-defined grand prix should be stored.
  */
@@ -1168,6 +1437,31 @@ void FileManager::checkAndCreateCachedTexturesDir()
 
 }   // checkAndCreateCachedTexturesDir
 
+// ----------------------------------------------------------------------------
+/** Creates the directories for cached data. This will set m_cached_data_dir
+ *  with the appropriate path.
+ */
+void FileManager::checkAndCreateCachedDataDir()
+{
+#if defined(WIN32)
+    m_cached_data_dir = m_user_config_dir + "cached-data/";
+#elif defined(__APPLE__)
+    m_cached_data_dir = getenv("HOME");
+    m_cached_data_dir += "/Library/Application Support/SuperTuxKart/CachedData/";
+#else
+    m_cached_data_dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    m_cached_data_dir += "cached-data/";
+#endif
+
+    if (!checkAndCreateDirectory(m_cached_data_dir))
+    {
+        Log::error("FileManager", "Can not create cached data directory '%s', "
+            "falling back to './'.", m_cached_data_dir.c_str());
+        m_cached_data_dir = "./";
+    }
+
+}   // checkAndCreateCachedDataDir
+
 // ----------------------------------------------------------------------------
 /** Creates the directories for user-defined grand prix. This will set m_gp_dir
  *  with the appropriate path.
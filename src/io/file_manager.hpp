@@ -25,6 +25,7 @@
  * Contains generic utility classes for file I/O (especially XML handling).
  */
 
+#include <map>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -37,6 +38,7 @@ using namespace irr;
 
 #include "io/xml_node.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/types.hpp"
 
 struct TextureSearchPath
 {
@@ -98,6 +100,9 @@ private:
     /** Directory where resized textures are cached. */
     std::string       m_cached_textures_dir;
 
+    /** Directory where data computed from the assets is cached. */
+    std::string       m_cached_data_dir;
+
     /** Directory where user-defined grand prix are stored. */
     std::string       m_gp_dir;
 
@@ -112,6 +117,34 @@ private:
     std::vector<std::string>
                       m_model_search_path,
                       m_music_search_path;
+
+    /** XML trees read in advance by preloadXMLTrees(), which createXMLTree()
+     *  returns instead of reading the file again. */
+    std::map<std::string, XMLNode*> m_preloaded_xml_trees;
+    std::mutex        m_preloaded_xml_lock;
+
+    /** A file in a manifest of XML trees, see preloadXMLTrees(). */
+    struct ManifestEntry
+    {
+        bool     m_exists;
+        uint64_t m_mtime;
+        uint64_t m_size;
+        /** Position of the tree in the data of the manifest. */
+        size_t   m_tree_offset;
+        ManifestEntry()
+            : m_exists(false), m_mtime(0), m_size(0), m_tree_offset(0) {}
+    };
+
+    XMLNode          *readXMLTree(const std::string &filename);
+    std::string       getXMLManifestFileName(const std::string &manifest)
+                                                                        const;
+    void              loadXMLManifest(const std::string &manifest,
+                                      std::string *data,
+                                std::map<std::string, ManifestEntry> *entries);
+    void              saveXMLManifest(const std::string &manifest,
+                                    const std::vector<std::string> &filenames,
+                                    const std::vector<ManifestEntry> &entries,
+                                    const std::vector<XMLNode*> &trees) const;
     bool              findFile(std::string& full_path,
                                const std::string& fname,
                                const std::vector<std::string>& search_path)
@@ -128,6 +161,7 @@ private:
     void              checkAndCreateScreenshotDir();
     void              checkAndCreateReplayDir();
     void              checkAndCreateCachedTexturesDir();
+    void              checkAndCreateCachedDataDir();
     void              checkAndCreateGPDir();
     void              discoverPaths();
     void              addAssetsSearchPath();
@@ -150,10 +184,14 @@ public:
     io::IXMLReader   *createXMLReader(const std::string &filename);
     XMLNode          *createXMLTree(const std::string &filename);
     XMLNode          *createXMLTreeFromString(const std::string & content);
+    void              preloadXMLTrees(const std::vector<std::string> &filenames,
+                                      const std::string &manifest = "");
+    void              clearPreloadedXMLTrees();
 
     std::string       getScreenshotDir() const;
     std::string       getReplayDir() const;
     std::string       getCachedTexturesDir() const;
+    std::string       getCachedDataDir() const;
     std::string       getGPDir() const;
     bool              checkAndCreateDirectory(const std::string &path);
     bool              checkAndCreateDirectoryP(const std::string &path);
@@ -24,6 +24,7 @@
 #include "utils/vec3.hpp"
 
 #include <stdexcept>
+#include <string.h>
 
 XMLNode::XMLNode(io::IXMLReader *xml)
 {
@@ -48,6 +49,27 @@ XMLNode::XMLNode(const std::string &filename)
         throw std::runtime_error("Cannot find file "+filename);
     }
 
+    readRootElement(xml);
+    xml->drop();
+}   // XMLNode
+
+// ----------------------------------------------------------------------------
+/** Converts the XML read by the given reader into a XMLNode tree.
+ *  \param xml The XML reader.
+ *  \param filename Name of the XML file, used in messages.
+ */
+XMLNode::XMLNode(io::IXMLReader *xml, const std::string &filename)
+{
+    m_file_name = filename;
+    readRootElement(xml);
+}   // XMLNode
+
+// ----------------------------------------------------------------------------
+/** Reads the root element of a XML file.
+ *  \param xml The XML reader.
+ */
+void XMLNode::readRootElement(io::IXMLReader *xml)
+{
     bool is_first_element = true;
     while(xml->read())
     {
@@ -59,7 +81,7 @@ XMLNode::XMLNode(const std::string &filename)
                 {
                     Log::warn("[XMLNode]",
                                 "More than one root element in '%s' - ignored.",
-                            filename.c_str());
+                            m_file_name.c_str());
                 }
                 readXML(xml);
                 is_first_element = false;
@@ -72,8 +94,7 @@ XMLNode::XMLNode(const std::string &filename)
         default:                   break;
         }   // switch
     }   // while
-    xml->drop();
-}   // XMLNode
+}   // readRootElement
 
 // ----------------------------------------------------------------------------
 /** Destructor. */
@@ -129,6 +150,99 @@ void XMLNode::readXML(io::IXMLReader *xml)
     }   // while
 }   // readXML
 
+// ----------------------------------------------------------------------------
+/** Appends a binary copy of this node and all its children, which load()
+ *  converts back into a tree without parsing XML. Strings are stored with
+ *  their length, attribute values are stored utf8 encoded.
+ *  \param out The string to append to.
+ */
+void XMLNode::save(std::string *out) const
+{
+    auto add_string = [out](const std::string &s)
+    {
+        const uint32_t len = (uint32_t)s.size();
+        out->append((const char*)&len, sizeof(len));
+        out->append(s);
+    };
+    add_string(m_name);
+    uint32_t count = (uint32_t)m_attributes.size();
+    out->append((const char*)&count, sizeof(count));
+    for (auto& attribute : m_attributes)
+    {
+        add_string(attribute.first);
+        add_string(StringUtils::wideToUtf8(attribute.second));
+    }
+    count = (uint32_t)m_nodes.size();
+    out->append((const char*)&count, sizeof(count));
+    for (const XMLNode *node : m_nodes)
+        node->save(out);
+}   // save
+
+// ----------------------------------------------------------------------------
+/** Creates a tree from the data appended by save().
+ *  \param data The data.
+ *  \param pos Position of the node in data, on return the position after
+ *         the node.
+ *  \param filename Name of the XML file the tree was read from.
+ *  \return The tree, or NULL if the data is invalid.
+ */
+XMLNode *XMLNode::load(const std::string &data, size_t *pos,
+                       const std::string &filename)
+{
+    auto get_uint32 = [&data, pos](uint32_t *value)
+    {
+        if (data.size() - *pos < sizeof(*value))
+            return false;
+        memcpy(value, data.data() + *pos, sizeof(*value));
+        *pos += sizeof(*value);
+        return true;
+    };
+    auto get_string = [&data, pos, &get_uint32](std::string *s)
+    {
+        uint32_t len;
+        if (!get_uint32(&len) || data.size() - *pos < len)
+            return false;
+        s->assign(data, *pos, len);
+        *pos += len;
+        return true;
+    };
+
+    XMLNode *node = new XMLNode();
+    node->m_file_name = filename;
+    uint32_t count;
+    if (!get_string(&node->m_name) || !get_uint32(&count))
+    {
+        delete node;
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string name, value;
+        if (!get_string(&name) || !get_string(&value))
+        {
+            delete node;
+            return NULL;
+        }
+        node->m_attributes[name] = StringUtils::utf8ToWide(value);
+    }
+    if (!get_uint32(&count))
+    {
+        delete node;
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        XMLNode *child = load(data, pos, filename);
+        if (!child)
+        {
+            delete node;
+            return NULL;
+        }
+        node->m_nodes.push_back(child);
+    }
+    return node;
+}   // load
+
 // ----------------------------------------------------------------------------
 /** Returns the i.th node.
  *  \param i Number of node to return.
@@ -55,9 +55,12 @@ private:
     std::vector<XMLNode *>               m_nodes;
 
     void readXML(io::IXMLReader *xml);
+    void readRootElement(io::IXMLReader *xml);
 
     std::string                          m_file_name;
 
+         XMLNode() {}
+
 public:
          LEAK_CHECK();
          XMLNode(io::IXMLReader *xml);
@@ -65,8 +68,14 @@ public:
          /** \throw runtime_error if the file is not found */
          XMLNode(const std::string &filename);
 
+         XMLNode(io::IXMLReader *xml, const std::string &filename);
+
         ~XMLNode();
 
+    void               save(std::string *out) const;
+    static XMLNode    *load(const std::string &data, size_t *pos,
+                            const std::string &filename);
+
     const std::string &getName() const {return m_name; }
     const XMLNode     *getNode(const std::string &name) const;
     const void         getNodes(const std::string &s, std::vector<XMLNode*>& out) const;
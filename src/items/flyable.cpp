@@ -415,6 +415,24 @@ void Flyable::updateGraphics(float dt)
     Moveable::updateGraphics();
 }   // updateGraphics
 
+//-----------------------------------------------------------------------------
+/** Adds the terrain raycast which the next updateAndDelete() will do to a
+ *  batch, so that the rays of all flyables can be cast together.
+ */
+void Flyable::addTerrainRay(RaycastBatch *batch)
+{
+    if (!m_do_terrain_info || hasAnimation() || m_has_hit_something)
+        return;
+    // The same position as Moveable::update will set
+    btTransform trans = getTrans();
+    if (m_body->getInvMass() != 0)
+        m_motion_state->getWorldTransform(trans);
+    const Vec3 xyz = trans.getOrigin();
+    Vec3 towards = MiniGLM::decompressVector3(m_compressed_gravity_vector);
+    TerrainInfo::addToBatch(batch, xyz + m_position_offset*(-towards),
+                            towards);
+}   // addTerrainRay
+
 //-----------------------------------------------------------------------------
 /** Updates this flyable. It calls Moveable::update. If this function returns
  *  true, the flyable will be deleted by the projectile manager.
@@ -652,14 +670,14 @@ void Flyable::moveToInfinity(bool set_moveable_trans)
 }   // moveToInfinity
 
 // ----------------------------------------------------------------------------
-BareNetworkString* Flyable::saveState(std::vector<std::string>* ru)
+bool Flyable::saveState(BareNetworkString* buffer,
+                        std::vector<std::string>* ru)
 {
     if (m_has_hit_something)
-        return NULL;
+        return false;
 
     ru->push_back(getUniqueIdentity());
 
-    BareNetworkString* buffer = new BareNetworkString();
     uint16_t ticks_since_thrown_animation = (m_ticks_since_thrown & 32767) |
         (hasAnimation() ? 32768 : 0);
     buffer->addUInt16(ticks_since_thrown_animation);
@@ -673,7 +691,7 @@ BareNetworkString* Flyable::saveState(std::vector<std::string>* ru)
         CompressNetworkBody::compress(
             m_body.get(), m_motion_state.get(), buffer);
     }
-    return buffer;
+    return true;
 }   // saveState
 
 // ----------------------------------------------------------------------------
@@ -407,6 +407,11 @@ public:
     /** Returns the index of the graph node this item is on. */
     virtual int getGraphNode() const OVERRIDE { return m_graph_node; }
     // ------------------------------------------------------------------------
+    /** Returns the largest distance between the item and a kart for which
+     *  hitKart can return true. The vertical distance in hitKart is halved,
+     *  so a kart above the item can be up to twice as far away. */
+    float getHitRadius() const   { return 2.0f * sqrtf(m_distance_2); }
+    // ------------------------------------------------------------------------
     /** Returns the distance from center: negative means left of center,
      *  positive means right of center. */
     virtual float getDistanceFromCenter() const OVERRIDE
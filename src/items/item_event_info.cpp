@@ -18,6 +18,7 @@
 
 #include "items/item_event_info.hpp"
 
+#include "network/bit_network_string.hpp"
 #include "network/network_config.hpp"
 #include "network/protocols/game_protocol.hpp"
 #include "network/rewind_manager.hpp"
@@ -80,3 +81,58 @@ void ItemEventInfo::saveState(BareNetworkString *buffer)
             buffer->addUInt16(m_ticks_till_return);
     }
 }   // saveState
+
+//-----------------------------------------------------------------------------
+/** Loads an event from a bit packed state.
+ *  \param reader The reader of the state.
+ *  \param previous_ticks Time of the previous event in this state, the time
+ *         of this event is stored relative to it. Updated to the time of
+ *         this event on return.
+ */
+ItemEventInfo::ItemEventInfo(BitNetworkReader *reader, int *previous_ticks)
+{
+    m_ticks_till_return = 0;
+    m_type = (EventType)reader->getBits(2);
+    m_ticks = *previous_ticks + reader->getVarInt();
+    *previous_ticks = m_ticks;
+    if (m_type != IEI_SWITCH)
+    {
+        m_kart_id = (int8_t)reader->getBits(8);
+        m_index = reader->getVarUInt();
+        if (m_type == IEI_NEW)
+        {
+            m_xyz = reader->getVec3();
+            m_normal = reader->getVec3();
+        }
+        else   // IEI_COLLECT
+            m_ticks_till_return = (int16_t)reader->getVarInt();
+    }   // is not switch
+    else   // switch
+    {
+        m_index = -1;
+        m_kart_id = -1;
+    }
+}   // ItemEventInfo(BitNetworkReader, int *previous_ticks)
+
+//-----------------------------------------------------------------------------
+/** Stores this event in a bit packed state, see the constructor above.
+ */
+void ItemEventInfo::saveState(BitNetworkWriter *writer, int *previous_ticks)
+{
+    assert(NetworkConfig::get()->isServer());
+    writer->addBits(m_type, 2);
+    writer->addVarInt(m_ticks - *previous_ticks);
+    *previous_ticks = m_ticks;
+    if (m_type != IEI_SWITCH)
+    {
+        writer->addBits((uint8_t)m_kart_id, 8);
+        writer->addVarUInt(m_index);
+        if (m_type == IEI_NEW)
+        {
+            writer->addVec3(m_xyz);
+            writer->addVec3(m_normal);
+        }
+        else if (m_type == IEI_COLLECT)
+            writer->addVarInt(m_ticks_till_return);
+    }
+}   // saveState
@@ -26,6 +26,8 @@
 #include <assert.h>
 
 class BareNetworkString;
+class BitNetworkReader;
+class BitNetworkWriter;
 
 // ------------------------------------------------------------------------
 /** This class stores a delta, i.e. an item event (either collection of
@@ -95,7 +97,9 @@ public:
 
     // --------------------------------------------------------------------
          ItemEventInfo(BareNetworkString *buffer, int *count);
+         ItemEventInfo(BitNetworkReader *reader, int *previous_ticks);
     void saveState(BareNetworkString *buffer);
+    void saveState(BitNetworkWriter *writer, int *previous_ticks);
 
     // --------------------------------------------------------------------
     /** Returns if this event represents a new item. */
@@ -165,6 +165,7 @@ void ItemManager::removeTextures()
 ItemManager::ItemManager()
 {
     m_switch_ticks = -1;
+    m_max_hit_radius = 0.0f;
     // The actual loading is done in loadDefaultItems
 
     // Prepare the switch to array, which stores which item should be
@@ -253,6 +254,7 @@ void ItemManager::insertItemInQuad(Item *item)
 {
     if(m_items_in_quads)
     {
+        m_max_hit_radius = std::max(m_max_hit_radius, item->getHitRadius());
         int graph_node = item->getGraphNode();
         // If the item is on the graph, store it at the appropriate index
         if(graph_node > -1)
@@ -376,27 +378,41 @@ void ItemManager::collectedItem(ItemState *item, AbstractKart *kart)
 //-----------------------------------------------------------------------------
 /** Checks if any item was collected by the given kart. This function calls
  *  collectedItem if an item was collected.
+ *  If there is a graph, only the items on the quads close to the kart and
+ *  the items not on any quad are tested. An item on a quad can only be hit
+ *  if the kart is less than m_max_hit_radius away from that quad.
  *  \param kart Pointer to the kart.
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
-
     /** Disable item collection detection for debug purposes. */
     if(m_disable_item_collection) return;
 
     // Spare tire karts don't collect items
     if ( dynamic_cast<SpareTireAI*>(kart->getController()) ) return;
 
-    for(AllItemTypes::iterator i =m_all_items.begin();
-                               i!=m_all_items.end();  i++)
+    if (!m_items_in_quads)
+    {
+        checkItemHit(kart, m_all_items);
+        return;
+    }
+
+    Graph::get()->findNodesInRadius(kart->getXYZ(), m_max_hit_radius,
+                                    &m_nodes_near_kart);
+    for (int node : m_nodes_near_kart)
+        checkItemHit(kart, (*m_items_in_quads)[node]);
+    checkItemHit(kart, m_items_in_quads->back());
+}   // checkItemHit
+
+//-----------------------------------------------------------------------------
+/** Checks if any of the given items was collected by the given kart.
+ *  \param kart Pointer to the kart.
+ *  \param items The items to test.
+ */
+void  ItemManager::checkItemHit(AbstractKart* kart, const AllItemTypes &items)
+{
+    for(AllItemTypes::const_iterator i =items.begin();
+                                     i!=items.end();  i++)
     {
         // Ignore items that have been collected or are not available atm
         if ((!*i) || !(*i)->isAvailable() || (*i)->isUsedUp()) continue;
@@ -416,7 +432,7 @@ void  ItemManager::checkItemHit(AbstractKart* kart)
         {
             collectedItem(*i, kart);
         }   // if hit
-    }   // for m_all_items
+    }   // for items
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
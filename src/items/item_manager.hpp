@@ -110,6 +110,13 @@ private:
      *  field is undefined if no Graph exist, e.g. arena without navmesh. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** The largest Item::getHitRadius of all items in m_items_in_quads. */
+    float m_max_hit_radius;
+
+    /** Temporary list of the quads close to a kart in checkItemHit, kept
+     *  here to avoid allocating memory for each kart. */
+    std::vector<int> m_nodes_near_kart;
+
     /** Stores all item models. */
     static std::vector<scene::IMesh *> m_item_mesh;
 
@@ -140,6 +147,8 @@ public:
     void           update          (int ticks);
     void           updateGraphics  (float dt);
     void           checkItemHit    (AbstractKart* kart);
+    void           checkItemHit    (AbstractKart* kart,
+                                    const AllItemTypes &items);
     void           reset           ();
     virtual void   collectedItem   (ItemState *item, AbstractKart *kart);
     virtual void   switchItems     ();
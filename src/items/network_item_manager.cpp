@@ -20,6 +20,7 @@
 
 #include "karts/abstract_kart.hpp"
 #include "modes/world.hpp"
+#include "network/bit_network_string.hpp"
 #include "network/network_config.hpp"
 #include "network/protocols/game_protocol.hpp"
 #include "network/rewind_manager.hpp"
@@ -223,7 +224,8 @@ void NetworkItemManager::setItemConfirmationTime(std::weak_ptr<STKPeer> peer,
  *  to save the initial state, which is the first confirmed state by all
  *  clients.
  */
-BareNetworkString* NetworkItemManager::saveState(std::vector<std::string>* ru)
+bool NetworkItemManager::saveState(BareNetworkString* s,
+                                   std::vector<std::string>* ru)
 {
     ru->push_back(getUniqueIdentity());
     // On the server:
@@ -232,20 +234,27 @@ BareNetworkString* NetworkItemManager::saveState(std::vector<std::string>* ru)
     uint16_t n = (uint16_t)m_item_events.getData().size();
     if(n==0)
     {
-        BareNetworkString *s = new BareNetworkString();
         m_item_events.unlock();
-        return s;
+        return true;
     }
 
-    BareNetworkString *s =
-        new BareNetworkString(n * (  sizeof(int) + sizeof(uint16_t)
-                                   + sizeof(uint8_t)              ) );
-    for (auto p : m_item_events.getData())
+    if (NetworkConfig::get()->usePackedState())
     {
-        p.saveState(s);
+        BitNetworkWriter writer(s);
+        writer.addVarUInt(n);
+        int previous_ticks = 0;
+        for (auto p : m_item_events.getData())
+            p.saveState(&writer, &previous_ticks);
+    }
+    else
+    {
+        for (auto p : m_item_events.getData())
+        {
+            p.saveState(s);
+        }
     }
     m_item_events.unlock();
-    return s;
+    return true;
 }   // saveState
 
 //-----------------------------------------------------------------------------
@@ -361,11 +370,20 @@ void NetworkItemManager::restoreState(BareNetworkString *buffer, int count)
     // Note that the actual ItemManager states must NOT be changed here, only
     // the confirmed states in the Network manager are allowed to be modified.
     // They will all be copied to the ItemManager states after the loop.
-    while(count > 0)
+    // A bit packed state starts with the number of events
+    const bool packed = NetworkConfig::get()->usePackedState();
+    BitNetworkReader reader(buffer);
+    unsigned num_events = packed && count > 0 ? reader.getVarUInt() : 0;
+    int previous_ticks = 0;
+    while(packed ? num_events > 0 : count > 0)
     {
         // 1.1) Decode the event in the message
         // ------------------------------------
-        ItemEventInfo iei(buffer, &count);
+        ItemEventInfo iei = packed ?
+            ItemEventInfo(&reader, &previous_ticks) :
+            ItemEventInfo(buffer, &count);
+        if (packed)
+            num_events--;
         if(m_network_item_debugging)
             Log::info("NIM", "Rewindto %d current %d iei.index %d iei tick %d iei.coll %d iei.new %d iei.ttr %d confirmed %lx",
                       rewind_to_time, current_time,
@@ -484,6 +502,16 @@ void NetworkItemManager::restoreState(BareNetworkString *buffer, int count)
         ItemState *item     = m_all_items[i];
         const ItemState *is = i < m_confirmed_state.size() 
                             ? m_confirmed_state[i] : NULL;
+        // If the index is used for an item at a different location (e.g.
+        // a bubble gum dropped by a different kart than predicted), replace
+        // the item, so that it is stored in the list of the right quad.
+        if (is && item && is->getXYZ() != item->getXYZ())
+        {
+            deleteItemInQuad(item);
+            delete item;
+            item = NULL;
+            m_all_items[i] = NULL;
+        }
         // For every *(ItemState*)item = *is, all deactivated ticks, item id
         // ... will be copied from item state to item
         if (is && item)
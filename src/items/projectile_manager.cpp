@@ -107,6 +107,13 @@ void ProjectileManager::update(int ticks)
 /** Updates all rockets on the server (or no networking). */
 void ProjectileManager::updateServer(int ticks)
 {
+    for (auto& p : m_active_projectiles)
+    {
+        if (p.second->hasServerState())
+            p.second->addTerrainRay(&m_raycast_batch);
+    }
+    m_raycast_batch.run(World::getWorld()->getWorkerPool());
+
     auto p = m_active_projectiles.begin();
     while (p != m_active_projectiles.end())
     {
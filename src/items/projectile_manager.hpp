@@ -30,6 +30,7 @@ namespace irr
 }
 
 #include "items/powerup_manager.hpp"
+#include "tracks/raycast_batch.hpp"
 #include "utils/no_copy.hpp"
 
 class AbstractKart;
@@ -55,6 +56,9 @@ private:
      *  being shown or have a sfx playing. */
     HitEffects       m_active_hit_effects;
 
+    /** Used to do the terrain raycasts of all projectiles together. */
+    RaycastBatch     m_raycast_batch;
+
     std::string      getUniqueIdentity(AbstractKart* kart,
                                        PowerupManager::PowerupType type);
     void             updateServer(int ticks);
@@ -46,6 +46,7 @@ class KartModel;
 class KartProperties;
 class Material;
 class Powerup;
+class RaycastBatch;
 class RenderInfo;
 class SFXBuffer;
 class Skidding;
@@ -498,6 +499,16 @@ public:
     /** Returns the position 0.25s before */
     virtual const Vec3& getPreviousXYZ() const = 0;
     // ------------------------------------------------------------------------
+    /** Updates the part of the kart state which is used by controllers.
+     *  Called for all karts before any kart is updated, so that all
+     *  controllers can decide on their commands based on the same state.
+     *  update() will then only do the remaining work. */
+    virtual void updateBeforeController(int ticks) {}
+    // ------------------------------------------------------------------------
+    /** Adds the terrain raycast which the next update() will do to a batch,
+     *  called after updateBeforeController(). */
+    virtual void addTerrainRay(RaycastBatch *batch) {}
+    // ------------------------------------------------------------------------
     /** Returns the most recent different previous position */
     virtual const Vec3& getRecentPreviousXYZ() const = 0;
     // ------------------------------------------------------------------------
@@ -79,6 +79,13 @@ public:
     virtual bool  disableSlipstreamBonus() const = 0;
     virtual bool  saveState(BareNetworkString *buffer) const = 0;
     virtual void  rewindTo(BareNetworkString *buffer) = 0;
+    // ------------------------------------------------------------------------
+    /** Called for all karts before any controller is updated, and in
+     *  parallel for different karts. A controller can decide on its next
+     *  commands here, which update() then applies. Since all karts think
+     *  at the same time, it must only read the state of the world, and only
+     *  change data of this controller. */
+    virtual void  think              (int ticks) {}
 
     // ---------------------------------------------------------------------------
     /** Sets the controller name for this controller. */
@@ -21,6 +21,9 @@
 #include "karts/controller/kart_control.hpp"
 #include "modes/world.hpp"
 
+#include <algorithm>
+#include <climits>
+
 GhostController::GhostController(AbstractKart *kart, core::stringw display_name)
                 : Controller(kart)
 {
@@ -41,6 +44,13 @@ void GhostController::update(int ticks)
     // Find (if necessary) the next index to use
     if (m_current_time != 0.0f)
     {
+        // If the time went back or skipped whole chunks, start from the
+        // chunk containing the current time
+        const unsigned int chunk_start = getChunkStart(m_current_time);
+        if (chunk_start > m_current_index ||
+            (m_current_index < m_all_times.size() &&
+             m_current_time < m_all_times[m_current_index]))
+            m_current_index = chunk_start;
         while (m_current_index + 1 < m_all_times.size() &&
                m_current_time >= m_all_times[m_current_index + 1])
         {
@@ -69,6 +79,21 @@ void GhostController::update(int ticks)
 
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Returns the index of the first event in the chunk containing the given
+ *  time, or 0 if the replay has no chunks.
+ */
+unsigned int GhostController::getChunkStart(float time) const
+{
+    auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(),
+                               std::make_pair(time, (unsigned int)UINT_MAX));
+    if (it == m_chunks.begin())
+        return 0;
+    return std::min((--it)->second,
+                    m_all_times.empty() ? 0u :
+                    (unsigned int)m_all_times.size() - 1);
+}   // getChunkStart
+
 //-----------------------------------------------------------------------------
 void GhostController::addReplayTime(float time)
 {
@@ -22,6 +22,7 @@
 #include "karts/controller/controller.hpp"
 #include "states_screens/state_manager.hpp"
 
+#include <utility>
 #include <vector>
 
 /** A class for Ghost controller.
@@ -43,6 +44,14 @@ private:
     /** The list of the times at which the events of kart were reached. */
     std::vector<float> m_all_times;
 
+    /** For binary replays the time of the first event of each chunk and the
+     *  index of that event in m_all_times, which allows to find the current
+     *  event after a jump in time without going through all events. */
+    std::vector<std::pair<float, unsigned int> > m_chunks;
+
+    // ------------------------------------------------------------------------
+    unsigned int getChunkStart(float time) const;
+
 public:
              GhostController(AbstractKart *kart, core::stringw display_name);
     virtual ~GhostController() {};
@@ -68,6 +77,13 @@ public:
 
     void         addReplayTime(float time);
     // ------------------------------------------------------------------------
+    /** Called before the events of a chunk of a binary replay are added.
+     *  \param time Time of the first event in the chunk. */
+    void         addReplayChunk(float time)
+    {
+        m_chunks.emplace_back(time, (unsigned int)m_all_times.size());
+    }   // addReplayChunk
+    // ------------------------------------------------------------------------
     bool         isReplayEnd() const
                          { return m_current_index + 1 >= m_all_times.size(); }
     // ------------------------------------------------------------------------
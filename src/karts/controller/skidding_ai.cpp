@@ -176,6 +176,10 @@ void SkiddingAI::reset()
     m_skid_probability_state     = SKID_PROBAB_NOT_YET;
     m_last_item_random           = NULL;
     m_burster                    = false;
+    m_has_thought                = false;
+    m_speed_cap                  = 1.0f;
+    m_random_skid.seed(rand());
+    m_random_collect_item.seed(rand());
 
     AIBaseLapController::reset();
     m_track_node               = Graph::UNKNOWN_SECTOR;
@@ -222,6 +226,9 @@ unsigned int SkiddingAI::getNextSector(unsigned int index)
 void SkiddingAI::update(int ticks)
 {
     float dt = stk_config->ticks2Time(ticks);
+    // Only use the controls computed by think() in this update
+    const bool has_thought = m_has_thought;
+    m_has_thought = false;
     m_controls->setRescue(false);
 
     // This is used to enable firing an item backwards.
@@ -312,6 +319,63 @@ void SkiddingAI::update(int ticks)
         return;
     }
 
+    if (has_thought)
+        *m_controls = m_thought_controls;
+    else
+        computeControls(ticks);
+
+    m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
+                        m_speed_cap, /*fade_in_time*/0);
+    handleRescue(dt);
+
+    // Make sure that not all AI karts use the zipper at the same
+    // time in time trial at start up, so disable it during the 5 first seconds
+    if(race_manager->getMinorMode()== RaceManager::MINOR_MODE_TIME_TRIAL &&
+        (m_world->getTime()<5.0f) )
+    {
+        m_controls->setFire(false);
+    }
+
+    /*And obviously general kart stuff*/
+    AIBaseLapController::update(ticks);
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Computes the controls for the next update() in parallel with the other
+ *  AIs. It is skipped in all cases in which update() changes the state of
+ *  the world before deciding on the controls, e.g. by starting a rescue.
+ *  Since all changes are done on a copy of the kart controls, and random
+ *  numbers are taken from the generators of this AI, the result does not
+ *  depend on the order in which the AIs think.
+ */
+void SkiddingAI::think(int ticks)
+{
+    m_has_thought = false;
+    if (m_superpower == RaceManager::SUPERPOWER_NOLOK_BOSS ||
+        m_kart->getKartAnimation() || isStuck() || m_world->isStartPhase())
+        return;
+
+    // Start with the same controls as update() would
+    m_thought_controls = *m_controls;
+    m_thought_controls.setRescue(false);
+    m_thought_controls.setLookBack(false);
+    m_thought_controls.setNitro(false);
+
+    KartControl *controls = m_controls;
+    m_controls = &m_thought_controls;
+    computeControls(ticks);
+    m_controls = controls;
+    m_has_thought = true;
+}   // think
+
+//-----------------------------------------------------------------------------
+/** Decides on the controls of the kart. This only changes data of this AI,
+ *  so it can be called by think() in parallel for all AIs.
+ */
+void SkiddingAI::computeControls(int ticks)
+{
+    float dt = stk_config->ticks2Time(ticks);
+
     // Get information that is needed by more than 1 of the handling funcs
     computeNearestKarts();
 
@@ -321,12 +385,8 @@ void SkiddingAI::update(int ticks)
     if (m_kart->getBoostAI())
         position_among_ai = 1;
 
-    float speed_cap = m_ai_properties->getSpeedCap(m_distance_to_player,
-                                                   position_among_ai,
-                                                   num_ai);
-
-    m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
-                        speed_cap, /*fade_in_time*/0);
+    m_speed_cap = m_ai_properties->getSpeedCap(m_distance_to_player,
+                                               position_among_ai, num_ai);
 
     //Detect if we are going to crash with the track and/or kart
     checkCrashes(m_kart->getXYZ());
@@ -335,19 +395,7 @@ void SkiddingAI::update(int ticks)
     /*Response handling functions*/
     handleAccelerationAndBraking(ticks);
     handleSteering(dt);
-    handleRescue(dt);
-
-    // Make sure that not all AI karts use the zipper at the same
-    // time in time trial at start up, so disable it during the 5 first seconds
-    if(race_manager->getMinorMode()== RaceManager::MINOR_MODE_TIME_TRIAL &&
-        (m_world->getTime()<5.0f) )
-    {
-        m_controls->setFire(false);
-    }
-
-    /*And obviously general kart stuff*/
-    AIBaseLapController::update(ticks);
-}   // update
+}   // computeControls
 
 //-----------------------------------------------------------------------------
 /** Decides in which direction to steer. If the kart is off track, it will
@@ -660,7 +708,7 @@ void SkiddingAI::handleItemCollectionAndAvoidance(Vec3 *aim_point,
         {
             int p = (int)(100.0f*m_ai_properties->
                           getItemCollectProbability(m_distance_to_player));
-            m_really_collect_item = m_random_collect_item.get(100)<p;
+            m_really_collect_item = (int)(m_random_collect_item() % 100)<p;
             m_last_item_random = items_to_collect[0];
         }
         if(!m_really_collect_item)
@@ -1098,8 +1146,10 @@ void SkiddingAI::handleItems(const float dt, const Vec3 *aim_point, int last_nod
                 m_time_since_last_shot = 3.0f;
             else
             {
-                // to make things less predictable :)
-                m_time_since_last_shot = (rand() % 1000) / 1000.0f * 3.0f - 2.0f;
+                // to make things less predictable :) This runs in think(),
+                // so use the generator of this AI instead of rand()
+                m_time_since_last_shot =
+                    (m_random_skid() % 1000) / 1000.0f * 3.0f - 2.0f;
             }
         }
         else
@@ -1121,7 +1171,7 @@ void SkiddingAI::handleItems(const float dt, const Vec3 *aim_point, int last_nod
     if(item_skill == 1)
     {
         int random_t = 0;
-        random_t = m_random_skid.get(6); //Reuse the random skid generator
+        random_t = (int)(m_random_skid() % 6); //Reuse the random skid generator
         random_t = random_t + 5;
           
         if( m_time_since_last_shot > random_t )
@@ -3027,7 +3077,7 @@ void SkiddingAI::setSteering(float angle, float dt)
         {
             int prob = (int)(100.0f*m_ai_properties
                                ->getSkiddingProbability(m_distance_to_player));
-            int r = m_random_skid.get(100);
+            int r = (int)(m_random_skid() % 100);
             m_skid_probability_state = (r<prob)
                                      ? SKID_PROBAB_SKID
                                      : SKID_PROBAB_NO_SKID;
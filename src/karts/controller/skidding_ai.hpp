@@ -44,11 +44,12 @@
 
 
 #include "karts/controller/ai_base_lap_controller.hpp"
+#include "karts/controller/kart_control.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/drive_node.hpp"
-#include "utils/random_generator.hpp"
 
 #include <line3d.h>
+#include <random>
 
 class ItemState;
 class LinearWorld;
@@ -193,8 +194,9 @@ private:
     /** This bool allows to make the AI use nitro by series of two bursts */
     bool m_burster;
 
-    /** A random number generator to decide if the AI should skid or not. */
-    RandomGenerator m_random_skid;
+    /** A random number generator to decide if the AI should skid or not.
+     *  Each AI has its own generator, since think() runs in parallel. */
+    std::mt19937 m_random_skid;
 
     /** This implements a simple finite state machine: it starts in
      *  NOT_YET. The first time the AI decides to skid, the state is changed
@@ -218,7 +220,17 @@ private:
     bool m_really_collect_item;
 
     /** A random number generator for collecting items. */
-    RandomGenerator m_random_collect_item;
+    std::mt19937 m_random_collect_item;
+
+    /** The controls computed in think(), which are applied in update(). */
+    KartControl m_thought_controls;
+
+    /** True if think() has computed the controls for the next update(). */
+    bool m_has_thought;
+
+    /** The maximum speed fraction (for rubber-banding) computed together
+     *  with the controls. */
+    float m_speed_cap;
 
     /** \brief Determines the algorithm to use to select the point-to-aim-for
      *  There are two different Point Selection Algorithms:
@@ -254,6 +266,7 @@ private:
      *specific action (more like, associated with inaction).
      */
     void  handleRaceStart();
+    void  computeControls(int ticks);
     void  handleAccelerationAndBraking(int ticks);
     void  handleSteering(float dt);
     int   computeSkill(SkillType type);
@@ -300,6 +313,7 @@ public:
                  SkiddingAI(AbstractKart *kart);
                 ~SkiddingAI();
     virtual void update      (int ticks);
+    virtual void think       (int ticks);
     virtual void reset       ();
     virtual const irr::core::stringw& getNamePostfix() const;
 };
@@ -59,6 +59,12 @@ public:
     virtual void  updateGraphics(float dt) OVERRIDE;
     virtual void  reset() OVERRIDE;
     // ------------------------------------------------------------------------
+    /** The ghost controller does all updates in update(). */
+    virtual void  updateBeforeController(int ticks) OVERRIDE {};
+    // ------------------------------------------------------------------------
+    /** Ghost karts don't use terrain information. */
+    virtual void  addTerrainRay(RaycastBatch *batch) OVERRIDE {};
+    // ------------------------------------------------------------------------
     /** No physics for ghost kart. */
     virtual void  applyEngineForce (float force) OVERRIDE {};
     // ------------------------------------------------------------------------
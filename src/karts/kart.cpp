@@ -137,6 +137,8 @@ Kart::Kart (const std::string& ident, unsigned int world_kart_id,
     m_boosted_ai           = false;
     m_type                 = RaceManager::KT_AI;
     m_flying               = false;
+    m_updated_before_controller = false;
+    m_has_animation_before = false;
 
     m_xyz_history_size     = stk_config->time2Ticks(XYZ_HISTORY_TIME);
 
@@ -327,6 +329,7 @@ void Kart::reset()
     m_network_finish_check_ticks = 0;
     m_network_confirmed_finish_ticks = 0;
     m_enabled_network_spectator = false;
+    m_updated_before_controller = false;
     // Add karts back in case that they have been removed (i.e. in battle
     // mode) - but only if they actually have a body (e.g. ghost karts
     // don't have one).
@@ -1355,11 +1358,12 @@ void Kart::eliminate()
 }   // eliminate
 
 //-----------------------------------------------------------------------------
-/** Updates the kart in each time step. It updates the physics setting,
- *  particle effects, camera position, etc.
- *  \param dt Time step size.
+/** Updates the state of the kart which its controller uses to decide on
+ *  the kart controls (e.g. position and speed). This is called for all karts
+ *  before the controllers, and otherwise at the start of update().
+ *  \param ticks Number of physics time steps.
  */
-void Kart::update(int ticks)
+void Kart::updateBeforeController(int ticks)
 {
     if (m_network_finish_check_ticks > 0 &&
         World::getWorld()->getTicksSinceStart() >
@@ -1420,12 +1424,12 @@ void Kart::update(int ticks)
     }
 
     // This is to avoid a rescue immediately after an explosion
-    const bool has_animation_before = m_kart_animation != NULL;
+    m_has_animation_before = m_kart_animation != NULL;
     // A kart animation can change the xyz position. This needs to be done
     // before updating the graphical position (which is done in
     // Moveable::update() ), otherwise 'stuttering' can happen (caused by
     // graphical and physical position not being the same).
-    if (has_animation_before)
+    if (m_has_animation_before)
     {
         m_kart_animation->update(ticks);
     }
@@ -1487,6 +1491,55 @@ void Kart::update(int ticks)
     // based on the collision speed.
     m_body->setRestitution(m_kart_properties->getRestitution(fabsf(m_speed)));
 
+    m_updated_before_controller = true;
+}   // updateBeforeController
+
+//-----------------------------------------------------------------------------
+/** Returns the start of the raycast for terrain detection.
+ */
+Vec3 Kart::getTerrainRayStart() const
+{
+    if (m_has_animation_before)
+    {
+        // Use kart transform directly as wheel info is not updated when
+        // there is an animation
+        return getXYZ() + getTrans().getBasis().getColumn(1) * 0.1f;
+    }
+
+    Vec3 from(0.0f, 0.0f, 0.0f);
+    for (unsigned int i = 0; i < 4; i++)
+        from += m_vehicle->getWheelInfo(i).m_raycastInfo.m_hardPointWS;
+
+    // Add a certain epsilon (0.3) to the height of the kart. This avoids
+    // problems of the ray being cast from under the track (which happened
+    // e.g. on tux tollway when jumping down from the ramp, when the chassis
+    // partly tunnels through the track). While tunneling should not be
+    // happening (since Z velocity is clamped), the epsilon is left in place
+    // just to be on the safe side (it will not hit the chassis itself).
+    return from/4 + (getTrans().getBasis() * Vec3(0.0f, 0.3f, 0.0f));
+}   // getTerrainRayStart
+
+//-----------------------------------------------------------------------------
+/** Adds the terrain raycast of the next update() to a batch, so that the
+ *  rays of all karts can be cast together.
+ */
+void Kart::addTerrainRay(RaycastBatch *batch)
+{
+    m_terrain_info->addToBatch(batch, getTrans().getBasis(),
+                               getTerrainRayStart());
+}   // addTerrainRay
+
+//-----------------------------------------------------------------------------
+/** Updates the kart in each time step. It updates the physics setting,
+ *  particle effects, camera position, etc.
+ *  \param dt Time step size.
+ */
+void Kart::update(int ticks)
+{
+    if (!m_updated_before_controller)
+        updateBeforeController(ticks);
+    m_updated_before_controller = false;
+
     m_controller->update(ticks);
 
 #ifndef SERVER_ONLY
@@ -1593,29 +1646,7 @@ void Kart::update(int ticks)
     // To avoid this problem, we do the raycast for terrain detection from
     // the center of the 4 wheel positions (in world coordinates).
 
-    if (!has_animation_before)
-    {
-        Vec3 from(0.0f, 0.0f, 0.0f);
-        for (unsigned int i = 0; i < 4; i++)
-            from += m_vehicle->getWheelInfo(i).m_raycastInfo.m_hardPointWS;
-
-        // Add a certain epsilon (0.3) to the height of the kart. This avoids
-        // problems of the ray being cast from under the track (which happened
-        // e.g. on tux tollway when jumping down from the ramp, when the chassis
-        // partly tunnels through the track). While tunneling should not be
-        // happening (since Z velocity is clamped), the epsilon is left in place
-        // just to be on the safe side (it will not hit the chassis itself).
-        from = from/4 + (getTrans().getBasis() * Vec3(0.0f, 0.3f, 0.0f));
-
-        m_terrain_info->update(getTrans().getBasis(), from);
-    }
-    else
-    {
-        // Use kart transform directly as wheel info is not updated when
-        // there is an animation
-        m_terrain_info->update(getTrans().getBasis(),
-            getXYZ() + getTrans().getBasis().getColumn(1) * 0.1f);
-    }
+    m_terrain_info->update(getTrans().getBasis(), getTerrainRayStart());
 
     if (m_body->getBroadphaseHandle())
     {
@@ -1647,7 +1678,7 @@ void Kart::update(int ticks)
         if (Track::getCurrentTrack()->isAutoRescueEnabled() &&
             (!m_terrain_info->getMaterial() ||
             !m_terrain_info->getMaterial()->hasGravity()) &&
-            !has_animation_before && fabs(roll) > 60 * DEGREE_TO_RAD &&
+            !m_has_animation_before && fabs(roll) > 60 * DEGREE_TO_RAD &&
             fabs(getSpeed()) < 3.0f)
         {
             RescueAnimation::create(this, /*is_auto_rescue*/true);
@@ -1749,7 +1780,7 @@ void Kart::update(int ticks)
         Track::getCurrentTrack()->getAABB(&min, &max);
 
         if((min->getY() - getXYZ().getY() > 17 || dist_to_sector > 25) && !m_flying &&
-           !has_animation_before)
+           !m_has_animation_before)
         {
             RescueAnimation::create(this);
             m_last_factor_engine_sound = 0.0f;
@@ -1757,7 +1788,7 @@ void Kart::update(int ticks)
     }
     else
     {
-        if (!has_animation_before && material->isDriveReset() && isOnGround())
+        if (!m_has_animation_before && material->isDriveReset() && isOnGround())
         {
             RescueAnimation::create(this);
             m_last_factor_engine_sound = 0.0f;
@@ -1788,7 +1819,7 @@ void Kart::update(int ticks)
 
     ItemManager::get()->checkItemHit(this);
 
-    const bool emergency = has_animation_before;
+    const bool emergency = m_has_animation_before;
 
     if (emergency)
     {
@@ -1806,7 +1837,7 @@ void Kart::update(int ticks)
     // is rescued isOnGround might still be true, since the kart rigid
     // body was removed from the physics, but still retain the old
     // values for the raycasts).
-    if (!isOnGround() && !has_animation_before)
+    if (!isOnGround() && !m_has_animation_before)
     {
         const Material *m      = getMaterial();
         const Material *last_m = getLastMaterial();
@@ -1841,7 +1872,7 @@ void Kart::update(int ticks)
         m_is_jumping = false;
         m_kart_model->setAnimation(KartModel::AF_DEFAULT);
 
-        if (!has_animation_before)
+        if (!m_has_animation_before)
         {
             HitEffect *effect =  new Explosion(getXYZ(), "jump",
                                               "jump_explosion.xml");
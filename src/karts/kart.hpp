@@ -100,6 +100,13 @@ protected:
 
     bool m_enabled_network_spectator;
 
+    /** True if updateBeforeController() was called for the current update,
+     *  so update() only has to do the remaining work. */
+    bool m_updated_before_controller;
+
+    /** True if the kart had an animation at the start of the update. */
+    bool m_has_animation_before;
+
     /** The sign of torque to apply after hitting a bubble gum. */
     bool        m_bubblegum_torque_sign;
 
@@ -291,6 +298,7 @@ protected:
     void          playCrashSFX(const Material* m, AbstractKart *k);
     void          loadData(RaceManager::KartType type, bool animatedModel);
     void          updateWeight();
+    Vec3          getTerrainRayStart() const;
 public:
                    Kart(const std::string& ident, unsigned int world_kart_id,
                         int position, const btTransform& init_transform,
@@ -342,6 +350,8 @@ public:
     virtual void   crashed          (const Material *m, const Vec3 &normal) OVERRIDE;
     virtual float  getHoT           () const OVERRIDE;
     virtual void   update           (int ticks) OVERRIDE;
+    virtual void   updateBeforeController(int ticks) OVERRIDE;
+    virtual void   addTerrainRay    (RaycastBatch *batch) OVERRIDE;
     virtual void   finishedRace     (float time, bool from_server=false) OVERRIDE;
     virtual void   setPosition      (int p) OVERRIDE;
     virtual void   beep             () OVERRIDE;
@@ -184,7 +184,9 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     // Get the default values from STKConfig. This will also allocate any
     // pointers used in KartProperties
 
-    const XMLNode* root = new XMLNode(filename);
+    const XMLNode* root = file_manager->createXMLTree(filename);
+    if (!root)
+        throw std::runtime_error("Cannot find file " + filename);
     std::string kart_type;
 
     if (root->get("type", &kart_type))
@@ -165,6 +165,19 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
         // --------------------------------------------
         std::set<std::string> result;
         file_manager->listFiles(result, *dir);
+
+        // Read the xml files of all karts in parallel, or from the manifest
+        // of this directory if they didn't change
+        std::vector<std::string> xml_files;
+        for (const std::string& subdir : result)
+        {
+            if (subdir == "." || subdir == "..")
+                continue;
+            xml_files.push_back(*dir + subdir + "/kart.xml");
+            xml_files.push_back(*dir + subdir + "/materials.xml");
+        }
+        file_manager->preloadXMLTrees(xml_files, "karts:" + *dir);
+
         for(std::set<std::string>::const_iterator subdir=result.begin();
             subdir!=result.end(); subdir++)
         {
@@ -178,6 +191,7 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
                                           );
             }
         }   // for all files in the currently handled directory
+        file_manager->clearPreloadedXMLTrees();
     }   // for i
 }   // loadAllKarts
 
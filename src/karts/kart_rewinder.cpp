@@ -31,6 +31,7 @@
 #include "karts/max_speed.hpp"
 #include "karts/skidding.hpp"
 #include "modes/world.hpp"
+#include "network/bit_network_string.hpp"
 #include "network/compress_network_body.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/rewind_manager.hpp"
@@ -149,21 +150,19 @@ void KartRewinder::computeError()
 }   // computeError
 
 // ----------------------------------------------------------------------------
-/** Saves all state information for a kart in a memory buffer. The memory
- *  is allocated here and the address returned. It will then be managed
- *  by the RewindManager.
+/** Appends all state information for a kart to the buffer provided by the
+ *  caller (which can already contain the states of other rewinders).
+ *  \param buffer The buffer to append the state to.
  *  \param[out] ru The unique identity of rewinder writing to.
- *  \return The address of the memory buffer with the state.
+ *  \return False if the kart is eliminated, no state is added then.
  */
-BareNetworkString* KartRewinder::saveState(std::vector<std::string>* ru)
+bool KartRewinder::saveState(BareNetworkString* buffer,
+                             std::vector<std::string>* ru)
 {
     if (m_eliminated)
-        return nullptr;
+        return false;
 
     ru->push_back(getUniqueIdentity());
-    const int MEMSIZE = 17*sizeof(float) + 9+3;
-
-    BareNetworkString *buffer = new BareNetworkString(MEMSIZE);
 
     // 1) Steering and other player controls
     // -------------------------------------
@@ -202,43 +201,88 @@ BareNetworkString* KartRewinder::saveState(std::vector<std::string>* ru)
         bool_for_each_data_2 |= (1 << 3);
     if (m_bubblegum_torque_sign)
         bool_for_each_data_2 |= (1 << 4);
-    buffer->addUInt8(bool_for_each_data_2);
+
+    // In bit packed states the flags, timers and physics values are written
+    // with the packer, which is flushed before the byte aligned data of the
+    // kart animation and the other kart parts
+    const bool packed = NetworkConfig::get()->usePackedState();
+    BitNetworkWriter packer(buffer);
+    auto add_ticks = [&](uint16_t ticks)
+    {
+        if (packed)
+            packer.addVarUInt(ticks);
+        else
+            buffer->addUInt16(ticks);
+    };
+    auto add_float = [&](float f)
+    {
+        if (packed)
+            packer.addFloat(f);
+        else
+            buffer->addFloat(f);
+    };
+
+    if (packed)
+    {
+        packer.addBits(bool_for_each_data, 8);
+        packer.addBits(bool_for_each_data_2, 5);
+    }
+    else
+        buffer->addUInt8(bool_for_each_data).addUInt8(bool_for_each_data_2);
 
     if (m_bubblegum_ticks > 0)
-        buffer->addUInt16(m_bubblegum_ticks);
+        add_ticks(m_bubblegum_ticks);
     if (m_view_blocked_by_plunger > 0)
-        buffer->addUInt16(m_view_blocked_by_plunger);
+        add_ticks(m_view_blocked_by_plunger);
     if (m_invulnerable_ticks > 0)
-        buffer->addUInt16(m_invulnerable_ticks);
+        add_ticks(m_invulnerable_ticks);
     if (getEnergy() > 0.0f)
-        buffer->addFloat(getEnergy());
+        add_float(getEnergy());
 
     // 3) Kart animation status or physics values (transform and velocities)
     // -------------------------------------------
     if (has_animation)
     {
+        packer.flush();
         buffer->addUInt8(m_kart_animation->getAnimationType());
         m_kart_animation->saveState(buffer);
     }
     else
     {
-        CompressNetworkBody::compress(
-            m_body.get(), m_motion_state.get(), buffer);
+        if (packed)
+        {
+            CompressNetworkBody::compressPacked(
+                m_body.get(), m_motion_state.get(), &packer);
+        }
+        else
+        {
+            CompressNetworkBody::compress(
+                m_body.get(), m_motion_state.get(), buffer);
+        }
 
         if (m_vehicle->getTimedRotationTicks() > 0)
         {
-            buffer->addUInt16(m_vehicle->getTimedRotationTicks());
-            buffer->addFloat(m_vehicle->getTimedRotation());
+            add_ticks(m_vehicle->getTimedRotationTicks());
+            add_float(m_vehicle->getTimedRotation());
         }
 
         // For collision rewind
         if (m_bounce_back_ticks > 0)
-            buffer->addUInt8(m_bounce_back_ticks);
+        {
+            if (packed)
+                packer.addVarUInt(m_bounce_back_ticks);
+            else
+                buffer->addUInt8(m_bounce_back_ticks);
+        }
         if (m_vehicle->getCentralImpulseTicks() > 0)
         {
-            buffer->addUInt16(m_vehicle->getCentralImpulseTicks());
-            buffer->add(m_vehicle->getAdditionalImpulse());
+            add_ticks(m_vehicle->getCentralImpulseTicks());
+            const Vec3& impulse = m_vehicle->getAdditionalImpulse();
+            add_float(impulse.getX());
+            add_float(impulse.getY());
+            add_float(impulse.getZ());
         }
+        packer.flush();
     }
 
     // 4) Attachment, powerup, nitro
@@ -256,7 +300,7 @@ BareNetworkString* KartRewinder::saveState(std::vector<std::string>* ru)
     // -----------
     m_skidding->saveState(buffer);
 
-    return buffer;
+    return true;
 }   // saveState
 
 // ----------------------------------------------------------------------------
@@ -276,7 +320,19 @@ void KartRewinder::restoreState(BareNetworkString *buffer, int count)
 
     // 2) Boolean handling to determine if need saving
     // -----------
-    uint8_t bool_for_each_data = buffer->getUInt8();
+    const bool packed = NetworkConfig::get()->usePackedState();
+    BitNetworkReader unpacker(buffer);
+    auto get_ticks = [&]() -> uint16_t
+    {
+        return packed ? (uint16_t)unpacker.getVarUInt() : buffer->getUInt16();
+    };
+    auto get_float = [&]() -> float
+    {
+        return packed ? unpacker.getFloat() : buffer->getFloat();
+    };
+
+    uint8_t bool_for_each_data =
+        packed ? (uint8_t)unpacker.getBits(8) : buffer->getUInt8();
     m_fire_clicked = (bool_for_each_data & 1) == 1;
     bool read_bubblegum = ((bool_for_each_data >> 1) & 1) == 1;
     bool read_plunger = ((bool_for_each_data >> 2) & 1) == 1;
@@ -286,7 +342,8 @@ void KartRewinder::restoreState(BareNetworkString *buffer, int count)
     bool read_timed_rotation =  ((bool_for_each_data >> 6) & 1) == 1;
     bool read_impulse = ((bool_for_each_data >> 7) & 1) == 1;
 
-    uint8_t bool_for_each_data_2 = buffer->getUInt8();
+    uint8_t bool_for_each_data_2 =
+        packed ? (uint8_t)unpacker.getBits(5) : buffer->getUInt8();
     bool controller_steer_sign = (bool_for_each_data_2 & 1) == 1;
     if (controller_steer_sign)
     {
@@ -300,23 +357,23 @@ void KartRewinder::restoreState(BareNetworkString *buffer, int count)
     m_bubblegum_torque_sign = ((bool_for_each_data_2 >> 4) & 1) == 1;
 
     if (read_bubblegum)
-        m_bubblegum_ticks = buffer->getUInt16();
+        m_bubblegum_ticks = get_ticks();
     else
         m_bubblegum_ticks = 0;
 
     if (read_plunger)
-        m_view_blocked_by_plunger = buffer->getUInt16();
+        m_view_blocked_by_plunger = get_ticks();
     else
         m_view_blocked_by_plunger = 0;
 
     if (read_invulnerable)
-        m_invulnerable_ticks = buffer->getUInt16();
+        m_invulnerable_ticks = get_ticks();
     else
         m_invulnerable_ticks = 0;
 
     if (read_energy)
     {
-        float nitro = buffer->getFloat();
+        float nitro = get_float();
         setEnergy(nitro);
     }
     else
@@ -369,16 +426,24 @@ void KartRewinder::restoreState(BareNetworkString *buffer, int count)
 
         // Clear any forces applied (like by plunger or bubble gum torque)
         m_body->clearForces();
-        CompressNetworkBody::decompress(
-            buffer, m_body.get(), m_motion_state.get());
+        if (packed)
+        {
+            CompressNetworkBody::decompressPacked(
+                &unpacker, m_body.get(), m_motion_state.get());
+        }
+        else
+        {
+            CompressNetworkBody::decompress(
+                buffer, m_body.get(), m_motion_state.get());
+        }
         // Update kart transform in case that there are access to its value
         // before Moveable::update() is called (which updates the transform)
         m_transform = m_body->getWorldTransform();
 
         if (read_timed_rotation)
         {
-            uint16_t time_rot = buffer->getUInt16();
-            float timed_rotation_y = buffer->getFloat();
+            uint16_t time_rot = get_ticks();
+            float timed_rotation_y = get_float();
             // Set timed rotation divides by time_rot
             m_vehicle->setTimedRotation(time_rot,
                 stk_config->ticks2Time(time_rot) * timed_rotation_y);
@@ -388,13 +453,19 @@ void KartRewinder::restoreState(BareNetworkString *buffer, int count)
 
         // Collision rewind
         if (read_bounce_back)
-            m_bounce_back_ticks = buffer->getUInt8();
+        {
+            m_bounce_back_ticks = packed ?
+                (uint8_t)unpacker.getVarUInt() : buffer->getUInt8();
+        }
         else
             m_bounce_back_ticks = 0;
         if (read_impulse)
         {
-            uint16_t central_impulse_ticks = buffer->getUInt16();
-            Vec3 additional_impulse = buffer->getVec3();
+            uint16_t central_impulse_ticks = get_ticks();
+            Vec3 additional_impulse;
+            additional_impulse.setX(get_float());
+            additional_impulse.setY(get_float());
+            additional_impulse.setZ(get_float());
             m_vehicle->setTimedCentralImpulse(central_impulse_ticks,
                 additional_impulse, true/*rewind*/);
         }
@@ -40,8 +40,10 @@ public:
     ~KartRewinder() {}
     virtual void saveTransform() OVERRIDE;
     virtual void computeError() OVERRIDE;
-    virtual BareNetworkString* saveState(std::vector<std::string>* ru)
-        OVERRIDE;
+    virtual float getRewindError() const OVERRIDE
+           { return m_kart_animation ? 0.0f : Moveable::getLastAdjustLength(); }
+    virtual bool saveState(BareNetworkString* buffer,
+                           std::vector<std::string>* ru) OVERRIDE;
     void reset() OVERRIDE;
     virtual void restoreState(BareNetworkString *p, int count) OVERRIDE;
     virtual void rewindToEvent(BareNetworkString *p) OVERRIDE {}
@@ -192,6 +192,7 @@
 #include "graphics/particle_kind_manager.hpp"
 #include "graphics/referee.hpp"
 #include "graphics/sp/sp_base.hpp"
+#include "graphics/sp/sp_frustum_culler.hpp"
 #include "graphics/sp/sp_shader.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
@@ -218,13 +219,17 @@
 #include "network/protocols/connect_to_server.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/protocols/server_lobby.hpp"
+#include "network/bit_network_string.hpp"
+#include "network/database_connector.hpp"
 #include "network/network_config.hpp"
 #include "network/network_string.hpp"
 #include "network/rewind_manager.hpp"
 #include "network/rewind_queue.hpp"
 #include "network/server.hpp"
 #include "network/server_config.hpp"
+#include "network/server_rooms.hpp"
 #include "network/servers_manager.hpp"
+#include "network/state_delta.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 #include "online/profile_manager.hpp"
@@ -255,6 +260,7 @@
 #include "utils/separate_process.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
+#include "utils/worker_pool.hpp"
 
 static void cleanSuperTuxKart();
 static void cleanUserConfig();
@@ -610,6 +616,8 @@ void cmdLineHelp()
     "       --wan-server=name  Start a Wan server (not a playing client).\n"
     "       --public-server    Allow direct connection to the server (without stk server)\n"
     "       --lan-server=name  Start a LAN server (not a playing client).\n"
+    "       --server-rooms=n   Host n servers on consecutive ports in one process\n"
+    "                          which share all loaded karts and tracks.\n"
     "       --server-password= Sets a password for a server (both client and server).\n"
     "       --connect-now=ip   Connect to a server with IP known now\n"
     "                          (in format x.x.x.x:xxx(port)), the port should be its\n"
@@ -651,6 +659,7 @@ void cmdLineHelp()
     "       --log=N            Set the verbosity to a value between\n"
     "                          0 (Debug) and 5 (Only Fatal messages)\n"
     "       --logbuffer=N      Buffers up to N lines log lines before writing.\n"
+    "       --async-log        Write log lines in a separate thread.\n"
     "       --root=DIR         Path to add to the list of STK root directories.\n"
     "                          You can specify more than one by separating them\n"
     "                          with colons (:).\n"
@@ -1313,6 +1322,8 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
         NetworkConfig::get()->setClientPort(n);
         ServerConfig::m_server_port = n;
     }
+    if (NetworkConfig::get()->isServer())
+        ServerRooms::setupRoom();
     if (CommandLine::has("--public-server"))
     {
         NetworkConfig::get()->setIsPublicServer();
@@ -1818,7 +1829,10 @@ void initRest()
     // The rest will be read later (since the rest needs the unlock- and
     // achievement managers to be created, which can only be created later).
     PlayerManager::create();
-    Online::RequestManager::get()->startNetworkThread();
+    // Server rooms start it after forking, since the forked processes only
+    // contain the forking thread
+    if (!ServerRooms::isEnabled())
+        Online::RequestManager::get()->startNetworkThread();
 #ifndef SERVER_ONLY
     if (!ProfileWorld::isNoGraphics())
         NewsManager::get();   // this will create the news manager
@@ -2068,6 +2082,11 @@ int main(int argc, char *argv[])
             ServerConfig::m_validating_player = false;
         }
 
+        int num_rooms = 0;
+        if (NetworkConfig::get()->isServer() &&
+            CommandLine::has("--server-rooms", &num_rooms))
+            ServerRooms::setNumRooms(num_rooms);
+
         if (!ProfileWorld::isNoGraphics())
             profiler.init();
         initRest();
@@ -2142,6 +2161,18 @@ int main(int argc, char *argv[])
         GUIEngine::addLoadingIcon( irr_driver->getTexture(FileManager::GUI_ICON,
                                                           "banana.png")    );
 
+        // All rooms share the assets which are loaded till now
+        if (ServerRooms::isEnabled())
+        {
+            if (!ServerRooms::startRooms())
+                exit(0);
+            Online::RequestManager::get()->startNetworkThread();
+        }
+
+        // The log writer thread must only be started after forking the rooms
+        if (CommandLine::has("--async-log"))
+            Log::startAsyncWriter();
+
         //handleCmdLine() needs InitTuxkart() so it can't be called first
         if (!handleCmdLine(!server_config.empty(), has_parent_process))
             exit(0);
@@ -2397,6 +2428,7 @@ int main(int argc, char *argv[])
     MemoryLeaks::checkForLeaks();
 #endif
 
+    Log::stopAsyncWriter();
     Log::flushBuffers();
 
 #ifndef WIN32
@@ -2556,12 +2588,24 @@ void runUnitTests()
     MiniGLM::unitTesting();
     Log::info("UnitTest", "GraphicsRestrictions");
     GraphicsRestrictions::unitTesting();
+    Log::info("UnitTest", "SPFrustumCuller");
+    SP::SPFrustumCuller::unitTesting();
     Log::info("UnitTest", "NetworkString");
     NetworkString::unitTesting();
+    Log::info("UnitTest", "StateDelta");
+    StateDelta::unitTesting();
+    Log::info("UnitTest", "BitNetworkWriter");
+    BitNetworkWriter::unitTesting();
+#ifdef ENABLE_SQLITE3
+    Log::info("UnitTest", "DatabaseConnector");
+    DatabaseConnector::unitTesting();
+#endif
     Log::info("UnitTest", "TransportAddress");
     TransportAddress::unitTesting();
     Log::info("UnitTest", "StringUtils::versionToInt");
     StringUtils::unitTesting();
+    Log::info("UnitTest", "WorkerPool");
+    WorkerPool::unitTesting();
 
     Log::info("UnitTest", "Easter detection");
     // Test easter mode: in 2015 Easter is 5th of April - check with 0 days
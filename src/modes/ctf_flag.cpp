@@ -21,6 +21,8 @@
 #include "graphics/sp/sp_mesh_node.hpp"
 #include "karts/abstract_kart.hpp"
 #include "modes/world.hpp"
+#include "network/bit_network_string.hpp"
+#include "network/network_config.hpp"
 #include "network/network_string.hpp"
 #include "utils/mini_glm.hpp"
 
@@ -30,10 +32,26 @@
 // Position offset to attach in kart model
 const Vec3 g_kart_flag_offset(0.0, 0.2f, -0.5f);
 // ============================================================================
-BareNetworkString* CTFFlag::saveState(std::vector<std::string>* ru)
+bool CTFFlag::saveState(BareNetworkString* buffer,
+                        std::vector<std::string>* ru)
 {
     ru->push_back(getUniqueIdentity());
-    BareNetworkString* buffer = new BareNetworkString();
+    if (NetworkConfig::get()->usePackedState())
+    {
+        BitNetworkWriter writer(buffer);
+        writer.addBits(m_flag_status + 2, 5);
+        writer.addVarUInt(m_deactivated_ticks);
+        if (m_flag_status == OFF_BASE)
+        {
+            // The compressed transform uses 24 bits for each coordinate
+            writer.addBits(m_off_base_compressed[0], 24);
+            writer.addBits(m_off_base_compressed[1], 24);
+            writer.addBits(m_off_base_compressed[2], 24);
+            writer.addBits(m_off_base_compressed[3], 32);
+            writer.addVarUInt(m_ticks_since_off_base);
+        }
+        return true;
+    }
     int flag_status_unsigned = m_flag_status + 2;
     flag_status_unsigned &= 31;
     // Max 2047 for m_deactivated_ticks set by resetToBase
@@ -47,13 +65,33 @@ BareNetworkString* CTFFlag::saveState(std::vector<std::string>* ru)
             .addUInt32(m_off_base_compressed[3]);
         buffer->addUInt16(m_ticks_since_off_base);
     }
-    return buffer;
+    return true;
 }   // saveState
 
 // ----------------------------------------------------------------------------
 void CTFFlag::restoreState(BareNetworkString* buffer, int count)
 {
     using namespace MiniGLM;
+    if (NetworkConfig::get()->usePackedState())
+    {
+        BitNetworkReader reader(buffer);
+        m_flag_status = (int8_t)((int)reader.getBits(5) - 2);
+        m_deactivated_ticks = (uint16_t)reader.getVarUInt();
+        if (m_flag_status == OFF_BASE)
+        {
+            // Restore the sign of the 24 bit coordinates
+            for (unsigned i = 0; i < 3; i++)
+            {
+                int c = (int)reader.getBits(24);
+                m_off_base_compressed[i] = c & 0x800000 ? c - 0x1000000 : c;
+            }
+            m_off_base_compressed[3] = (int)reader.getBits(32);
+            m_flag_trans = decompressbtTransform(m_off_base_compressed);
+            m_ticks_since_off_base = (uint16_t)reader.getVarUInt();
+        }
+        updateFlagTrans(m_flag_trans);
+        return;
+    }
     unsigned flag_status_unsigned = buffer->getUInt16();
     int flag_status = flag_status_unsigned & 31;
     m_flag_status = (int8_t)(flag_status - 2);
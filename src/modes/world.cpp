@@ -80,12 +80,14 @@
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <algorithm>
 #include <assert.h>
 #include <ctime>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 
 
 World* World::m_world = NULL;
@@ -142,6 +144,12 @@ World::World() : WorldStatus()
 
     m_stop_music_when_dialog_open = true;
 
+    // The main thread thinks for some of the karts too
+    const unsigned threads =
+        std::min(std::thread::hardware_concurrency(), 8u);
+    m_controller_pool.reset(new WorkerPool(threads > 1 ? threads - 1 : 0,
+        "KartThink"));
+
     WorldStatus::setClockMode(CLOCK_CHRONO);
 
 }   // World
@@ -1110,14 +1118,42 @@ void World::update(int ticks)
     // Update all the karts. This in turn will also update the controller,
     // which causes all AI steering commands set. So in the following 
     // physics update the new steering is taken into account.
+    // This is done in two phases: first the state of all karts used by
+    // the controllers is updated, and all controllers think in parallel
+    // based on this state, which is not changed while they think. So the
+    // result does not depend on the number of threads. Then the commands
+    // are applied and the rest of each kart is updated in kart order.
     const int kart_amount = (int)m_karts.size();
+    std::vector<AbstractKart*> updated_karts;
     for (int i = 0 ; i < kart_amount; ++i)
     {
         SpareTireAI* sta =
             dynamic_cast<SpareTireAI*>(m_karts[i]->getController());
         // Update all karts that are not eliminated
         if(!m_karts[i]->isEliminated() || (sta && sta->isMoving()))
+        {
+            m_karts[i]->updateBeforeController(ticks);
+            updated_karts.push_back(m_karts[i].get());
+        }
+    }
+    // Cast the terrain rays of all karts together
+    for (AbstractKart* kart : updated_karts)
+        kart->addTerrainRay(&m_raycast_batch);
+    m_raycast_batch.run(m_controller_pool.get());
+    m_controller_pool->run((unsigned)updated_karts.size(),
+        [&updated_karts, ticks](unsigned i)
+        {
+            updated_karts[i]->getController()->think(ticks);
+        });
+    unsigned next_updated = 0;
+    for (int i = 0 ; i < kart_amount; ++i)
+    {
+        if (next_updated < updated_karts.size() &&
+            updated_karts[next_updated] == m_karts[i].get())
+        {
             m_karts[i]->update(ticks);
+            next_updated++;
+        }
         if (isStartPhase())
             m_karts[i]->makeKartRest();
     }
@@ -36,6 +36,7 @@
 #include "race/highscores.hpp"
 #include "states_screens/race_gui_base.hpp"
 #include "states_screens/state_manager.hpp"
+#include "tracks/raycast_batch.hpp"
 #include "utils/random_generator.hpp"
 
 #include "LinearMath/btTransform.h"
@@ -47,6 +48,7 @@ class Controller;
 class ItemState;
 class PhysicalObject;
 class STKPeer;
+class WorkerPool;
 
 namespace Scripting
 {
@@ -113,6 +115,13 @@ protected:
     KartList                  m_karts;
     RandomGenerator           m_random;
 
+    /** Threads used in update(), e.g. to run think() of all kart
+     *  controllers and the terrain raycasts in parallel. */
+    std::unique_ptr<WorkerPool> m_controller_pool;
+
+    /** Used to do the terrain raycasts of all karts together. */
+    RaycastBatch m_raycast_batch;
+
     AbstractKart* m_fastest_kart;
     /** Number of eliminated karts. */
     int         m_eliminated_karts;
@@ -320,6 +329,10 @@ public:
     /** Returns all karts. */
     const KartList & getKarts() const { return m_karts; }
     // ------------------------------------------------------------------------
+    /** Returns the threads which can be used for parallel work during
+     *  update(). */
+    WorkerPool     *getWorkerPool() const { return m_controller_pool.get(); }
+    // ------------------------------------------------------------------------
     /** Returns the number of currently active (i.e.non-elikminated) karts. */
     unsigned int    getCurrentNumKarts() const { return (int)m_karts.size() -
                                                          m_eliminated_karts; }
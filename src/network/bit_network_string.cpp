@@ -0,0 +1,288 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/bit_network_string.hpp"
+
+#include "network/network_string.hpp"
+
+#include <assert.h>
+#include <cmath>
+#include <stdexcept>
+#include <string.h>
+
+Vec3     BitNetworkWriter::m_position_min;
+Vec3     BitNetworkWriter::m_position_max;
+float    BitNetworkWriter::m_position_resolution = 0.0f;
+unsigned BitNetworkWriter::m_position_bits[3] = { 0, 0, 0 };
+
+// ----------------------------------------------------------------------------
+void BitNetworkWriter::unitTesting()
+{
+    BareNetworkString s;
+    {
+        BitNetworkWriter writer(&s);
+        writer.addBool(true);
+        writer.addBits(5, 3);
+        writer.addBits(0xffffffff, 32);
+        writer.addVarUInt(0);
+        writer.addVarUInt(127);
+        writer.addVarUInt(128);
+        writer.addVarUInt(0xffffffff);
+        writer.addVarInt(-1);
+        writer.addVarInt(-100000);
+        writer.addVarInt(100000);
+        writer.addFloat(-1.5f);
+    }
+    // Data following the bits must stay byte aligned
+    s.addUInt8(42);
+
+    BitNetworkReader reader(&s);
+    assert(reader.getBool());
+    assert(reader.getBits(3) == 5);
+    assert(reader.getBits(32) == 0xffffffff);
+    assert(reader.getVarUInt() == 0);
+    assert(reader.getVarUInt() == 127);
+    assert(reader.getVarUInt() == 128);
+    assert(reader.getVarUInt() == 0xffffffff);
+    assert(reader.getVarInt() == -1);
+    assert(reader.getVarInt() == -100000);
+    assert(reader.getVarInt() == 100000);
+    assert(reader.getFloat() == -1.5f);
+    assert(s.getUInt8() == 42);
+
+    // Positions inside of the range are quantized, outside they are not
+    const float old_resolution = m_position_resolution;
+    const Vec3 old_min = m_position_min;
+    const Vec3 old_max = m_position_max;
+    unsigned old_bits[3];
+    memcpy(old_bits, m_position_bits, sizeof(old_bits));
+
+    setPositionRange(Vec3(-100.0f, -10.0f, 0.0f), Vec3(100.0f, 10.0f, 1.0f),
+                     0.01f);
+    assert(m_position_bits[0] == 15);
+    assert(m_position_bits[1] == 11);
+    assert(m_position_bits[2] == 7);
+    const Vec3 inside(12.345f, -3.21f, 0.5f);
+    const Vec3 outside(12.345f, 300.0f, 0.5f);
+    BareNetworkString p;
+    {
+        BitNetworkWriter writer(&p);
+        writer.addPosition(inside);
+        writer.addPosition(outside);
+    }
+    assert(p.size() == 17);
+    BitNetworkReader position_reader(&p);
+    Vec3 xyz = position_reader.getPosition();
+    assert(xyz == roundPosition(inside));
+    assert((xyz - inside).length() < 0.01f);
+    xyz = position_reader.getPosition();
+    assert(xyz == outside);
+
+    m_position_resolution = old_resolution;
+    m_position_min = old_min;
+    m_position_max = old_max;
+    memcpy(m_position_bits, old_bits, sizeof(old_bits));
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Sets the range in which positions are quantized, which is the bounding box
+ *  of the current track. Server and clients must use the same values, so
+ *  a client uses the values sent by the server in the load world message.
+ *  \param min, max The bounding box.
+ *  \param resolution Distance between two quantized positions.
+ */
+void BitNetworkWriter::setPositionRange(const Vec3& min, const Vec3& max,
+                                        float resolution)
+{
+    m_position_min = min;
+    m_position_max = max;
+    m_position_resolution = resolution > 0.0f ? resolution : 0.0f;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        unsigned bits = 1;
+        if (m_position_resolution > 0.0f)
+        {
+            const double steps = (max[i] - min[i]) / m_position_resolution;
+            while (bits < 24 && (double)((1u << bits) - 1) < steps)
+                bits++;
+        }
+        m_position_bits[i] = bits;
+    }
+}   // setPositionRange
+
+// ----------------------------------------------------------------------------
+/** Quantizes a position.
+ *  \param xyz The position.
+ *  \param q On return the quantized coordinates.
+ *  \return False if the position is outside of the range.
+ */
+bool BitNetworkWriter::quantizePosition(const Vec3& xyz, uint32_t* q)
+{
+    if (m_position_resolution == 0.0f)
+        return false;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        const float f = (xyz[i] - m_position_min[i]) / m_position_resolution;
+        // Also false for NAN
+        if (!(f >= 0.0f && f <= (float)((1u << m_position_bits[i]) - 1)))
+            return false;
+        q[i] = (uint32_t)(f + 0.5f);
+        if (q[i] > (1u << m_position_bits[i]) - 1)
+            return false;
+    }
+    return true;
+}   // quantizePosition
+
+// ----------------------------------------------------------------------------
+Vec3 BitNetworkWriter::dequantizePosition(const uint32_t* q)
+{
+    return Vec3(m_position_min.getX() + (float)q[0] * m_position_resolution,
+                m_position_min.getY() + (float)q[1] * m_position_resolution,
+                m_position_min.getZ() + (float)q[2] * m_position_resolution);
+}   // dequantizePosition
+
+// ----------------------------------------------------------------------------
+/** Returns the position a receiver gets for the given position, so that
+ *  the sender can use the same value.
+ */
+Vec3 BitNetworkWriter::roundPosition(const Vec3& xyz)
+{
+    uint32_t q[3];
+    if (!quantizePosition(xyz, q))
+        return xyz;
+    return dequantizePosition(q);
+}   // roundPosition
+
+// ----------------------------------------------------------------------------
+/** Adds the lowest bits of a value.
+ *  \param value The value.
+ *  \param bits Number of bits to add, at most 32.
+ */
+void BitNetworkWriter::addBits(uint32_t value, unsigned bits)
+{
+    assert(bits <= 32);
+    if (bits < 32)
+        value &= (1u << bits) - 1;
+    m_bits = (m_bits << bits) | value;
+    m_num_bits += bits;
+    while (m_num_bits >= 8)
+    {
+        m_num_bits -= 8;
+        m_buffer->addUInt8((uint8_t)(m_bits >> m_num_bits));
+    }
+    m_bits &= (1u << m_num_bits) - 1;
+}   // addBits
+
+// ----------------------------------------------------------------------------
+/** Appends the remaining bits padded with zeros to a full byte. */
+void BitNetworkWriter::flush()
+{
+    if (m_num_bits == 0)
+        return;
+    m_buffer->addUInt8((uint8_t)(m_bits << (8 - m_num_bits)));
+    m_bits = 0;
+    m_num_bits = 0;
+}   // flush
+
+// ----------------------------------------------------------------------------
+/** Adds an unsigned integer in groups of 7 bits, each followed by a bit
+ *  which is set if more groups follow. */
+void BitNetworkWriter::addVarUInt(uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        addBits(value, 7);
+        addBool(true);
+        value >>= 7;
+    }
+    addBits(value, 7);
+    addBool(false);
+}   // addVarUInt
+
+// ----------------------------------------------------------------------------
+void BitNetworkWriter::addFloat(float value)
+{
+    uint32_t u;
+    memcpy(&u, &value, sizeof(u));
+    addBits(u, 32);
+}   // addFloat
+
+// ----------------------------------------------------------------------------
+/** Adds a position, quantized if it is inside of the range set with
+ *  setPositionRange. Otherwise all three floats are added. */
+void BitNetworkWriter::addPosition(const Vec3& xyz)
+{
+    uint32_t q[3];
+    const bool quantized = quantizePosition(xyz, q);
+    addBool(quantized);
+    if (!quantized)
+    {
+        addVec3(xyz);
+        return;
+    }
+    for (unsigned i = 0; i < 3; i++)
+        addBits(q[i], m_position_bits[i]);
+}   // addPosition
+
+// ============================================================================
+uint32_t BitNetworkReader::getBits(unsigned bits)
+{
+    assert(bits <= 32);
+    while (m_num_bits < bits)
+    {
+        m_bits = (m_bits << 8) | m_buffer->getUInt8();
+        m_num_bits += 8;
+    }
+    m_num_bits -= bits;
+    const uint64_t value = m_bits >> m_num_bits;
+    m_bits &= ((uint64_t)1 << m_num_bits) - 1;
+    return (uint32_t)value;
+}   // getBits
+
+// ----------------------------------------------------------------------------
+uint32_t BitNetworkReader::getVarUInt()
+{
+    uint32_t value = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7)
+    {
+        value |= getBits(7) << shift;
+        if (!getBool())
+            return value;
+    }
+    throw std::out_of_range("getVarUInt too many bits.");
+}   // getVarUInt
+
+// ----------------------------------------------------------------------------
+float BitNetworkReader::getFloat()
+{
+    uint32_t u = getBits(32);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}   // getFloat
+
+// ----------------------------------------------------------------------------
+Vec3 BitNetworkReader::getPosition()
+{
+    if (!getBool())
+        return getVec3();
+    uint32_t q[3];
+    for (unsigned i = 0; i < 3; i++)
+        q[i] = getBits(BitNetworkWriter::m_position_bits[i]);
+    return BitNetworkWriter::dequantizePosition(q);
+}   // getPosition
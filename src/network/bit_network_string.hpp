@@ -0,0 +1,170 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file bit_network_string.hpp
+ *  \brief Bit level writer and reader for compact game states.
+ */
+
+#ifndef HEADER_BIT_NETWORK_STRING_HPP
+#define HEADER_BIT_NETWORK_STRING_HPP
+
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+class BareNetworkString;
+
+/** \ingroup network
+ *  Writes values with an arbitrary number of bits to a BareNetworkString.
+ *  Bits are stored most significant first. Complete bytes are appended to
+ *  the string immediately, the remaining bits are padded to a full byte by
+ *  flush() (which is also called by the destructor), so that other data
+ *  can follow byte aligned.
+ *  Positions are quantized relative to the bounding box of the current
+ *  track, see setPositionRange().
+ */
+class BitNetworkWriter
+{
+friend class BitNetworkReader;
+private:
+    BareNetworkString* m_buffer;
+
+    /** Bits not yet appended to the buffer (less than 8). */
+    uint64_t m_bits;
+
+    unsigned m_num_bits;
+
+    /** Minimum of the quantized positions. */
+    static Vec3 m_position_min;
+
+    /** Maximum of the quantized positions. */
+    static Vec3 m_position_max;
+
+    /** Distance between two quantized positions, 0 if positions are not
+     *  quantized. */
+    static float m_position_resolution;
+
+    /** Number of bits of a quantized coordinate on each axis. */
+    static unsigned m_position_bits[3];
+
+    // ------------------------------------------------------------------------
+    static bool quantizePosition(const Vec3& xyz, uint32_t* q);
+    // ------------------------------------------------------------------------
+    static Vec3 dequantizePosition(const uint32_t* q);
+
+public:
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    static void setPositionRange(const Vec3& min, const Vec3& max,
+                                 float resolution);
+    // ------------------------------------------------------------------------
+    static Vec3 roundPosition(const Vec3& xyz);
+    // ------------------------------------------------------------------------
+    static const Vec3& getPositionMin()              { return m_position_min; }
+    // ------------------------------------------------------------------------
+    static const Vec3& getPositionMax()              { return m_position_max; }
+    // ------------------------------------------------------------------------
+    static float getPositionResolution()      { return m_position_resolution; }
+    // ------------------------------------------------------------------------
+    BitNetworkWriter(BareNetworkString* buffer)
+    {
+        m_buffer = buffer;
+        m_bits = 0;
+        m_num_bits = 0;
+    }   // BitNetworkWriter
+    // ------------------------------------------------------------------------
+    ~BitNetworkWriter()                                            { flush(); }
+    // ------------------------------------------------------------------------
+    void addBits(uint32_t value, unsigned bits);
+    // ------------------------------------------------------------------------
+    void flush();
+    // ------------------------------------------------------------------------
+    void addBool(bool b)                             { addBits(b ? 1 : 0, 1); }
+    // ------------------------------------------------------------------------
+    void addVarUInt(uint32_t value);
+    // ------------------------------------------------------------------------
+    /** Adds a signed integer, small absolute values use less bits. */
+    void addVarInt(int value)
+    {
+        addVarUInt(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+    }   // addVarInt
+    // ------------------------------------------------------------------------
+    void addFloat(float value);
+    // ------------------------------------------------------------------------
+    void addVec3(const Vec3& xyz)
+    {
+        addFloat(xyz.getX());
+        addFloat(xyz.getY());
+        addFloat(xyz.getZ());
+    }   // addVec3
+    // ------------------------------------------------------------------------
+    void addPosition(const Vec3& xyz);
+
+};   // class BitNetworkWriter
+
+// ============================================================================
+/** \ingroup network
+ *  Reads values written by a BitNetworkWriter. Bytes are only taken from the
+ *  BareNetworkString when their bits are needed, so after the last value
+ *  was read the string is positioned at the data following the padding.
+ */
+class BitNetworkReader
+{
+private:
+    const BareNetworkString* m_buffer;
+
+    /** Bits taken from the buffer but not read yet. */
+    uint64_t m_bits;
+
+    unsigned m_num_bits;
+
+public:
+    BitNetworkReader(const BareNetworkString* buffer)
+    {
+        m_buffer = buffer;
+        m_bits = 0;
+        m_num_bits = 0;
+    }   // BitNetworkReader
+    // ------------------------------------------------------------------------
+    uint32_t getBits(unsigned bits);
+    // ------------------------------------------------------------------------
+    bool getBool()                                  { return getBits(1) == 1; }
+    // ------------------------------------------------------------------------
+    uint32_t getVarUInt();
+    // ------------------------------------------------------------------------
+    int getVarInt()
+    {
+        uint32_t v = getVarUInt();
+        return (int)(v >> 1) ^ -(int)(v & 1);
+    }   // getVarInt
+    // ------------------------------------------------------------------------
+    float getFloat();
+    // ------------------------------------------------------------------------
+    Vec3 getVec3()
+    {
+        Vec3 xyz;
+        xyz.setX(getFloat());
+        xyz.setY(getFloat());
+        xyz.setZ(getFloat());
+        return xyz;
+    }   // getVec3
+    // ------------------------------------------------------------------------
+    Vec3 getPosition();
+
+};   // class BitNetworkReader
+
+#endif // HEADER_BIT_NETWORK_STRING_HPP
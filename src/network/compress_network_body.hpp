@@ -19,6 +19,8 @@
 #ifndef HEADER_COMPRESS_NETWORK_BODY_HPP
 #define HEADER_COMPRESS_NETWORK_BODY_HPP
 
+#include "network/bit_network_string.hpp"
+#include "network/network_config.hpp"
 #include "network/network_string.hpp"
 #include "utils/mini_glm.hpp"
 
@@ -52,6 +54,55 @@ namespace CompressNetworkBody
         body->updateInertiaTensor();
     }   // setCompressedValues
     // ------------------------------------------------------------------------
+    /** Compress transformation and velocities of bullet object for bit packed
+     *  game states, the position is quantized in the track bounding box
+     *  additionally. Like compress it rounds the values locally, and only
+     *  does this if writer is NULL.
+     */
+    inline void compressPacked(btRigidBody* body, btMotionState* ms,
+                               BitNetworkWriter* writer = NULL)
+    {
+        Vec3 xyz = BitNetworkWriter::roundPosition(
+            body->getWorldTransform().getOrigin());
+        uint32_t compressed_q =
+            compressQuaternion(body->getWorldTransform().getRotation());
+        short lvx = toFloat16(body->getLinearVelocity().x());
+        short lvy = toFloat16(body->getLinearVelocity().y());
+        short lvz = toFloat16(body->getLinearVelocity().z());
+        short avx = toFloat16(body->getAngularVelocity().x());
+        short avy = toFloat16(body->getAngularVelocity().y());
+        short avz = toFloat16(body->getAngularVelocity().z());
+        setCompressedValues(xyz.getX(), xyz.getY(), xyz.getZ(), compressed_q,
+            lvx, lvy, lvz, avx, avy, avz, body, ms);
+        if (!writer)
+            return;
+
+        writer->addPosition(xyz);
+        writer->addBits(compressed_q, 32);
+        writer->addBits((uint16_t)lvx, 16);
+        writer->addBits((uint16_t)lvy, 16);
+        writer->addBits((uint16_t)lvz, 16);
+        writer->addBits((uint16_t)avx, 16);
+        writer->addBits((uint16_t)avy, 16);
+        writer->addBits((uint16_t)avz, 16);
+    }   // compressPacked
+    // ------------------------------------------------------------------------
+    /* Restores values written by compressPacked. */
+    inline void decompressPacked(BitNetworkReader* reader,
+                                 btRigidBody* body, btMotionState* ms)
+    {
+        Vec3 xyz = reader->getPosition();
+        uint32_t compressed_q = reader->getBits(32);
+        short lvx = (short)reader->getBits(16);
+        short lvy = (short)reader->getBits(16);
+        short lvz = (short)reader->getBits(16);
+        short avx = (short)reader->getBits(16);
+        short avy = (short)reader->getBits(16);
+        short avz = (short)reader->getBits(16);
+        setCompressedValues(xyz.getX(), xyz.getY(), xyz.getZ(), compressed_q,
+            lvx, lvy, lvz, avx, avy, avz, body, ms);
+    }   // decompressPacked
+    // ------------------------------------------------------------------------
     /** Compress transformation and velocities of bullet object, it will
      *  call MiniGLM::compressQuaternion for compress quaternion of
      *  transformation and convert linear and angular velocities to half floats
@@ -62,6 +113,17 @@ namespace CompressNetworkBody
     inline void compress(btRigidBody* body, btMotionState* ms,
                          BareNetworkString* bns = NULL)
     {
+        if (NetworkConfig::get()->usePackedState())
+        {
+            if (!bns)
+            {
+                compressPacked(body, ms);
+                return;
+            }
+            BitNetworkWriter writer(bns);
+            compressPacked(body, ms, &writer);
+            return;
+        }
         float x = body->getWorldTransform().getOrigin().x();
         float y = body->getWorldTransform().getOrigin().y();
         float z = body->getWorldTransform().getOrigin().z();
@@ -88,6 +150,12 @@ namespace CompressNetworkBody
     inline void decompress(const BareNetworkString* bns,
                            btRigidBody* body, btMotionState* ms)
     {
+        if (NetworkConfig::get()->usePackedState())
+        {
+            BitNetworkReader reader(bns);
+            decompressPacked(&reader, body, ms);
+            return;
+        }
         float x = bns->getFloat();
         float y = bns->getFloat();
         float z = bns->getFloat();
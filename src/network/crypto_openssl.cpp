@@ -28,10 +28,10 @@
 
 // ============================================================================
 // AES GCM modes never writes anything when finalize, it only handles the tag
-// authentication, so we write to this dummy block instead of out of bounds
+// authentication, so we write to a dummy block instead of out of bounds
 // pointer, and AES GCM mode has the same ciphertext and plaintext size due to
-// block cipher in stream cipher mode.
-std::array<uint8_t, 16> unused_16_blocks;
+// block cipher in stream cipher mode. The dummy block is a local variable,
+// since packets are encrypted by several threads at the same time.
 // ============================================================================
 std::string Crypto::base64(const std::vector<uint8_t>& input)
 {
@@ -91,6 +91,7 @@ bool Crypto::encryptConnectionRequest(BareNetworkString& ns)
     if (EVP_EncryptUpdate(m_encrypt, cipher.data() + 4, &elen,
         ns.m_buffer.data(), (int)ns.m_buffer.size()) != 1)
         return false;
+    std::array<uint8_t, 16> unused_16_blocks;
     if (EVP_EncryptFinal_ex(m_encrypt, unused_16_blocks.data(), &elen) != 1)
         return false;
     if (EVP_CIPHER_CTX_ctrl(m_encrypt, EVP_CTRL_GCM_GET_TAG, 4, cipher.data())
@@ -118,6 +119,7 @@ bool Crypto::decryptConnectionRequest(BareNetworkString& ns)
         (int)(ns.m_buffer.size() - 4)) != 1)
         return false;
 
+    std::array<uint8_t, 16> unused_16_blocks;
     if (EVP_DecryptFinal_ex(m_decrypt, unused_16_blocks.data(), &dlen) > 0)
     {
         assert(dlen == 0);
@@ -173,6 +175,7 @@ ENetPacket* Crypto::encryptSend(BareNetworkString& ns, bool reliable)
         enet_packet_destroy(p);
         return NULL;
     }
+    std::array<uint8_t, 16> unused_16_blocks;
     if (EVP_EncryptFinal_ex(m_encrypt, unused_16_blocks.data(), &elen) != 1)
     {
         enet_packet_destroy(p);
@@ -222,6 +225,7 @@ NetworkString* Crypto::decryptRecieve(ENetPacket* p)
     {
         throw std::runtime_error("Failed to decrypt.");
     }
+    std::array<uint8_t, 16> unused_16_blocks;
     if (EVP_DecryptFinal_ex(m_decrypt, unused_16_blocks.data(), &dlen) > 0)
     {
         assert(dlen == 0);
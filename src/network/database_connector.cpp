@@ -0,0 +1,280 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifdef ENABLE_SQLITE3
+
+#include "network/database_connector.hpp"
+
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+#include "utils/vs.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <iterator>
+
+// ----------------------------------------------------------------------------
+/** Starts the database thread.
+ *  \param db The opened database, which must be opened in serialized
+ *         threading mode (SQLITE_OPEN_FULLMUTEX). It is not closed here.
+ */
+DatabaseConnector::DatabaseConnector(sqlite3* db)
+{
+    m_db = db;
+    m_stop = false;
+    m_thread = std::thread(std::bind(&DatabaseConnector::mainLoop, this));
+}   // DatabaseConnector
+
+// ----------------------------------------------------------------------------
+/** Executes all queued requests and stops the database thread. Results
+ *  which have not been handled are discarded.
+ */
+DatabaseConnector::~DatabaseConnector()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_requests_mutex);
+        m_stop = true;
+    }
+    m_requests_added.notify_one();
+    m_thread.join();
+}   // ~DatabaseConnector
+
+// ----------------------------------------------------------------------------
+void DatabaseConnector::addRequest(Request&& request)
+{
+    std::unique_lock<std::mutex> ul(m_requests_mutex);
+    if (m_requests.size() >= MAX_QUEUED_REQUESTS)
+    {
+        Log::warn("DatabaseConnector",
+            "Too many queued requests, waiting for database.");
+        m_requests_removed.wait(ul, [this]()
+            { return m_requests.size() < MAX_QUEUED_REQUESTS; });
+    }
+    m_requests.push_back(std::move(request));
+    ul.unlock();
+    m_requests_added.notify_one();
+}   // addRequest
+
+// ----------------------------------------------------------------------------
+void DatabaseConnector::mainLoop()
+{
+    VS::setThreadName("DatabaseConnector");
+    std::vector<Request> requests;
+    std::vector<Result> results;
+    while (true)
+    {
+        std::unique_lock<std::mutex> ul(m_requests_mutex);
+        m_requests_added.wait(ul, [this]()
+            { return m_stop || !m_requests.empty(); });
+        // Only stop after all requests have been written
+        if (m_requests.empty())
+            break;
+        const size_t count = std::min(m_requests.size(),
+            (size_t)MAX_BATCH_REQUESTS);
+        requests.assign(std::make_move_iterator(m_requests.begin()),
+            std::make_move_iterator(m_requests.begin() + count));
+        m_requests.erase(m_requests.begin(), m_requests.begin() + count);
+        ul.unlock();
+        m_requests_removed.notify_all();
+
+        const bool transaction = requests.size() > 1;
+        if (transaction)
+            executeSimpleQuery("BEGIN;");
+        for (Request& request : requests)
+        {
+            Result result;
+            result.m_success = request.m_query.empty() ?
+                true : executeRequest(request, &result.m_rows);
+            if (request.m_result_function)
+            {
+                result.m_result_function = std::move(request.m_result_function);
+                results.push_back(std::move(result));
+            }
+        }
+        // A failed statement can roll back the transaction itself
+        if (transaction && sqlite3_get_autocommit(m_db) == 0)
+            executeSimpleQuery("COMMIT;");
+        requests.clear();
+
+        if (!results.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_results_mutex);
+            std::move(results.begin(), results.end(),
+                std::back_inserter(m_results));
+            results.clear();
+        }
+    }
+
+    for (auto& statement : m_statements)
+        sqlite3_finalize(statement.second);
+    m_statements.clear();
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Returns the cached prepared statement of a query, or prepares it. */
+sqlite3_stmt* DatabaseConnector::getStatement(const std::string& query)
+{
+    auto it = m_statements.find(query);
+    if (it != m_statements.end())
+        return it->second;
+
+    // Queries with inlined values would fill the cache, so start again
+    if (m_statements.size() >= MAX_CACHED_STATEMENTS)
+    {
+        for (auto& statement : m_statements)
+            sqlite3_finalize(statement.second);
+        m_statements.clear();
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
+    if (ret != SQLITE_OK)
+    {
+        Log::error("DatabaseConnector",
+            "Error preparing database for query %s: %s",
+            query.c_str(), sqlite3_errmsg(m_db));
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    m_statements[query] = stmt;
+    return stmt;
+}   // getStatement
+
+// ----------------------------------------------------------------------------
+/** Executes a request in the database thread.
+ *  \param rows Result rows are appended to it.
+ *  \return True if no error occurs.
+ */
+bool DatabaseConnector::executeRequest(const Request& request,
+                                       std::vector<Row>* rows)
+{
+    sqlite3_stmt* stmt = getStatement(request.m_query);
+    if (!stmt)
+        return false;
+    if (request.m_bind_function)
+        request.m_bind_function(stmt);
+
+    int ret = sqlite3_step(stmt);
+    while (ret == SQLITE_ROW)
+    {
+        const int columns = sqlite3_column_count(stmt);
+        Row row;
+        for (int i = 0; i < columns; i++)
+        {
+            const char* text = (const char*)sqlite3_column_text(stmt, i);
+            row.push_back(text ? text : "");
+        }
+        rows->push_back(std::move(row));
+        ret = sqlite3_step(stmt);
+    }
+    if (ret != SQLITE_DONE)
+    {
+        Log::error("DatabaseConnector", "Error executing query %s: %s",
+            request.m_query.c_str(), sqlite3_errmsg(m_db));
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ret == SQLITE_DONE;
+}   // executeRequest
+
+// ----------------------------------------------------------------------------
+void DatabaseConnector::executeSimpleQuery(const char* query)
+{
+    char* error = NULL;
+    if (sqlite3_exec(m_db, query, NULL, NULL, &error) != SQLITE_OK)
+    {
+        Log::error("DatabaseConnector", "Error executing query %s: %s",
+            query, error ? error : "");
+    }
+    sqlite3_free(error);
+}   // executeSimpleQuery
+
+// ----------------------------------------------------------------------------
+/** Calls the result functions of all executed requests, in the order the
+ *  requests were added. */
+void DatabaseConnector::handleResults()
+{
+    std::vector<Result> results;
+    {
+        std::lock_guard<std::mutex> lock(m_results_mutex);
+        if (m_results.empty())
+            return;
+        std::swap(results, m_results);
+    }
+    for (Result& result : results)
+        result.m_result_function(result.m_success, result.m_rows);
+}   // handleResults
+
+// ----------------------------------------------------------------------------
+/** Writes rows to an in-memory database and checks that reads and results
+ *  are returned in order. */
+void DatabaseConnector::unitTesting()
+{
+    sqlite3* db = NULL;
+    int ret = sqlite3_open_v2(":memory:", &db,
+        SQLITE_OPEN_FULLMUTEX | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+        NULL);
+    assert(ret == SQLITE_OK);
+    (void)ret;
+
+    std::vector<int> order;
+    int count = -1;
+    bool failed_query = true;
+    {
+        DatabaseConnector connector(db);
+        connector.write("CREATE TABLE test (id INTEGER, name TEXT);");
+        for (int i = 0; i < 1000; i++)
+        {
+            std::string name = StringUtils::toString(i);
+            connector.write("INSERT INTO test (id, name) VALUES (?, ?);",
+                [i, name](sqlite3_stmt* stmt)
+                {
+                    sqlite3_bind_int(stmt, 1, i);
+                    sqlite3_bind_text(stmt, 2, name.c_str(), -1,
+                        SQLITE_TRANSIENT);
+                });
+        }
+        connector.write("INSERT INTO no_such_table VALUES (1);", nullptr,
+            [&failed_query](bool success) { failed_query = !success; });
+        connector.read("SELECT COUNT(*) FROM test WHERE name = id;",
+            [&count, &order](bool success, const std::vector<Row>& rows)
+            {
+                assert(success && rows.size() == 1);
+                count = atoi(rows[0][0].c_str());
+                order.push_back(0);
+            });
+        bool done = false;
+        connector.afterPendingRequests([&done, &order]()
+            {
+                order.push_back(1);
+                done = true;
+            });
+        while (!done)
+        {
+            connector.handleResults();
+            StkTime::sleep(1);
+        }
+    }
+    sqlite3_close(db);
+    assert(failed_query);
+    assert(count == 1000);
+    assert(order.size() == 2 && order[0] == 0 && order[1] == 1);
+}   // unitTesting
+
+#endif   // ENABLE_SQLITE3
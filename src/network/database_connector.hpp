@@ -0,0 +1,167 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_DATABASE_CONNECTOR_HPP
+#define HEADER_DATABASE_CONNECTOR_HPP
+
+#ifdef ENABLE_SQLITE3
+
+#include "utils/no_copy.hpp"
+
+#include <sqlite3.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/** \ingroup network
+ *  Runs sqlite queries of the server in a separate thread, so that slow disk
+ *  writes do not stall the lobby. Requests are executed in the order they
+ *  were added. All requests which are queued when the database thread wakes
+ *  up are executed in one transaction, so a busy server only needs one disk
+ *  sync for many writes. Prepared statements are cached by their query
+ *  string, so queries should use parameters (?) for values which change.
+ *  Results of queries are passed back to the thread which calls
+ *  handleResults().
+ */
+class DatabaseConnector : public NoCopy
+{
+public:
+    /** One result row, NULL columns are stored as empty strings. */
+    typedef std::vector<std::string> Row;
+
+    /** Binds the parameters of a statement, it is called in the database
+     *  thread, so it must only use copies of the values it binds. */
+    typedef std::function<void(sqlite3_stmt* stmt)> BindFunction;
+
+    /** Called in handleResults() with the success of the query and all
+     *  result rows. */
+    typedef std::function<void(bool success, const std::vector<Row>& rows)>
+        ResultFunction;
+
+private:
+    struct Request
+    {
+        /** The query, if empty only the result function is called. */
+        std::string m_query;
+        BindFunction m_bind_function;
+        ResultFunction m_result_function;
+    };
+
+    struct Result
+    {
+        ResultFunction m_result_function;
+        std::vector<Row> m_rows;
+        bool m_success;
+    };
+
+    /** Maximum number of requests waiting for the database thread, adding
+     *  more requests blocks till the database catches up. */
+    static const unsigned MAX_QUEUED_REQUESTS = 4096;
+
+    /** Maximum number of requests executed in one transaction. */
+    static const unsigned MAX_BATCH_REQUESTS = 256;
+
+    /** Maximum number of cached prepared statements. */
+    static const unsigned MAX_CACHED_STATEMENTS = 64;
+
+    sqlite3* m_db;
+
+    std::thread m_thread;
+
+    std::mutex m_requests_mutex;
+
+    /** Notified when a request was added or the thread should stop. */
+    std::condition_variable m_requests_added;
+
+    /** Notified when the database thread removed requests from the queue. */
+    std::condition_variable m_requests_removed;
+
+    std::deque<Request> m_requests;
+
+    bool m_stop;
+
+    std::mutex m_results_mutex;
+
+    std::vector<Result> m_results;
+
+    /** Prepared statements, only used in the database thread. */
+    std::unordered_map<std::string, sqlite3_stmt*> m_statements;
+
+    // ------------------------------------------------------------------------
+    void mainLoop();
+    // ------------------------------------------------------------------------
+    void addRequest(Request&& request);
+    // ------------------------------------------------------------------------
+    sqlite3_stmt* getStatement(const std::string& query);
+    // ------------------------------------------------------------------------
+    bool executeRequest(const Request& request, std::vector<Row>* rows);
+    // ------------------------------------------------------------------------
+    void executeSimpleQuery(const char* query);
+
+public:
+    // ------------------------------------------------------------------------
+    DatabaseConnector(sqlite3* db);
+    // ------------------------------------------------------------------------
+    ~DatabaseConnector();
+    // ------------------------------------------------------------------------
+    /** Queues a query whose rows (if any) are not needed, optionally with a
+     *  function which is told if the query succeeded. */
+    void write(const std::string& query,
+               BindFunction bind_function = nullptr,
+               std::function<void(bool success)> done = nullptr)
+    {
+        ResultFunction result_function;
+        if (done)
+        {
+            result_function =
+                [done](bool success, const std::vector<Row>&)
+                { done(success); };
+        }
+        addRequest({ query, bind_function, result_function });
+    }   // write
+    // ------------------------------------------------------------------------
+    /** Queues a query whose rows are passed to result_function. */
+    void read(const std::string& query, ResultFunction result_function,
+              BindFunction bind_function = nullptr)
+    {
+        addRequest({ query, bind_function, result_function });
+    }   // read
+    // ------------------------------------------------------------------------
+    /** Calls the function in handleResults() after all previously added
+     *  requests have been executed. */
+    void afterPendingRequests(std::function<void()> f)
+    {
+        addRequest({ "", nullptr,
+            [f](bool, const std::vector<Row>&) { f(); } });
+    }   // afterPendingRequests
+    // ------------------------------------------------------------------------
+    void handleResults();
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+
+};   // class DatabaseConnector
+
+#endif   // ENABLE_SQLITE3
+
+#endif   // HEADER_DATABASE_CONNECTOR_HPP
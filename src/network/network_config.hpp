@@ -94,6 +94,14 @@ private:
     /** Set by client or server which is required to be the same. */
     int m_state_frequency;
 
+    /** True if the game states of the current race are bit packed, which the
+     *  server decides when the world is loaded. */
+    bool m_packed_state;
+
+    /** True if game states of the current race refer to rewinders by ids
+     *  sent before, instead of by their names. */
+    bool m_rewinder_ids;
+
     /** List of server capabilities set when joining it, to determine features
      *  available in same version. */
     std::set<std::string> m_server_capabilities;
@@ -235,6 +243,14 @@ public:
     // ------------------------------------------------------------------------
     int getStateFrequency() const                 { return m_state_frequency; }
     // ------------------------------------------------------------------------
+    void setPackedState(bool packed)                 { m_packed_state = packed; }
+    // ------------------------------------------------------------------------
+    bool usePackedState() const                        { return m_packed_state; }
+    // ------------------------------------------------------------------------
+    void setRewinderIds(bool ids)                      { m_rewinder_ids = ids; }
+    // ------------------------------------------------------------------------
+    bool useRewinderIds() const                        { return m_rewinder_ids; }
+    // ------------------------------------------------------------------------
     bool roundValuesNow() const;
     // ------------------------------------------------------------------------
     void setServerCapabilities(std::set<std::string>& caps)
@@ -116,6 +116,12 @@ public:
      *  Must be re-defined. */
     virtual void asynchronousUpdate() = 0;
 
+    /** Returns the maximum time in ms between two calls of
+     *  asynchronousUpdate(), which is also called after each asynchronous
+     *  event. A negative value means that the protocol doesn't need to be
+     *  polled. */
+    virtual int getAsynchronousUpdateInterval() const { return 2; }
+
     /// functions to check incoming data easily
     NetworkString* getNetworkString(size_t capacity = 16) const;
     bool checkDataSize(Event* event, unsigned int minimum_size);
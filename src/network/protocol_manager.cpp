@@ -30,6 +30,7 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <cstdlib>
 #include <errno.h>
 #include <functional>
@@ -52,9 +53,9 @@ std::shared_ptr<ProtocolManager> ProtocolManager::createInstance()
             VS::setThreadName("ProtocolManager");
             while(!pm->m_exit.load())
             {
-                pm->asynchronousUpdate();
+                int interval = pm->asynchronousUpdate();
                 PROFILER_PUSH_CPU_MARKER("sleep", 0, 255, 255);
-                StkTime::sleep(2);
+                pm->waitForAsynchronousUpdate(interval);
                 PROFILER_POP_CPU_MARKER();
             }
         });
@@ -101,15 +102,19 @@ std::shared_ptr<ProtocolManager> ProtocolManager::createInstance()
 ProtocolManager::ProtocolManager()
 {
     m_exit.store(false);
+    m_async_update_requested = false;
+    m_all_protocols = std::make_shared<ProtocolList>();
 }   // ProtocolManager
 
 // ----------------------------------------------------------------------------
 ProtocolManager::~ProtocolManager()
 {
     // Now only this main thread is active, no more need for locks
-    for (unsigned int i = 0; i < m_all_protocols.size(); i++)
+    ProtocolList all_protocols = *m_all_protocols;
+    m_all_protocols.reset();
+    for (unsigned int i = 0; i < all_protocols.size(); i++)
     {
-        m_all_protocols[i].abort();
+        all_protocols[i].abort();
     }
 
     m_sync_events_to_process.lock();
@@ -151,6 +156,7 @@ void ProtocolManager::OneProtocolType::abort()
 void ProtocolManager::abort()
 {
     m_exit.store(true);
+    requestAsynchronousUpdate();
     if (NetworkConfig::get()->isServer())
     {
         std::unique_lock<std::mutex> ul(m_game_protocol_mutex);
@@ -191,9 +197,51 @@ void ProtocolManager::propagateEvent(Event* event)
         m_async_events_to_process.lock();
         m_async_events_to_process.getData().push_back(event);
         m_async_events_to_process.unlock();
+        requestAsynchronousUpdate();
     }
 }   // propagateEvent
 
+// ----------------------------------------------------------------------------
+/** Wakes up the asynchronous update thread, so that all protocols are updated
+ *  as soon as possible. Can be called from any thread.
+ */
+void ProtocolManager::requestAsynchronousUpdate()
+{
+    std::lock_guard<std::mutex> lock(m_async_update_mutex);
+    m_async_update_requested = true;
+    m_async_update_cv.notify_one();
+}   // requestAsynchronousUpdate
+
+// ----------------------------------------------------------------------------
+/** Called by the asynchronous update thread to wait until the next update.
+ *  \param interval Maximum time to wait in ms, negative to wait until
+ *         requestAsynchronousUpdate is called.
+ */
+void ProtocolManager::waitForAsynchronousUpdate(int interval)
+{
+    std::unique_lock<std::mutex> ul(m_async_update_mutex);
+    auto requested = [this]() { return m_async_update_requested; };
+    if (interval < 0)
+        m_async_update_cv.wait(ul, requested);
+    else
+    {
+        m_async_update_cv.wait_for(ul, std::chrono::milliseconds(interval),
+            requested);
+    }
+    m_async_update_requested = false;
+}   // waitForAsynchronousUpdate
+
+// ----------------------------------------------------------------------------
+/** Returns the current list of all protocols. The list is not changed
+ *  anymore, so it can be used without holding m_protocols_mutex.
+ */
+std::shared_ptr<const ProtocolManager::ProtocolList>
+                                             ProtocolManager::getAllProtocols()
+{
+    std::lock_guard<std::mutex> lock(m_protocols_mutex);
+    return m_all_protocols;
+}   // getAllProtocols
+
 // ----------------------------------------------------------------------------
 /** \brief Asks the manager to start a protocol.
  *  Add the protocol to the protocols vector.
@@ -203,9 +251,13 @@ void ProtocolManager::requestStart(std::shared_ptr<Protocol> protocol)
 {
     if (!protocol)
         return;
-    std::lock_guard<std::mutex> lock(m_protocols_mutex);
-    OneProtocolType &opt = m_all_protocols[protocol->getProtocolType()];
+    std::unique_lock<std::mutex> ul(m_protocols_mutex);
+    auto all_protocols = std::make_shared<ProtocolList>(*m_all_protocols);
+    OneProtocolType &opt = (*all_protocols)[protocol->getProtocolType()];
     opt.addProtocol(protocol);
+    m_all_protocols = all_protocols;
+    ul.unlock();
+    requestAsynchronousUpdate();
 }   // requestStart
 
 // ----------------------------------------------------------------------------
@@ -218,8 +270,10 @@ void ProtocolManager::requestTerminate(std::shared_ptr<Protocol> protocol)
     if (!protocol)
         return;
     std::lock_guard<std::mutex> lock(m_protocols_mutex);
-    OneProtocolType &opt = m_all_protocols[protocol->getProtocolType()];
+    auto all_protocols = std::make_shared<ProtocolList>(*m_all_protocols);
+    OneProtocolType &opt = (*all_protocols)[protocol->getProtocolType()];
     opt.removeProtocol(protocol);
+    m_all_protocols = all_protocols;
 }   // requestTerminate
 
 // ----------------------------------------------------------------------------
@@ -273,8 +327,12 @@ void ProtocolManager::OneProtocolType::removeProtocol(std::shared_ptr<Protocol>
 void ProtocolManager::findAndTerminate(ProtocolType type)
 {
     std::lock_guard<std::mutex> lock(m_protocols_mutex);
-    OneProtocolType &opt = m_all_protocols[type];
+    if ((*m_all_protocols)[type].isEmpty())
+        return;
+    auto all_protocols = std::make_shared<ProtocolList>(*m_all_protocols);
+    OneProtocolType &opt = (*all_protocols)[type];
     opt.abort();
+    m_all_protocols = all_protocols;
 }   // findAndTerminate
 
 // ----------------------------------------------------------------------------
@@ -283,7 +341,7 @@ void ProtocolManager::findAndTerminate(ProtocolType type)
  *  caller to avoid race conditions.
  *  \param event The event to deliver to the protocols.
  */
-bool ProtocolManager::OneProtocolType::notifyEvent(Event *event)
+bool ProtocolManager::OneProtocolType::notifyEvent(Event *event) const
 {
     if (m_protocols.empty()) return false;
 
@@ -309,13 +367,12 @@ bool ProtocolManager::OneProtocolType::notifyEvent(Event *event)
 /** Sends the event to the corresponding protocol. Returns true if the event
  *  can be ignored, or false otherwise.
  */
-bool ProtocolManager::sendEvent(Event* event,
-                          std::array<OneProtocolType, PROTOCOL_MAX>& protocols)
+bool ProtocolManager::sendEvent(Event* event, const ProtocolList& protocols)
 {
     bool can_be_deleted = false;
     if (event->getType() == EVENT_TYPE_MESSAGE)
     {
-        OneProtocolType &opt =
+        const OneProtocolType &opt =
             protocols.at(event->data().getProtocolType());
         can_be_deleted = opt.notifyEvent(event);
     }
@@ -337,7 +394,7 @@ bool ProtocolManager::sendEvent(Event* event,
  *  \param dt Time step size.
  *  \param async True if asynchronousUpdate() should be called.
  */
-void ProtocolManager::OneProtocolType::update(int ticks, bool async)
+void ProtocolManager::OneProtocolType::update(int ticks, bool async) const
 {
     for (unsigned int i = 0; i < m_protocols.size(); i++)
     {
@@ -348,6 +405,24 @@ void ProtocolManager::OneProtocolType::update(int ticks, bool async)
     }
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Returns the shortest asynchronous update interval of all protocols of
+ *  this type, or -1 if none of them needs to be polled.
+ */
+int ProtocolManager::OneProtocolType::getAsynchronousUpdateInterval() const
+{
+    int interval = -1;
+    for (unsigned int i = 0; i < m_protocols.size(); i++)
+    {
+        int protocol_interval =
+            m_protocols[i]->getAsynchronousUpdateInterval();
+        if (protocol_interval >= 0 &&
+            (interval < 0 || protocol_interval < interval))
+            interval = protocol_interval;
+    }
+    return interval;
+}   // getAsynchronousUpdateInterval
+
 // ----------------------------------------------------------------------------
 /** \brief Updates the manager.
  *
@@ -363,10 +438,8 @@ void ProtocolManager::update(int ticks)
     // Update from main thread only:
     assert(std::this_thread::get_id() != m_asynchronous_update_thread.get_id());
 
-    // Get a copied of protocols to prevent long time locking;
-    std::unique_lock<std::mutex> ul(m_protocols_mutex);
-    auto all_protocols = m_all_protocols;
-    ul.unlock();
+    // The list is not changed anymore, so no locking is needed
+    std::shared_ptr<const ProtocolList> all_protocols = getAllProtocols();
 
     // before updating, notify protocols that they have received events
     m_sync_events_to_process.lock();
@@ -378,7 +451,7 @@ void ProtocolManager::update(int ticks)
         bool can_be_deleted = true;
         try
         {
-            can_be_deleted = sendEvent(*i, all_protocols);
+            can_be_deleted = sendEvent(*i, *all_protocols);
         }
         catch (std::exception& e)
         {
@@ -402,9 +475,9 @@ void ProtocolManager::update(int ticks)
     m_sync_events_to_process.unlock();
 
     // Now update all protocols.
-    for (unsigned int i = 0; i < all_protocols.size(); i++)
+    for (unsigned int i = 0; i < all_protocols->size(); i++)
     {
-        OneProtocolType &opt = all_protocols[i];
+        const OneProtocolType &opt = (*all_protocols)[i];
         opt.update(ticks, /*async*/false);
     }
 }   // update
@@ -417,16 +490,16 @@ void ProtocolManager::update(int ticks)
  *  starting, stopping, pausing etc... protocols.
  *  This function is called in a separate thread running in this instance.
  *  This function IS NOT FPS-dependant.
+ *  \return Maximum time in ms until the next update, or -1 if no update is
+ *          needed before a new event arrives.
  */
-void ProtocolManager::asynchronousUpdate()
+int ProtocolManager::asynchronousUpdate()
 {
     PROFILER_PUSH_CPU_MARKER("Message delivery", 255, 0, 0);
     // First deliver asynchronous messages for all protocols
     // =====================================================
-    // Get a copied of protocols to prevent long time locking;
-    std::unique_lock<std::mutex> ul(m_protocols_mutex);
-    auto all_protocols = m_all_protocols;
-    ul.unlock();
+    // The list is not changed anymore, so no locking is needed
+    std::shared_ptr<const ProtocolList> all_protocols = getAllProtocols();
 
     m_async_events_to_process.lock();
     EventList::iterator i = m_async_events_to_process.getData().begin();
@@ -437,7 +510,7 @@ void ProtocolManager::asynchronousUpdate()
         bool result = true;
         try
         {
-            result = sendEvent(*i, all_protocols);
+            result = sendEvent(*i, *all_protocols);
         }
         catch (std::exception& e)
         {
@@ -461,6 +534,8 @@ void ProtocolManager::asynchronousUpdate()
             ++i;
         }
     }   // while i != m_events_to_process.end()
+    // Retry the events which could not be delivered yet soon
+    int interval = m_async_events_to_process.getData().empty() ? -1 : 2;
     m_async_events_to_process.unlock();
 
     PROFILER_POP_CPU_MARKER();
@@ -469,13 +544,18 @@ void ProtocolManager::asynchronousUpdate()
     // Second: update all running protocols
     // ====================================
     // Now update all protocols.
-    for (unsigned int i = 0; i < all_protocols.size(); i++)
+    for (unsigned int i = 0; i < all_protocols->size(); i++)
     {
-        OneProtocolType &opt = all_protocols[i];
+        const OneProtocolType &opt = (*all_protocols)[i];
         opt.update(0, /*async*/true);  // ticks does not matter, so set it to 0
+        int protocol_interval = opt.getAsynchronousUpdateInterval();
+        if (protocol_interval >= 0 &&
+            (interval < 0 || protocol_interval < interval))
+            interval = protocol_interval;
     }
 
     PROFILER_POP_CPU_MARKER();
+    return interval;
 }   // asynchronousUpdate
 
 // ----------------------------------------------------------------------------
@@ -485,8 +565,8 @@ void ProtocolManager::asynchronousUpdate()
  */
 std::shared_ptr<Protocol> ProtocolManager::getProtocol(ProtocolType type)
 {
-    std::lock_guard<std::mutex> lock(m_protocols_mutex);
-    OneProtocolType &opt = m_all_protocols[type];
+    std::shared_ptr<const ProtocolList> all_protocols = getAllProtocols();
+    const OneProtocolType &opt = (*all_protocols)[type];
     if (opt.isEmpty())
         return nullptr;
 
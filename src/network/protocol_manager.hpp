@@ -55,7 +55,9 @@ class STKPeer;
  *     A separate threads runs that delivers asynchronous events 
  *     (i.e. messages), updates each protocol, and handles new requests
  *     (start/stop protocol etc). Protocols are updated using the
- *     Protocol::asynchronousUpdate() function.
+ *     Protocol::asynchronousUpdate() function. The thread sleeps until
+ *     an event arrives, the protocols change, or the shortest
+ *     Protocol::getAsynchronousUpdateInterval() passed.
  
  *  2) Synchronous updates:
  *     This is called from the main game thread, and will deliver synchronous
@@ -90,6 +92,9 @@ class STKPeer;
  *  OneProtocol structure, but e.g. several connect_to_peer instances would
  *  be stored in one OneProtocoll instance. The OneProtocol instance is 
  *  responsible to forward events to all protocols with the same id.
+ *  The list of all protocols is never changed once it is published, starting
+ *  or terminating a protocol publishes a modified copy. So the threads only
+ *  need to take a reference to the current list under the lock.
  *  
  */ 
 class ProtocolManager : public NoCopy
@@ -106,13 +111,15 @@ private:
         std::vector<std::shared_ptr<Protocol> > m_protocols;
     public:
         void removeProtocol(std::shared_ptr<Protocol> p);
-        bool notifyEvent(Event *event);
-        void update(int ticks, bool async);
+        bool notifyEvent(Event *event) const;
+        void update(int ticks, bool async) const;
+        int getAsynchronousUpdateInterval() const;
         void abort();
         // --------------------------------------------------------------------
         /** Returns the first protocol of a given type. It is assumed that
          *  there is a protocol of that type. */
-        std::shared_ptr<Protocol> getFirstProtocol() { return m_protocols[0]; }
+        std::shared_ptr<Protocol> getFirstProtocol() const
+                                                     { return m_protocols[0]; }
         // --------------------------------------------------------------------
         /** Returns if this protocol class handles connect events. Protocols
          *  of the same class either all handle a connect event, or none, so
@@ -142,9 +149,12 @@ private:
 
     // ------------------------------------------------------------------------
     
+    typedef std::array<OneProtocolType, PROTOCOL_MAX> ProtocolList;
+
     /** The list of all protocol types, each one containing a (potentially
-     *  empty) list of protocols. */
-    std::array<OneProtocolType, PROTOCOL_MAX> m_all_protocols;
+     *  empty) list of protocols. It is replaced by a modified copy when
+     *  protocols are started or terminated, see m_protocols_mutex. */
+    std::shared_ptr<const ProtocolList> m_all_protocols;
 
     /** A list of network events - messages, disconnect and disconnects. */
     typedef std::list<Event*> EventList;
@@ -171,15 +181,27 @@ private:
 
     std::mutex m_game_protocol_mutex, m_protocols_mutex;
 
+    /** Used to wake up the asynchronous update thread. */
+    std::condition_variable m_async_update_cv;
+
+    std::mutex m_async_update_mutex;
+
+    /** Set if the asynchronous update thread should not wait, protected by
+     *  m_async_update_mutex. */
+    bool m_async_update_requested;
+
     EventList m_controller_events_list;
 
     /*! Single instance of protocol manager.*/
     static std::weak_ptr<ProtocolManager> m_protocol_manager;
 
-    bool sendEvent(Event* event,
-                   std::array<OneProtocolType, PROTOCOL_MAX>& protocols);
+    bool sendEvent(Event* event, const ProtocolList& protocols);
+
+    int asynchronousUpdate();
+
+    void waitForAsynchronousUpdate(int interval);
 
-    void asynchronousUpdate();
+    std::shared_ptr<const ProtocolList> getAllProtocols();
 
 public:
     // ===========================================
@@ -193,6 +215,7 @@ public:
     void      requestTerminate(std::shared_ptr<Protocol> protocol);
     void      findAndTerminate(ProtocolType type);
     void      update(int ticks);
+    void      requestAsynchronousUpdate();
     // ------------------------------------------------------------------------
     bool isExiting() const                            { return m_exit.load(); }
     // ------------------------------------------------------------------------
@@ -34,6 +34,7 @@
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "modes/linear_world.hpp"
+#include "network/bit_network_string.hpp"
 #include "network/crypto.hpp"
 #include "network/event.hpp"
 #include "network/game_setup.hpp"
@@ -282,9 +283,30 @@ void ClientLobby::addAllPlayers(Event* event)
         unsigned flag_deactivated_time = data.getUInt16();
         race_manager->setFlagDeactivatedTicks(flag_deactivated_time);
     }
+    // Only added by servers which use bit packed game states or rewinder ids
+    const uint8_t state_flags = data.size() > 0 ? data.getUInt8() : 0;
+    NetworkConfig::get()->setPackedState((state_flags & 1) != 0);
+    NetworkConfig::get()->setRewinderIds((state_flags & 2) != 0);
+    // When live joining the position range for packed states follows the
+    // flags (otherwise it is in the start race message), it replaces the
+    // range the track computes from its own mesh in loadWorld
+    const bool position_range = (state_flags & 1) != 0 && data.size() > 0;
+    Vec3 position_min, position_max;
+    float position_resolution = 0.0f;
+    if (position_range)
+    {
+        position_min = data.getVec3();
+        position_max = data.getVec3();
+        position_resolution = data.getFloat();
+    }
     configRemoteKart(players, isSpectator() ? 1 :
         (int)NetworkConfig::get()->getNetworkPlayers().size());
     loadWorld();
+    if (position_range)
+    {
+        BitNetworkWriter::setPositionRange(position_min, position_max,
+                                           position_resolution);
+    }
     // Disable until render gui during loading is bug free
     //StateManager::get()->enterGameState();
 
@@ -955,6 +977,17 @@ void ClientLobby::startGame(Event* event)
     assert(nim);
     nim->restoreCompleteState(event->data());
 
+    // The position range for packed states of the server replaces the range
+    // the track computed from its own mesh
+    if (NetworkConfig::get()->usePackedState() && event->data().size() > 0)
+    {
+        const Vec3 position_min = event->data().getVec3();
+        const Vec3 position_max = event->data().getVec3();
+        const float position_resolution = event->data().getFloat();
+        BitNetworkWriter::setPositionRange(position_min, position_max,
+                                           position_resolution);
+    }
+
     core::stringw err_msg = _("Failed to start the network game.");
     joinStartGameThread();
     m_start_game_thread = std::thread([start_time, this, err_msg]()
@@ -153,6 +153,8 @@ public:
     virtual void setup() OVERRIDE;
     virtual void update(int ticks) OVERRIDE;
     virtual void asynchronousUpdate() OVERRIDE {}
+    virtual int getAsynchronousUpdateInterval() const OVERRIDE
+                                                                 { return -1; }
     virtual bool allPlayersReady() const OVERRIDE
                                            { return m_state.load() >= RACING; }
     bool waitingForServerRespond() const
@@ -36,6 +36,9 @@ public:
     virtual void update(int ticks) OVERRIDE;
     virtual void asynchronousUpdate() OVERRIDE {}
     // ------------------------------------------------------------------------
+    virtual int getAsynchronousUpdateInterval() const OVERRIDE
+                                                                 { return -1; }
+    // ------------------------------------------------------------------------
     virtual bool notifyEventAsynchronous(Event* event) OVERRIDE
     {
         return false;
@@ -21,7 +21,7 @@
 #include "items/network_item_manager.hpp"
 #include "karts/abstract_kart.hpp"
 #include "karts/controller/player_controller.hpp"
-#include "modes/world.hpp"
+#include "modes/linear_world.hpp"
 #include "network/event.hpp"
 #include "network/network_config.hpp"
 #include "network/game_setup.hpp"
@@ -30,12 +30,20 @@
 #include "network/protocol_manager.hpp"
 #include "network/rewind_info.hpp"
 #include "network/rewind_manager.hpp"
+#include "network/rewinder.hpp"
+#include "network/server_config.hpp"
+#include "network/state_delta.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
+#include "tracks/arena_graph.hpp"
+#include "tracks/track.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 #include "main_loop.hpp"
 
+#include <algorithm>
+#include <limits>
+
 // ============================================================================
 std::weak_ptr<GameProtocol> GameProtocol::m_game_protocol;
 // ============================================================================
@@ -57,6 +65,7 @@ GameProtocol::GameProtocol()
             : Protocol(PROTOCOL_CONTROLLER_EVENTS)
 {
     m_data_to_send = getNetworkString();
+    m_state_count = 0;
 }   // GameProtocol
 
 //-----------------------------------------------------------------------------
@@ -125,6 +134,9 @@ bool GameProtocol::notifyEventAsynchronous(Event* event)
     {
     case GP_CONTROLLER_ACTION: handleControllerAction(event); break;
     case GP_STATE:             handleState(event);            break;
+    case GP_STATE_DELTA:       handleStateDelta(event);       break;
+    case GP_STATE_ACK:         handleStateAck(event);         break;
+    case GP_REWINDER_IDS:      handleRewinderIds(event);      break;
     case GP_ITEM_CONFIRMATION: handleItemEventConfirmation(event); break;
     case GP_ADJUST_TIME:
     case GP_ITEM_UPDATE:
@@ -160,13 +172,12 @@ void GameProtocol::controllerAction(int kart_id, PlayerAction action,
 
     m_all_actions.push_back(a);
     const auto& c = compressAction(a);
-    // Store the event in the rewind manager, which is responsible
-    // for freeing the allocated memory
-    BareNetworkString *s = new BareNetworkString(4);
-    s->addUInt8(kart_id).addUInt8(std::get<0>(c)).addUInt16(std::get<1>(c))
+    // Store the event in the rewind manager, which copies the data
+    BareNetworkString s(9);
+    s.addUInt8(kart_id).addUInt8(std::get<0>(c)).addUInt16(std::get<1>(c))
         .addUInt16(std::get<2>(c)).addUInt16(std::get<3>(c));
 
-    RewindManager::get()->addEvent(this, s, /*confirmed*/true,
+    RewindManager::get()->addEvent(this, &s, /*confirmed*/true,
                                    World::getWorld()->getTicksSinceStart());
 }   // controllerAction
 
@@ -221,10 +232,10 @@ void GameProtocol::handleControllerAction(Event *event)
                 cur_ticks, kart_id, std::get<0>(a), std::get<1>(a),
                 std::get<2>(a), std::get<3>(a));
         }
-        BareNetworkString *s = new BareNetworkString(3);
-        s->addUInt8(kart_id).addUInt8(w).addUInt16(x).addUInt16(y)
+        BareNetworkString s(9);
+        s.addUInt8(kart_id).addUInt8(w).addUInt16(x).addUInt16(y)
             .addUInt16(z);
-        RewindManager::get()->addNetworkEvent(this, s, cur_ticks);
+        RewindManager::get()->addNetworkEvent(this, &s, cur_ticks);
     }
 
     if (data.size() > 0)
@@ -280,31 +291,72 @@ void GameProtocol::handleItemEventConfirmation(Event *event)
 void GameProtocol::startNewState()
 {
     assert(NetworkConfig::get()->isServer());
+    // Start again with new ids before running out of them, all clients get
+    // the new ids before the next state. Old states still in transit are
+    // discarded by enet once the reliable message with the ids arrived.
+    if (m_rewinder_names.size() > 60000)
+    {
+        m_rewinder_ids.clear();
+        m_rewinder_names.clear();
+        m_sent_rewinder_ids.clear();
+    }
     m_data_to_send->clear();
     m_data_to_send->addUInt8(GP_STATE)
         .addUInt32(World::getWorld()->getTicksSinceStart());
 }   // startNewState
 
 // ----------------------------------------------------------------------------
-/** Called by a server to add data to the current state. The data in buffer
- *  is copied, so the data can be freed after this call/.
- *  \param buffer Adds the data in the buffer to the current state.
+/** Called by a server to add the data of a rewinder to the current state.
+ *  The rewinder saves its state directly into the message, the size (and
+ *  id) in front of the data are filled in afterwards.
+ *  \param rewinder The rewinder to save.
+ *  \param rewinder_using The unique identity of the rewinder is added to it
+ *         if the rewinder saved a state.
+ *  \return Number of bytes saved by the rewinder.
  */
-void GameProtocol::addState(BareNetworkString *buffer)
+unsigned GameProtocol::addState(Rewinder* rewinder,
+                                std::vector<std::string>* rewinder_using)
 {
     assert(NetworkConfig::get()->isServer());
-    m_data_to_send->addUInt16(buffer->size());
-    (*m_data_to_send) += *buffer;
+    const bool rewinder_ids = NetworkConfig::get()->useRewinderIds();
+    std::vector<uint8_t>& buffer = m_data_to_send->getBuffer();
+    const unsigned start = (unsigned)buffer.size();
+    const unsigned header_size = rewinder_ids ? 4 : 2;
+    buffer.resize(start + header_size);
+    if (!rewinder->saveState(m_data_to_send, rewinder_using))
+    {
+        buffer.resize(start);
+        return 0;
+    }
+
+    const unsigned size = (unsigned)buffer.size() - start - header_size;
+    uint8_t* header = buffer.data() + start;
+    if (rewinder_ids)
+    {
+        const uint16_t id = getRewinderId(rewinder_using->back());
+        *header++ = (id >> 8) & 0xff;
+        *header++ = id & 0xff;
+    }
+    header[0] = (size >> 8) & 0xff;
+    header[1] = size & 0xff;
+    return size;
 }   // addState
 
 // ----------------------------------------------------------------------------
 /** Called by a server to finalize the current state, which add updated
- *  names of rewinder using to the beginning of state buffer
+ *  names of rewinder using to the beginning of state buffer, unless the
+ *  rewinders are referred to by their ids.
  *  \param cur_rewinder List of current rewinder using.
  */
 void GameProtocol::finalizeState(std::vector<std::string>& cur_rewinder)
 {
     assert(NetworkConfig::get()->isServer());
+    if (NetworkConfig::get()->useRewinderIds())
+    {
+        // The id of each rewinder was added in front of its data already
+        m_state_rewinders = cur_rewinder;
+        return;
+    }
     auto& buffer = m_data_to_send->getBuffer();
     auto pos = buffer.begin() + 1/*protocol type*/ + 1 /*gp event type*/+
         4/*time*/;
@@ -319,18 +371,326 @@ void GameProtocol::finalizeState(std::vector<std::string>& cur_rewinder)
         names.insert(names.end(), rewinder.begin(), rewinder.end());
     }
     buffer.insert(pos, names.begin(), names.end());
+    m_state_rewinders = cur_rewinder;
 }   // finalizeState
 
+// ----------------------------------------------------------------------------
+/** Returns the id of a rewinder on the server. Rewinders not used in a state
+ *  before get a new id, which is sent to the clients in sendState.
+ *  \param name Unique identity of the rewinder.
+ */
+uint16_t GameProtocol::getRewinderId(const std::string& name)
+{
+    auto it = m_rewinder_ids.find(name);
+    if (it != m_rewinder_ids.end())
+        return it->second;
+    const uint16_t id = (uint16_t)m_rewinder_names.size();
+    m_rewinder_ids[name] = id;
+    m_rewinder_names.push_back(name);
+    return id;
+}   // getRewinderId
+
+// ----------------------------------------------------------------------------
+/** Sends the names of all rewinder ids starting from first_id reliably to a
+ *  client. It is sent before the state using them on the same channel, so
+ *  the client knows the names when the state arrives.
+ *  \param peer The client.
+ *  \param first_id The first id the client does not know.
+ */
+void GameProtocol::sendRewinderIds(STKPeer* peer, unsigned first_id)
+{
+    NetworkString* ns = getNetworkString();
+    ns->addUInt8(GP_REWINDER_IDS).addUInt16((uint16_t)first_id)
+        .addUInt16((uint16_t)(m_rewinder_names.size() - first_id));
+    for (unsigned i = first_id; i < m_rewinder_names.size(); i++)
+        ns->encodeString(m_rewinder_names[i]);
+    peer->sendPacket(ns, /*reliable*/true);
+    delete ns;
+}   // sendRewinderIds
+
+// ----------------------------------------------------------------------------
+/** Called on a client when the server assigned ids to rewinders. A first id
+ *  of 0 replaces all previous ids.
+ */
+void GameProtocol::handleRewinderIds(Event *event)
+{
+    if (!NetworkConfig::get()->isClient() || !checkDataSize(event, 4))
+        return;
+    NetworkString& data = event->data();
+    const unsigned first_id = data.getUInt16();
+    const unsigned count = data.getUInt16();
+    m_rewinder_names.resize(first_id);
+    for (unsigned i = 0; i < count; i++)
+    {
+        std::string name;
+        data.decodeString(&name);
+        m_rewinder_names.push_back(name);
+    }
+}   // handleRewinderIds
+
+// ----------------------------------------------------------------------------
+/** Returns the distance between two karts, along the drive graph in linear
+ *  races and along the arena graph in battle and soccer, the straight line
+ *  distance is used if no graph distance is available.
+ */
+static float getKartDistance(const AbstractKart* a, const AbstractKart* b)
+{
+    World* world = World::getWorld();
+    LinearWorld* lw = dynamic_cast<LinearWorld*>(world);
+    const float track_length = Track::getCurrentTrack()->getTrackLength();
+    if (lw && track_length > 0.0f)
+    {
+        float distance = fabsf(
+            lw->getDistanceDownTrackForKart(a->getWorldKartId(), false) -
+            lw->getDistanceDownTrackForKart(b->getWorldKartId(), false));
+        distance = fmodf(distance, track_length);
+        return std::min(distance, track_length - distance);
+    }
+    WorldWithRank* wwr = dynamic_cast<WorldWithRank*>(world);
+    ArenaGraph* ag = ArenaGraph::get();
+    if (wwr && ag)
+    {
+        int node_a = wwr->getSectorForKart(a);
+        int node_b = wwr->getSectorForKart(b);
+        if (node_a != Graph::UNKNOWN_SECTOR && node_b != Graph::UNKNOWN_SECTOR)
+            return ag->getDistance(node_a, node_b);
+    }
+    return (a->getXYZ() - b->getXYZ()).length();
+}   // getKartDistance
+
+// ----------------------------------------------------------------------------
+/** Creates the state to be sent to a client in which karts far away from all
+ *  karts of this client are only included every few states. The entry of a
+ *  skipped kart is kept with a data size of 0, the client will restore the
+ *  state it predicted locally for it (see RewindInfoState::restore). Every
+ *  interest-max-interval states all karts are included, so each client
+ *  gets a full state at least that often, even if the interval of a kart
+ *  changes with its distance.
+ *  \param peer The client to create the state for.
+ *  \param full_state The state containing all rewinders.
+ *  \return full_state if no kart is skipped, otherwise a new state.
+ */
+std::shared_ptr<std::vector<uint8_t> > GameProtocol::createInterestState(
+    STKPeer* peer, std::shared_ptr<std::vector<uint8_t> > full_state)
+{
+    const float interest_distance = ServerConfig::m_interest_distance;
+    const int max_interval = ServerConfig::m_interest_max_interval;
+    const std::set<unsigned>& own_karts = peer->getAvailableKartIDs();
+    // Spectators have no kart to measure the distance from
+    if (interest_distance <= 0.0f || max_interval <= 1 || own_karts.empty())
+        return full_state;
+    if (m_state_count % max_interval == 0)
+        return full_state;
+
+    World* world = World::getWorld();
+    std::vector<bool> skipped(m_state_rewinders.size(), false);
+    bool skip_any = false;
+    for (unsigned i = 0; i < m_state_rewinders.size(); i++)
+    {
+        const std::string& name = m_state_rewinders[i];
+        if (name.size() != 2 || name[0] != RN_KART)
+            continue;
+        const unsigned kart_id = (uint8_t)name[1];
+        if (kart_id >= world->getNumKarts() ||
+            own_karts.find(kart_id) != own_karts.end())
+            continue;
+
+        float distance = std::numeric_limits<float>::max();
+        for (unsigned own_kart : own_karts)
+        {
+            if (own_kart >= world->getNumKarts())
+                continue;
+            distance = std::min(distance, getKartDistance(
+                world->getKart(own_kart), world->getKart(kart_id)));
+        }
+        int interval = max_interval;
+        if (distance < interest_distance * max_interval)
+            interval = 1 + (int)(distance / interest_distance);
+        interval = std::min(interval, max_interval);
+        // Use the kart id as offset, so not all far away karts are updated
+        // in the same state
+        if ((m_state_count + kart_id) % interval != 0)
+        {
+            skipped[i] = true;
+            skip_any = true;
+        }
+    }
+    if (!skip_any)
+        return full_state;
+
+    // Each rewinder is stored as its id (if rewinder ids are used), the size
+    // of its data and the data
+    unsigned pos = 0;
+    unsigned id_size = 2;
+    if (!NetworkConfig::get()->useRewinderIds())
+    {
+        pos = 1;
+        for (const std::string& name : m_state_rewinders)
+            pos += 1 + (unsigned)name.size();
+        id_size = 0;
+    }
+    const std::vector<uint8_t>& full = *full_state;
+    auto state = std::make_shared<std::vector<uint8_t> >(full.begin(),
+        full.begin() + pos);
+    for (unsigned i = 0; i < m_state_rewinders.size(); i++)
+    {
+        const unsigned data_pos = pos + id_size;
+        const unsigned size = id_size + 2 +
+            ((full[data_pos] << 8) | full[data_pos + 1]);
+        if (skipped[i])
+        {
+            state->insert(state->end(), full.begin() + pos,
+                full.begin() + data_pos);
+            state->push_back(0);
+            state->push_back(0);
+        }
+        else
+        {
+            state->insert(state->end(), full.begin() + pos,
+                full.begin() + pos + size);
+        }
+        pos += size;
+    }
+    return state;
+}   // createInterestState
+
 // ----------------------------------------------------------------------------
 /** Called when the last state information has been added and the message
- *  can be sent to the clients.
+ *  can be sent to the clients. Clients which have acknowledged a recent
+ *  state will only get the difference to that state, all others get the
+ *  full state. Clients supporting it will get far away karts less often.
  */
 void GameProtocol::sendState()
 {
     assert(NetworkConfig::get()->isServer());
-    sendMessageToPeers(m_data_to_send, /*reliable*/false);
+    const int ticks = World::getWorld()->getTicksSinceStart();
+    // Skip protocol type, gp event type and time
+    const unsigned header_size = 1 + 1 + 4;
+    const std::vector<uint8_t>& buffer = m_data_to_send->getBuffer();
+    auto full_state = std::make_shared<std::vector<uint8_t> >(
+        buffer.begin() + header_size, buffer.end());
+    m_state_count++;
+
+    // Delta states are shared by all clients using the same base and state
+    typedef std::pair<const std::vector<uint8_t>*, const std::vector<uint8_t>*>
+        DeltaKey;
+    std::map<DeltaKey, std::unique_ptr<NetworkString> > delta_states;
+    std::vector<std::unique_ptr<NetworkString> > interest_states;
+    // Collect all packets first, so they are encrypted in parallel
+    std::vector<std::pair<STKPeer*, NetworkString*> > packets;
+    auto peers = STKHost::get()->getPeers();
+    std::unique_lock<std::mutex> ul(m_acked_state_mutex);
+    for (auto& peer : peers)
+    {
+        if (!peer->isValidated() || peer->isWaitingForGame())
+        {
+            // Send all ids again if it joins the game later
+            m_sent_rewinder_ids.erase(peer);
+            continue;
+        }
+        if (NetworkConfig::get()->useRewinderIds())
+        {
+            unsigned& sent_ids = m_sent_rewinder_ids[peer];
+            if (sent_ids < m_rewinder_names.size())
+            {
+                sendRewinderIds(peer.get(), sent_ids);
+                sent_ids = (unsigned)m_rewinder_names.size();
+            }
+        }
+        const std::set<std::string>& caps = peer->getClientCapabilities();
+        if (caps.find("state_delta") == caps.end())
+        {
+            packets.emplace_back(peer.get(), m_data_to_send);
+            continue;
+        }
+
+        // Only skip karts for clients which are already receiving states,
+        // so they have a locally predicted state to fall back to
+        auto acked = m_last_acked_state.find(peer);
+        std::shared_ptr<std::vector<uint8_t> > state = full_state;
+        if (acked != m_last_acked_state.end() &&
+            caps.find("state_interest") != caps.end())
+            state = createInterestState(peer.get(), full_state);
+
+        auto& sent = m_sent_states[peer];
+        sent[ticks] = state;
+        while (sent.size() > MAX_DELTA_BASE_STATES)
+            sent.erase(sent.begin());
+
+        NetworkString* full_packet = m_data_to_send;
+        if (state != full_state)
+        {
+            NetworkString* interest_state = getNetworkString(header_size +
+                (int)state->size());
+            interest_states.emplace_back(interest_state);
+            interest_state->addUInt8(GP_STATE).addUInt32(ticks);
+            interest_state->getBuffer().insert(
+                interest_state->getBuffer().end(), state->begin(),
+                state->end());
+            full_packet = interest_state;
+        }
+
+        auto base = acked == m_last_acked_state.end() ?
+            sent.end() : sent.find(acked->second);
+        if (base == sent.end() || base->first >= ticks)
+        {
+            packets.emplace_back(peer.get(), full_packet);
+            continue;
+        }
+
+        std::unique_ptr<NetworkString>& delta =
+            delta_states[DeltaKey(base->second.get(), state.get())];
+        if (!delta)
+        {
+            delta.reset(getNetworkString(full_packet->getTotalSize()));
+            delta->addUInt8(GP_STATE_DELTA).addUInt32(ticks)
+                .addUInt32(base->first);
+            StateDelta::encode(*base->second, state->data(),
+                (unsigned)state->size(), delta.get());
+        }
+        if (delta->getTotalSize() < full_packet->getTotalSize())
+            packets.emplace_back(peer.get(), delta.get());
+        else
+            packets.emplace_back(peer.get(), full_packet);
+    }
+    STKHost::get()->sendPackets(packets, /*reliable*/false);
+
+    // Remove disconnected peers
+    for (auto it = m_last_acked_state.begin();
+         it != m_last_acked_state.end();)
+    {
+        if (it->first.expired())
+            it = m_last_acked_state.erase(it);
+        else
+            it++;
+    }
+    for (auto it = m_sent_states.begin(); it != m_sent_states.end();)
+    {
+        if (it->first.expired())
+            it = m_sent_states.erase(it);
+        else
+            it++;
+    }
+    for (auto it = m_sent_rewinder_ids.begin();
+         it != m_sent_rewinder_ids.end();)
+    {
+        if (it->first.expired())
+            it = m_sent_rewinder_ids.erase(it);
+        else
+            it++;
+    }
 }   // sendState
 
+// ----------------------------------------------------------------------------
+/** Returns true if both server and client support delta states, only used
+ *  by clients.
+ */
+bool GameProtocol::useStateDelta() const
+{
+    return NetworkConfig::get()->getServerCapabilities().find("state_delta")
+        != NetworkConfig::get()->getServerCapabilities().end();
+}   // useStateDelta
+
 // ----------------------------------------------------------------------------
 /** Called when a new full state is received form the server.
  */
@@ -340,22 +700,148 @@ void GameProtocol::handleState(Event *event)
         return;
     NetworkString &data = event->data();
     int ticks          = data.getUInt32();
+    if (useStateDelta())
+    {
+        saveReceivedState(ticks, data);
+        sendStateAck(ticks);
+    }
+    addNetworkState(ticks, data);
+}   // handleState
 
-    // Check for updated rewinder using
-    unsigned rewinder_size = data.getUInt8();
+// ----------------------------------------------------------------------------
+/** Called when a state is received which is encoded as difference to a
+ *  state this client acknowledged before.
+ */
+void GameProtocol::handleStateDelta(Event *event)
+{
+    if (!NetworkConfig::get()->isClient())
+        return;
+    NetworkString &data = event->data();
+    int ticks = data.getUInt32();
+    int base_ticks = data.getUInt32();
+    auto base = m_received_states.find(base_ticks);
+    if (base == m_received_states.end())
+    {
+        // Can happen after going back to lobby in a live game, let the
+        // server send full states again
+        Log::warn("GameProtocol", "Missing base state %d for delta state %d.",
+            base_ticks, ticks);
+        sendStateAck(0);
+        return;
+    }
+
+    BareNetworkString state;
+    if (!StateDelta::decode(base->second, data, &state.getBuffer()))
+    {
+        Log::warn("GameProtocol", "Invalid delta state %d.", ticks);
+        return;
+    }
+    saveReceivedState(ticks, state);
+    sendStateAck(ticks);
+    addNetworkState(ticks, state);
+}   // handleStateDelta
+
+// ----------------------------------------------------------------------------
+/** Stores a received state (starting at the current offset of data), so it
+ *  can be used as base for future delta states.
+ */
+void GameProtocol::saveReceivedState(int ticks, const BareNetworkString& data)
+{
+    m_received_states[ticks].assign(data.getCurrentData(),
+        data.getCurrentData() + data.size());
+    while (m_received_states.size() > MAX_DELTA_BASE_STATES)
+        m_received_states.erase(m_received_states.begin());
+}   // saveReceivedState
+
+// ----------------------------------------------------------------------------
+/** Parses the list of rewinder used in a state and adds the state to the
+ *  rewind manager.
+ *  \param ticks Time of the state.
+ *  \param data The state, with current offset at the list of rewinder (or
+ *         the first rewinder id). The buffer will be taken over by the
+ *         RewindInfoState.
+ */
+void GameProtocol::addNetworkState(int ticks, BareNetworkString& data)
+{
     std::vector<std::string> rewinder_using;
-    for (unsigned i = 0; i < rewinder_size; i++)
+    const bool rewinder_ids = NetworkConfig::get()->useRewinderIds();
+    if (rewinder_ids)
     {
-        std::string name;
-        data.decodeString(&name);
-        rewinder_using.push_back(name);
+        // The data of each rewinder is preceded by its id
+        const int start_offset = data.getCurrentOffset();
+        while (data.size() > 0)
+        {
+            const unsigned id = data.getUInt16();
+            const unsigned size = data.getUInt16();
+            if (id >= m_rewinder_names.size() || size > data.size())
+            {
+                Log::warn("GameProtocol", "Invalid rewinder id %d in state "
+                    "%d.", id, ticks);
+                return;
+            }
+            rewinder_using.push_back(m_rewinder_names[id]);
+            data.skip(size);
+        }
+        data.reset();
+        data.skip(start_offset);
+    }
+    else
+    {
+        // Check for updated rewinder using
+        unsigned rewinder_size = data.getUInt8();
+        for (unsigned i = 0; i < rewinder_size; i++)
+        {
+            std::string name;
+            data.decodeString(&name);
+            rewinder_using.push_back(name);
+        }
     }
 
     // The memory for bns will be handled in the RewindInfoState object
     RewindInfoState* ris = new RewindInfoState(ticks, data.getCurrentOffset(),
-        rewinder_using, data.getBuffer());
+        rewinder_using, data.getBuffer(), rewinder_ids);
     RewindManager::get()->addNetworkRewindInfo(ris);
-}   // handleState
+}   // addNetworkState
+
+// ----------------------------------------------------------------------------
+/** Tells the server which state was received last, so it can be used as
+ *  base for delta states.
+ *  \param ticks Time of the state received, or 0 to request full states.
+ */
+void GameProtocol::sendStateAck(int ticks)
+{
+    assert(NetworkConfig::get()->isClient());
+    NetworkString *ns = getNetworkString(5);
+    ns->addUInt8(GP_STATE_ACK).addUInt32(ticks);
+    // Unreliable, a later state acknowledgement will replace this one anyway
+    sendToServer(ns, /*reliable*/false);
+    delete ns;
+}   // sendStateAck
+
+// ----------------------------------------------------------------------------
+/** Handles a state acknowledgement from a client. Only newer states will
+ *  replace the current base, since unreliable messages can arrive in any
+ *  order. A time of 0 means the client needs a full state.
+ *  \param event The data from the client.
+ */
+void GameProtocol::handleStateAck(Event *event)
+{
+    if (!NetworkConfig::get()->isServer() || !checkDataSize(event, 4))
+        return;
+    int ticks = event->data().getTime();
+    std::lock_guard<std::mutex> lock(m_acked_state_mutex);
+    std::weak_ptr<STKPeer> peer = event->getPeerSP();
+    if (ticks == 0)
+    {
+        m_last_acked_state.erase(peer);
+        return;
+    }
+    auto it = m_last_acked_state.find(peer);
+    if (it == m_last_acked_state.end())
+        m_last_acked_state[peer] = ticks;
+    else if (ticks > it->second)
+        it->second = ticks;
+}   // handleStateAck
 
 // ----------------------------------------------------------------------------
 /** Called from the RewindManager when rolling back.
@@ -27,12 +27,15 @@
 #include "utils/singleton.hpp"
 
 #include <cstdlib>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <tuple>
 
 class BareNetworkString;
 class NetworkString;
+class Rewinder;
 class STKPeer;
 
 class GameProtocol : public Protocol
@@ -48,13 +51,57 @@ private:
            GP_STATE,
            GP_ITEM_UPDATE,
            GP_ITEM_CONFIRMATION,
-           GP_ADJUST_TIME
+           GP_ADJUST_TIME,
+           GP_STATE_DELTA,
+           GP_STATE_ACK,
+           GP_REWINDER_IDS
     };
 
     /** A network string that collects all information from the server to be sent
      *  next. */
     NetworkString *m_data_to_send;
 
+    /** On the server: the latest states sent to each client supporting
+     *  delta states (without the message header), indexed by ticks. They are
+     *  used as base for delta states, and shared if clients got the same
+     *  state. */
+    std::map<std::weak_ptr<STKPeer>,
+        std::map<int, std::shared_ptr<std::vector<uint8_t> > >,
+        std::owner_less<std::weak_ptr<STKPeer> > > m_sent_states;
+
+    /** On the server: the rewinders in the current state, in the order
+     *  their data is stored. */
+    std::vector<std::string> m_state_rewinders;
+
+    /** On the server: the id of each rewinder name, if states use rewinder
+     *  ids (see NetworkConfig::useRewinderIds). */
+    std::map<std::string, uint16_t> m_rewinder_ids;
+
+    /** The rewinder name of each id, on the server in the order the ids
+     *  were assigned, on the client as received from the server. */
+    std::vector<std::string> m_rewinder_names;
+
+    /** On the server: number of rewinder ids each client has received. */
+    std::map<std::weak_ptr<STKPeer>, unsigned,
+        std::owner_less<std::weak_ptr<STKPeer> > > m_sent_rewinder_ids;
+
+    /** On the server: number of states sent, used to spread the updates of
+     *  far away karts over different states. */
+    unsigned m_state_count;
+
+    /** On the client: the latest states received, indexed by ticks. They
+     *  are needed to reconstruct delta states from the server. */
+    std::map<int, std::vector<uint8_t> > m_received_states;
+
+    /** Protects m_last_acked_state, which is updated by the network thread
+     *  while the main thread sends states. */
+    std::mutex m_acked_state_mutex;
+
+    /** Stores on the server the latest state ticks acknowledged by each
+     *  client, only clients which support delta states will be listed. */
+    std::map<std::weak_ptr<STKPeer>, int,
+        std::owner_less<std::weak_ptr<STKPeer> > > m_last_acked_state;
+
     /** The server might request that the world clock of a client is adjusted
      *  to reduce number of rollbacks. */
     std::vector<int8_t> m_adjust_time;
@@ -75,6 +122,17 @@ private:
 
     void handleControllerAction(Event *event);
     void handleState(Event *event);
+    void handleStateDelta(Event *event);
+    void handleStateAck(Event *event);
+    void handleRewinderIds(Event *event);
+    uint16_t getRewinderId(const std::string& name);
+    void sendRewinderIds(STKPeer* peer, unsigned first_id);
+    void addNetworkState(int ticks, BareNetworkString& data);
+    void saveReceivedState(int ticks, const BareNetworkString& data);
+    void sendStateAck(int ticks);
+    bool useStateDelta() const;
+    std::shared_ptr<std::vector<uint8_t> > createInterestState(
+        STKPeer* peer, std::shared_ptr<std::vector<uint8_t> > full_state);
     void handleAdjustTime(Event *event);
     void handleItemEventConfirmation(Event *event);
     static std::weak_ptr<GameProtocol> m_game_protocol;
@@ -101,6 +159,12 @@ private:
         return std::make_tuple(a, b, c, d);
     }
 public:
+    /** Maximum number of states kept on server and client to be used as base
+     *  for delta states (and on the client as locally predicted states). A
+     *  client acknowledging a state later than this number of states will
+     *  receive full states. */
+    static const unsigned MAX_DELTA_BASE_STATES = 32;
+
              GameProtocol();
     virtual ~GameProtocol();
 
@@ -110,7 +174,8 @@ public:
     void controllerAction(int kart_id, PlayerAction action,
                           int value, int val_l, int val_r);
     void startNewState();
-    void addState(BareNetworkString *buffer);
+    unsigned addState(Rewinder* rewinder,
+                      std::vector<std::string>* rewinder_using);
     void sendState();
     void finalizeState(std::vector<std::string>& cur_rewinder);
     void sendItemEventConfirmation(int ticks);
@@ -122,6 +187,9 @@ public:
     // ------------------------------------------------------------------------
     virtual void asynchronousUpdate() OVERRIDE {}
     // ------------------------------------------------------------------------
+    virtual int getAsynchronousUpdateInterval() const OVERRIDE
+                                                                 { return -1; }
+    // ------------------------------------------------------------------------
     static std::shared_ptr<GameProtocol> createInstance();
     // ------------------------------------------------------------------------
     static bool emptyInstance()
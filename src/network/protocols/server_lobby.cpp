@@ -27,7 +27,9 @@
 #include "karts/kart_properties_manager.hpp"
 #include "modes/capture_the_flag.hpp"
 #include "modes/linear_world.hpp"
+#include "network/bit_network_string.hpp"
 #include "network/crypto.hpp"
+#include "network/database_connector.hpp"
 #include "network/event.hpp"
 #include "network/game_setup.hpp"
 #include "network/network_config.hpp"
@@ -39,6 +41,7 @@
 #include "network/protocols/game_events_protocol.hpp"
 #include "network/race_event_manager.hpp"
 #include "network/server_config.hpp"
+#include "network/server_rooms.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 #include "online/online_profile.hpp"
@@ -132,7 +135,8 @@ ServerLobby::ServerLobby() : LobbyProtocol()
     m_has_created_server_id_file = false;
     setHandleDisconnections(true);
     m_state = SET_PUBLIC_ADDRESS;
-    m_save_server_config = true;
+    // Rooms change the port and name, which must not be saved
+    m_save_server_config = ServerRooms::getCurrentRoom() == -1;
     if (ServerConfig::m_ranked)
     {
         Log::info("ServerLobby", "This server will submit ranking scores to "
@@ -174,6 +178,7 @@ void ServerLobby::initDatabase()
 #ifdef ENABLE_SQLITE3
     m_last_cleanup_db_time = StkTime::getMonoTimeMs();
     m_db = NULL;
+    m_db_connector = NULL;
     m_ip_ban_table_exists = false;
     m_online_id_ban_table_exists = false;
     m_ip_geolocation_table_exists = false;
@@ -210,6 +215,7 @@ void ServerLobby::initDatabase()
         m_player_reports_table_exists);
     checkTableExists(ServerConfig::m_ip_geolocation_table,
         m_ip_geolocation_table_exists);
+    m_db_connector = new DatabaseConnector(m_db);
 #endif
 }   // initDatabase
 
@@ -428,6 +434,9 @@ void ServerLobby::destroyDatabase()
     auto peers = STKHost::get()->getPeers();
     for (auto& peer : peers)
         writeDisconnectInfoTable(peer.get());
+    // Waits for all queued queries
+    delete m_db_connector;
+    m_db_connector = NULL;
     if (m_db != NULL)
         sqlite3_close(m_db);
 #endif
@@ -437,13 +446,18 @@ void ServerLobby::destroyDatabase()
 void ServerLobby::writeDisconnectInfoTable(STKPeer* peer)
 {
 #ifdef ENABLE_SQLITE3
-    if (m_server_stats_table.empty())
+    if (m_server_stats_table.empty() || !m_db_connector)
         return;
     std::string query = StringUtils::insertValues(
-        "UPDATE %s SET disconnected_time = datetime('now'), ping = %d "
-        "WHERE host_id = %u;", m_server_stats_table.c_str(),
-        peer->getAveragePing(), peer->getHostId());
-    easySQLQuery(query);
+        "UPDATE %s SET disconnected_time = datetime('now'), ping = ? "
+        "WHERE host_id = ?;", m_server_stats_table.c_str());
+    const int ping = peer->getAveragePing();
+    const uint32_t host_id = peer->getHostId();
+    m_db_connector->write(query, [ping, host_id](sqlite3_stmt* stmt)
+        {
+            sqlite3_bind_int(stmt, 1, ping);
+            sqlite3_bind_int64(stmt, 2, host_id);
+        });
 #endif
 }   // writeDisconnectInfoTable
 
@@ -737,7 +751,7 @@ void ServerLobby::createServerIdFile()
  */
 void ServerLobby::cleanupDatabase()
 {
-    if (!ServerConfig::m_sql_management || !m_db)
+    if (!ServerConfig::m_sql_management || !m_db_connector)
         return;
 
     if (StkTime::getMonoTimeMs() < m_last_cleanup_db_time + 60000)
@@ -754,7 +768,7 @@ void ServerLobby::cleanupDatabase()
             "(reported_time, '+%f days') < datetime('now');",
             ServerConfig::m_player_reports_table.c_str(),
             ServerConfig::m_player_reports_expired_days);
-        easySQLQuery(query);
+        m_db_connector->write(query);
     }
     if (m_server_stats_table.empty())
         return;
@@ -794,12 +808,13 @@ void ServerLobby::cleanupDatabase()
         oss << ");";
         query = oss.str();
     }
-    easySQLQuery(query);
+    m_db_connector->write(query);
 }   // cleanupDatabase
 
 //-----------------------------------------------------------------------------
 /** Run simple query with write lock waiting and optional function, this
- *  function has no callback for the return (if any) by the query.
+ *  function has no callback for the return (if any) by the query. It blocks
+ *  the calling thread, so it is only used when initializing the database.
  *  Return true if no error occurs
  */
 bool ServerLobby::easySQLQuery(const std::string& query,
@@ -877,44 +892,44 @@ void ServerLobby::checkTableExists(const std::string& table, bool& result)
 }   // checkTableExists
 
 //-----------------------------------------------------------------------------
-std::string ServerLobby::ip2Country(const TransportAddress& addr) const
+/** Looks up the country code of a connecting peer in the ip geolocation
+ *  table, the result is saved in m_peers_country_code.
+ */
+void ServerLobby::ip2Country(std::shared_ptr<STKPeer> peer)
 {
-    if (!m_db || !m_ip_geolocation_table_exists || addr.isLAN())
-        return "";
+    const TransportAddress& addr = peer->getAddress();
+    if (!m_db_connector || !m_ip_geolocation_table_exists || addr.isLAN())
+        return;
 
-    std::string cc_code;
     std::string query = StringUtils::insertValues(
         "SELECT country_code FROM %s "
-        "WHERE `ip_start` <= %d AND `ip_end` >= %d "
+        "WHERE `ip_start` <= ? AND `ip_end` >= ? "
         "ORDER BY `ip_start` DESC LIMIT 1;",
-        ServerConfig::m_ip_geolocation_table.c_str(), addr.getIP(),
-        addr.getIP());
-
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
-    {
-        ret = sqlite3_step(stmt);
-        if (ret == SQLITE_ROW)
+        ServerConfig::m_ip_geolocation_table.c_str());
+    const uint32_t ip = addr.getIP();
+    std::weak_ptr<STKPeer> peer_weak = peer;
+    m_db_connector->read(query,
+        [this, peer_weak](bool success,
+                          const std::vector<DatabaseConnector::Row>& rows)
         {
-            const char* country_code = (char*)sqlite3_column_text(stmt, 0);
-            cc_code = country_code;
-        }
-        ret = sqlite3_finalize(stmt);
-        if (ret != SQLITE_OK)
+            if (!success || rows.empty() || peer_weak.expired())
+                return;
+            // Remove peers which disconnected before using the country code
+            for (auto it = m_peers_country_code.begin();
+                 it != m_peers_country_code.end();)
+            {
+                if (it->first.expired())
+                    it = m_peers_country_code.erase(it);
+                else
+                    it++;
+            }
+            m_peers_country_code[peer_weak] = rows[0][0];
+        },
+        [ip](sqlite3_stmt* stmt)
         {
-            Log::error("ServerLobby",
-                "Error finalize database for query %s: %s",
-                query.c_str(), sqlite3_errmsg(m_db));
-        }
-    }
-    else
-    {
-        Log::error("ServerLobby", "Error preparing database for query %s: %s",
-            query.c_str(), sqlite3_errmsg(m_db));
-        return "";
-    }
-    return cc_code;
+            sqlite3_bind_int64(stmt, 1, ip);
+            sqlite3_bind_int64(stmt, 2, ip);
+        });
 }   // ip2Country
 
 #endif
@@ -923,7 +938,7 @@ std::string ServerLobby::ip2Country(const TransportAddress& addr) const
 void ServerLobby::writePlayerReport(Event* event)
 {
 #ifdef ENABLE_SQLITE3
-    if (!m_db || !m_player_reports_table_exists)
+    if (!m_db_connector || !m_player_reports_table_exists)
         return;
     STKPeer* reporter = event->getPeer();
     if (!reporter->hasPlayerProfiles())
@@ -967,8 +982,16 @@ void ServerLobby::writePlayerReport(Event* event)
             reporter->getAddress().getIP(), reporter_npp->getOnlineId(),
             reporting_peer->getAddress().getIP(), reporting_npp->getOnlineId());
     }
-    bool written = easySQLQuery(query,
-        [reporter_npp, reporting_npp, info](sqlite3_stmt* stmt)
+    // Values are bound in the database thread, so only copies are used
+    const std::string reporter_name =
+        StringUtils::wideToUtf8(reporter_npp->getName());
+    const std::string info_utf8 = StringUtils::wideToUtf8(info);
+    const std::string reporting_name =
+        StringUtils::wideToUtf8(reporting_npp->getName());
+    std::weak_ptr<STKPeer> reporter_weak = event->getPeerSP();
+    const core::stringw reporting_wname = reporting_npp->getName();
+    m_db_connector->write(query,
+        [reporter_name, info_utf8, reporting_name](sqlite3_stmt* stmt)
         {
             // SQLITE_TRANSIENT to copy string
             if (sqlite3_bind_text(stmt, 1, ServerConfig::m_server_uid.c_str(),
@@ -977,40 +1000,60 @@ void ServerLobby::writePlayerReport(Event* event)
                 Log::error("easySQLQuery", "Failed to bind %s.",
                     ServerConfig::m_server_uid.c_str());
             }
-            if (sqlite3_bind_text(stmt, 2,
-                StringUtils::wideToUtf8(reporter_npp->getName()).c_str(),
+            if (sqlite3_bind_text(stmt, 2, reporter_name.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    StringUtils::wideToUtf8(reporter_npp->getName()).c_str());
+                    reporter_name.c_str());
             }
-            if (sqlite3_bind_text(stmt, 3,
-                StringUtils::wideToUtf8(info).c_str(),
+            if (sqlite3_bind_text(stmt, 3, info_utf8.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    StringUtils::wideToUtf8(info).c_str());
+                    info_utf8.c_str());
             }
-            if (sqlite3_bind_text(stmt, 4,
-                StringUtils::wideToUtf8(reporting_npp->getName()).c_str(),
+            if (sqlite3_bind_text(stmt, 4, reporting_name.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    StringUtils::wideToUtf8(reporting_npp->getName()).c_str());
+                    reporting_name.c_str());
             }
+        },
+        [this, reporter_weak, reporting_wname](bool written)
+        {
+            auto reporter = reporter_weak.lock();
+            if (!written || !reporter)
+                return;
+            NetworkString* success = getNetworkString();
+            success->setSynchronous(true);
+            success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
+                .encodeString(reporting_wname);
+            reporter->sendPacket(success, true/*reliable*/);
+            delete success;
         });
-    if (written)
-    {
-        NetworkString* success = getNetworkString();
-        success->setSynchronous(true);
-        success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
-            .encodeString(reporting_npp->getName());
-        event->getPeer()->sendPacket(success, true/*reliable*/);
-        delete success;
-    }
 #endif
 }   // writePlayerReport
 
+//-----------------------------------------------------------------------------
+/** While waiting for players only timeouts of seconds and the STK server need
+ *  to be polled, messages of players wake up the protocol manager anyway. */
+int ServerLobby::getAsynchronousUpdateInterval() const
+{
+    return m_state.load() == WAITING_FOR_START_GAME ? 50 : 2;
+}   // getAsynchronousUpdateInterval
+
+//-----------------------------------------------------------------------------
+/** Changes the state of the lobby and wakes up the asynchronous update
+ *  thread, so that it handles the new state without waiting until the end
+ *  of its update interval (see getAsynchronousUpdateInterval).
+ */
+void ServerLobby::setState(ServerState state)
+{
+    m_state.store(state);
+    if (auto pm = ProtocolManager::lock())
+        pm->requestAsynchronousUpdate();
+}   // setState
+
 //-----------------------------------------------------------------------------
 /** Find out the public IP server or poll STK server asynchronously. */
 void ServerLobby::asynchronousUpdate()
@@ -1023,6 +1066,8 @@ void ServerLobby::asynchronousUpdate()
     }
 
 #ifdef ENABLE_SQLITE3
+    if (m_db_connector)
+        m_db_connector->handleResults();
     cleanupDatabase();
 #endif
 
@@ -1057,7 +1102,7 @@ void ServerLobby::asynchronousUpdate()
         // STK server, so we can directly go to the accepting clients state.
         if (NetworkConfig::get()->isLAN())
         {
-            m_state = WAITING_FOR_START_GAME;
+            setState(WAITING_FOR_START_GAME);
             STKHost::get()->startListening();
             createServerIdFile();
             return;
@@ -1065,13 +1110,13 @@ void ServerLobby::asynchronousUpdate()
         STKHost::get()->setPublicAddress();
         if (STKHost::get()->getPublicAddress().isUnset())
         {
-            m_state = ERROR_LEAVE;
+            setState(ERROR_LEAVE);
         }
         else
         {
             m_server_address = STKHost::get()->getPublicAddress();
             STKHost::get()->startListening();
-            m_state = REGISTER_SELF_ADDRESS;
+            setState(REGISTER_SELF_ADDRESS);
         }
         break;
     }
@@ -1079,7 +1124,7 @@ void ServerLobby::asynchronousUpdate()
     {
         if (m_game_setup->isGrandPrixStarted() || m_registered_for_once_only)
         {
-            m_state = WAITING_FOR_START_GAME;
+            setState(WAITING_FOR_START_GAME);
             break;
         }
         // Register this server with the STK server. This will block
@@ -1089,12 +1134,12 @@ void ServerLobby::asynchronousUpdate()
         {
             if (allowJoinedPlayersWaiting())
                 m_registered_for_once_only = true;
-            m_state = WAITING_FOR_START_GAME;
+            setState(WAITING_FOR_START_GAME);
             createServerIdFile();
         }
         else
         {
-            m_state = ERROR_LEAVE;
+            setState(ERROR_LEAVE);
         }
         break;
     }
@@ -1134,7 +1179,7 @@ void ServerLobby::asynchronousUpdate()
     case ERROR_LEAVE:
     {
         requestTerminate();
-        m_state = EXITING;
+        setState(EXITING);
         STKHost::get()->requestShutdown();
         break;
     }
@@ -1242,6 +1287,24 @@ void ServerLobby::asynchronousUpdate()
                 }
             }
 
+            // Game states are only bit packed (or use rewinder ids) if all
+            // clients can read them
+            bool packed_state = true;
+            bool rewinder_ids = true;
+            for (auto& peer : STKHost::get()->getPeers())
+            {
+                if (!peer->isValidated())
+                    continue;
+                const std::set<std::string>& caps =
+                    peer->getClientCapabilities();
+                if (caps.find("packed_state") == caps.end())
+                    packed_state = false;
+                if (caps.find("rewinder_ids") == caps.end())
+                    rewinder_ids = false;
+            }
+            NetworkConfig::get()->setPackedState(packed_state);
+            NetworkConfig::get()->setRewinderIds(rewinder_ids);
+
             NetworkString* load_world_message = getLoadWorldMessage(players,
                 false/*live_join*/);
             m_game_setup->setHitCaptureTime(m_battle_hit_capture_limit,
@@ -1256,7 +1319,7 @@ void ServerLobby::asynchronousUpdate()
 
             // Reset for next state usage
             resetPeersReady();
-            m_state = LOAD_WORLD;
+            setState(LOAD_WORLD);
             sendMessageToPeers(load_world_message);
             delete load_world_message;
         }
@@ -1313,9 +1376,38 @@ NetworkString* ServerLobby::getLoadWorldMessage(
             ServerConfig::m_flag_deactivated_time);
         load_world_message->addUInt16(flag_deactivated_time);
     }
+    // Only sent if all clients support it, so older clients never see it:
+    // bit 0 for bit packed states, bit 1 for rewinder ids
+    uint8_t state_flags = 0;
+    if (NetworkConfig::get()->usePackedState())
+        state_flags |= 1;
+    if (NetworkConfig::get()->useRewinderIds())
+        state_flags |= 2;
+    if (state_flags != 0)
+        load_world_message->addUInt8(state_flags);
+    // For a new race the server has not loaded the world yet, the position
+    // range is sent in the start race message then
+    if (live_join)
+        encodePositionRange(load_world_message);
     return load_world_message;
 }   // getLoadWorldMessage
 
+//-----------------------------------------------------------------------------
+/** Adds the range used to quantize positions in bit packed game states to
+ *  the start race message, or to the load world message for live join (after
+ *  the state flags), so that clients use the values of the server instead of
+ *  computing them from their own copy of the track. Must be called after the
+ *  server has loaded the world.
+ */
+void ServerLobby::encodePositionRange(BareNetworkString* bns) const
+{
+    if (!NetworkConfig::get()->usePackedState())
+        return;
+    bns->add(BitNetworkWriter::getPositionMin())
+        .add(BitNetworkWriter::getPositionMax())
+        .addFloat(BitNetworkWriter::getPositionResolution());
+}   // encodePositionRange
+
 //-----------------------------------------------------------------------------
 /** Returns true if server can be live joined or spectating
  */
@@ -1396,6 +1488,16 @@ void ServerLobby::liveJoinRequest(Event* event)
         rejectLiveJoin(peer, BLR_NO_GAME_FOR_LIVE_JOIN);
         return;
     }
+    // The client can't read the states of the current game
+    const std::set<std::string>& caps = peer->getClientCapabilities();
+    if ((NetworkConfig::get()->usePackedState() &&
+        caps.find("packed_state") == caps.end()) ||
+        (NetworkConfig::get()->useRewinderIds() &&
+        caps.find("rewinder_ids") == caps.end()))
+    {
+        rejectLiveJoin(peer, BLR_NO_GAME_FOR_LIVE_JOIN);
+        return;
+    }
     bool spectator = data.getUInt8() == 1;
     if (race_manager->modeHasLaps() && !spectator)
     {
@@ -1800,7 +1902,7 @@ void ServerLobby::update(int ticks)
         Log::info("ServerLobbyRoom", "Starting the race loading.");
         // This will create the world instance, i.e. load track and karts
         loadWorld();
-        m_state = WAIT_FOR_WORLD_LOADED;
+        setState(WAIT_FOR_WORLD_LOADED);
         break;
     case RACING:
         if (World::getWorld() &&
@@ -1821,7 +1923,7 @@ void ServerLobby::update(int ticks)
         // Set the delay before the server forces all clients to exit the race
         // result screen and go back to the lobby
         m_timeout.store((int64_t)StkTime::getMonoTimeMs() + 15000);
-        m_state = RESULT_DISPLAY;
+        setState(RESULT_DISPLAY);
         sendMessageToPeers(m_result_ns, /*reliable*/ true);
         Log::info("ServerLobby", "End of game message sent");
         break;
@@ -2191,7 +2293,7 @@ void ServerLobby::startSelection(const Event *event)
     sendMessageToPeers(ns, /*reliable*/true);
     delete ns;
 
-    m_state = SELECTING;
+    setState(SELECTING);
     if (!allowJoinedPlayersWaiting())
     {
         // Drop all pending players and keys if doesn't allow joinning-waiting
@@ -2394,7 +2496,7 @@ void ServerLobby::checkRaceFinished()
         computeNewRankings();
         submitRankingsToAddons();
     }
-    m_state.store(WAIT_FOR_RACE_STOPPED);
+    setState(WAIT_FOR_RACE_STOPPED);
 }   // checkRaceFinished
 
 //-----------------------------------------------------------------------------
@@ -2723,14 +2825,14 @@ void ServerLobby::kickPlayerWithReason(STKPeer* peer, const char* reason) const
 void ServerLobby::saveIPBanTable(const TransportAddress& addr)
 {
 #ifdef ENABLE_SQLITE3
-    if (!m_db || !m_ip_ban_table_exists)
+    if (!m_db_connector || !m_ip_ban_table_exists)
         return;
 
     std::string query = StringUtils::insertValues(
         "INSERT INTO %s (ip_start, ip_end) "
         "VALUES (%u, %u);",
         ServerConfig::m_ip_ban_table.c_str(), addr.getIP(), addr.getIP());
-    easySQLQuery(query);
+    m_db_connector->write(query);
 #endif
 }   // saveIPBanTable
 
@@ -2866,17 +2968,44 @@ void ServerLobby::connectionRequested(Event* event)
     online_id = data.getUInt32();
     encrypted_size = data.getUInt32();
 
-    // Will be disconnected if banned by IP
-    testBannedForIP(peer.get());
-    if (peer->isDisconnected())
-        return;
-
-    if (online_id != 0)
-        testBannedForOnlineId(peer.get(), online_id);
-    // Will be disconnected if banned by online id
-    if (peer->isDisconnected())
+#ifdef ENABLE_SQLITE3
+    if (m_db_connector)
+    {
+        // Will be disconnected if banned by IP or online id, the database
+        // thread answers these lookups, so continue the request afterwards
+        testBannedForIP(peer);
+        if (online_id != 0)
+            testBannedForOnlineId(peer, online_id);
+        ip2Country(peer);
+        std::weak_ptr<STKPeer> peer_weak = peer;
+        auto remaining = std::make_shared<BareNetworkString>(
+            data.getCurrentData(), data.size());
+        m_db_connector->afterPendingRequests([this, peer_weak, remaining,
+            player_count, online_id, encrypted_size]()
+            {
+                auto peer = peer_weak.lock();
+                if (!peer || peer->isDisconnected())
+                    return;
+                handleConnectionRequest(peer, *remaining, player_count,
+                    online_id, encrypted_size);
+            });
         return;
+    }
+#endif
+    handleConnectionRequest(peer, data, player_count, online_id,
+        encrypted_size);
+}   // connectionRequested
 
+//-----------------------------------------------------------------------------
+/** Handles the rest of a connection request after the ban checks.
+ *  \param data The remaining data of the connection request.
+ */
+void ServerLobby::handleConnectionRequest(std::shared_ptr<STKPeer> peer,
+                                          BareNetworkString& data,
+                                          unsigned player_count,
+                                          uint32_t online_id,
+                                          uint32_t encrypted_size)
+{
     unsigned total_players = 0;
     STKHost::get()->updatePlayers(NULL, NULL, &total_players);
     if (total_players + player_count >
@@ -3007,8 +3136,13 @@ void ServerLobby::handleUnencryptedConnection(std::shared_ptr<STKPeer> peer,
     }
 
 #ifdef ENABLE_SQLITE3
-    if (country_code.empty())
-        country_code = ip2Country(peer->getAddress());
+    auto ip_country = m_peers_country_code.find(peer);
+    if (ip_country != m_peers_country_code.end())
+    {
+        if (country_code.empty())
+            country_code = ip_country->second;
+        m_peers_country_code.erase(ip_country);
+    }
 #endif
 
     auto red_blue = STKHost::get()->getAllPlayersTeamInfo();
@@ -3114,45 +3248,50 @@ void ServerLobby::handleUnencryptedConnection(std::shared_ptr<STKPeer> peer,
         }
     }
 #ifdef ENABLE_SQLITE3
-    if (m_server_stats_table.empty() || peer->isAIPeer())
+    if (m_server_stats_table.empty() || peer->isAIPeer() || !m_db_connector)
         return;
-    std::string query;
-    if (ServerConfig::m_ipv6_server && !peer->getIPV6Address().empty())
-    {
-        // We don't save the internally mapped IPv4 (0.x.x.x)
-        query = StringUtils::insertValues(
-            "INSERT INTO %s "
-            "(host_id, ip, ipv6 ,port, online_id, username, player_num, "
-            "country_code, version, ping) "
-            "VALUES (%u, 0, \"%s\" ,%u, %u, ?, %u, ?, ?, %u);",
-            m_server_stats_table.c_str(), peer->getHostId(),
-            peer->getIPV6Address(), peer->getAddress().getPort(), online_id,
-            player_count, peer->getAveragePing());
-    }
-    else
-    {
-        query = StringUtils::insertValues(
-            "INSERT INTO %s "
-            "(host_id, ip, port, online_id, username, player_num, "
-            "country_code, version, ping) "
-            "VALUES (%u, %u, %u, %u, ?, %u, ?, ?, %u);",
-            m_server_stats_table.c_str(), peer->getHostId(),
-            peer->getAddress().getIP(), peer->getAddress().getPort(),
-            online_id, player_count, peer->getAveragePing());
-    }
-    easySQLQuery(query, [peer, country_code](sqlite3_stmt* stmt)
+    // Values are bound in the database thread, so only copies are used
+    const bool ipv6 = ServerConfig::m_ipv6_server &&
+        !peer->getIPV6Address().empty();
+    std::string query = StringUtils::insertValues(
+        "INSERT INTO %s "
+        "(host_id, ip, %s port, online_id, username, player_num, "
+        "country_code, version, ping) "
+        "VALUES (?, ?, %s ?, ?, ?, ?, ?, ?, ?);",
+        m_server_stats_table.c_str(), ipv6 ? "ipv6," : "", ipv6 ? "?," : "");
+    const uint32_t host_id = peer->getHostId();
+    // We don't save the internally mapped IPv4 (0.x.x.x)
+    const uint32_t ip = ipv6 ? 0 : peer->getAddress().getIP();
+    const std::string ipv6_address = peer->getIPV6Address();
+    const uint16_t port = peer->getAddress().getPort();
+    const std::string username = StringUtils::wideToUtf8(
+        peer->getPlayerProfiles()[0]->getName());
+    const std::string version = peer->getUserVersion();
+    const uint32_t ping = peer->getAveragePing();
+    m_db_connector->write(query, [ipv6, host_id, ip, ipv6_address, port,
+        online_id, username, player_count, country_code, version, ping]
+        (sqlite3_stmt* stmt)
         {
-            if (sqlite3_bind_text(stmt, 1, StringUtils::wideToUtf8(
-                peer->getPlayerProfiles()[0]->getName()).c_str(),
+            int i = 1;
+            sqlite3_bind_int64(stmt, i++, host_id);
+            sqlite3_bind_int64(stmt, i++, ip);
+            if (ipv6)
+            {
+                sqlite3_bind_text(stmt, i++, ipv6_address.c_str(), -1,
+                    SQLITE_TRANSIENT);
+            }
+            sqlite3_bind_int(stmt, i++, port);
+            sqlite3_bind_int64(stmt, i++, online_id);
+            if (sqlite3_bind_text(stmt, i++, username.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    StringUtils::wideToUtf8(
-                    peer->getPlayerProfiles()[0]->getName()).c_str());
+                    username.c_str());
             }
+            sqlite3_bind_int(stmt, i++, player_count);
             if (country_code.empty())
             {
-                if (sqlite3_bind_null(stmt, 2) != SQLITE_OK)
+                if (sqlite3_bind_null(stmt, i++) != SQLITE_OK)
                 {
                     Log::error("easySQLQuery",
                         "Failed to bind NULL for country code.");
@@ -3160,21 +3299,21 @@ void ServerLobby::handleUnencryptedConnection(std::shared_ptr<STKPeer> peer,
             }
             else
             {
-                if (sqlite3_bind_text(stmt, 2, country_code.c_str(),
+                if (sqlite3_bind_text(stmt, i++, country_code.c_str(),
                     -1, SQLITE_TRANSIENT) != SQLITE_OK)
                 {
                     Log::error("easySQLQuery", "Failed to bind country: %s.",
                         country_code.c_str());
                 }
             }
-            if (sqlite3_bind_text(stmt, 3, peer->getUserVersion().c_str(),
+            if (sqlite3_bind_text(stmt, i++, version.c_str(),
                 -1, SQLITE_TRANSIENT) != SQLITE_OK)
             {
                 Log::error("easySQLQuery", "Failed to bind %s.",
-                    peer->getUserVersion().c_str());
+                    version.c_str());
             }
-        }
-    );
+            sqlite3_bind_int64(stmt, i++, ping);
+        });
 #endif
 }   // handleUnencryptedConnection
 
@@ -3884,6 +4023,7 @@ void ServerLobby::configPeersStartTime()
     const uint8_t cc = (uint8_t)CheckManager::get()->getCheckStructureCount();
     ns->addUInt8(cc);
     *ns += *m_items_complete_state;
+    encodePositionRange(ns);
     m_client_starting_time = start_time;
     sendMessageToPeers(ns, /*reliable*/true);
 
@@ -3895,7 +4035,7 @@ void ServerLobby::configPeersStartTime()
     start_time += m_server_delay;
     m_server_started_at = start_time;
     delete ns;
-    m_state = WAIT_FOR_RACE_STARTED;
+    setState(WAIT_FOR_RACE_STARTED);
 
     World::getWorld()->setPhase(WorldStatus::SERVER_READY_PHASE);
     joinStartGameThread();
@@ -3907,7 +4047,7 @@ void ServerLobby::configPeersStartTime()
             Log::info("ServerLobby", "Start game after %dms", sleep_time);
             std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
             Log::info("ServerLobby", "Started at %lf", StkTime::getRealTime());
-            m_state.store(RACING);
+            setState(RACING);
         });
 }   // configPeersStartTime
 
@@ -3969,133 +4109,115 @@ void ServerLobby::resetServer()
     sendMessageToPeersInServer(server_info);
     delete server_info;
     setup();
-    m_state = NetworkConfig::get()->isLAN() ?
-        WAITING_FOR_START_GAME : REGISTER_SELF_ADDRESS;
+    setState(NetworkConfig::get()->isLAN() ?
+        WAITING_FOR_START_GAME : REGISTER_SELF_ADDRESS);
 }   // resetServer
 
 //-----------------------------------------------------------------------------
-void ServerLobby::testBannedForIP(STKPeer* peer) const
+void ServerLobby::testBannedForIP(std::shared_ptr<STKPeer> peer)
 {
 #ifdef ENABLE_SQLITE3
-    if (!m_db || !m_ip_ban_table_exists)
+    if (!m_db_connector || !m_ip_ban_table_exists)
         return;
 
     // We only test for IPv4 atm
     if (!peer->getIPV6Address().empty())
         return;
 
-    int row_id = -1;
-    unsigned ip_start = 0;
-    unsigned ip_end = 0;
     std::string query = StringUtils::insertValues(
         "SELECT rowid, ip_start, ip_end, reason, description FROM %s "
-        "WHERE ip_start <= %u AND ip_end >= %u "
+        "WHERE ip_start <= ? AND ip_end >= ? "
         "AND datetime('now') > datetime(starting_time) AND "
         "(expired_days is NULL OR datetime"
         "(starting_time, '+'||expired_days||' days') > datetime('now')) "
         "LIMIT 1;",
-        ServerConfig::m_ip_ban_table.c_str(),
-        peer->getAddress().getIP(), peer->getAddress().getIP());
-
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
-    {
-        ret = sqlite3_step(stmt);
-        if (ret == SQLITE_ROW)
+        ServerConfig::m_ip_ban_table.c_str());
+    const uint32_t ip = peer->getAddress().getIP();
+    std::weak_ptr<STKPeer> peer_weak = peer;
+    m_db_connector->read(query,
+        [this, peer_weak](bool success,
+                          const std::vector<DatabaseConnector::Row>& rows)
         {
-            row_id = sqlite3_column_int(stmt, 0);
-            ip_start = (unsigned)sqlite3_column_int64(stmt, 1);
-            ip_end = (unsigned)sqlite3_column_int64(stmt, 2);
-            const char* reason = (char*)sqlite3_column_text(stmt, 3);
-            const char* desc = (char*)sqlite3_column_text(stmt, 4);
-            Log::info("ServerLobby", "%s banned by IP: %s "
-                "(rowid: %d, description: %s).",
-                peer->getRealAddress().c_str(), reason, row_id, desc);
-            kickPlayerWithReason(peer, reason);
-        }
-        ret = sqlite3_finalize(stmt);
-        if (ret != SQLITE_OK)
+            if (!success || rows.empty())
+                return;
+            const DatabaseConnector::Row& row = rows[0];
+            auto peer = peer_weak.lock();
+            if (peer && !peer->isDisconnected())
+            {
+                Log::info("ServerLobby", "%s banned by IP: %s "
+                    "(rowid: %s, description: %s).",
+                    peer->getRealAddress().c_str(), row[3].c_str(),
+                    row[0].c_str(), row[4].c_str());
+                kickPlayerWithReason(peer.get(), row[3].c_str());
+            }
+            std::string query = StringUtils::insertValues(
+                "UPDATE %s SET trigger_count = trigger_count + 1, "
+                "last_trigger = datetime('now') "
+                "WHERE ip_start = ? AND ip_end = ?;",
+                ServerConfig::m_ip_ban_table.c_str());
+            const sqlite3_int64 ip_start = atoll(row[1].c_str());
+            const sqlite3_int64 ip_end = atoll(row[2].c_str());
+            m_db_connector->write(query, [ip_start, ip_end](sqlite3_stmt* stmt)
+                {
+                    sqlite3_bind_int64(stmt, 1, ip_start);
+                    sqlite3_bind_int64(stmt, 2, ip_end);
+                });
+        },
+        [ip](sqlite3_stmt* stmt)
         {
-            Log::error("ServerLobby",
-                "Error finalize database for query %s: %s",
-                query.c_str(), sqlite3_errmsg(m_db));
-        }
-    }
-    else
-    {
-        Log::error("ServerLobby", "Error preparing database for query %s: %s",
-            query.c_str(), sqlite3_errmsg(m_db));
-        return;
-    }
-    if (row_id != -1)
-    {
-        query = StringUtils::insertValues(
-            "UPDATE %s SET trigger_count = trigger_count + 1, "
-            "last_trigger = datetime('now') "
-            "WHERE ip_start = %u AND ip_end = %u;",
-            ServerConfig::m_ip_ban_table.c_str(), ip_start, ip_end);
-        easySQLQuery(query);
-    }
+            sqlite3_bind_int64(stmt, 1, ip);
+            sqlite3_bind_int64(stmt, 2, ip);
+        });
 #endif
 }   // testBannedForIP
 
 //-----------------------------------------------------------------------------
-void ServerLobby::testBannedForOnlineId(STKPeer* peer,
-                                        uint32_t online_id) const
+void ServerLobby::testBannedForOnlineId(std::shared_ptr<STKPeer> peer,
+                                        uint32_t online_id)
 {
 #ifdef ENABLE_SQLITE3
-    if (!m_db || !m_online_id_ban_table_exists)
+    if (!m_db_connector || !m_online_id_ban_table_exists)
         return;
 
-    int row_id = -1;
     std::string query = StringUtils::insertValues(
         "SELECT rowid, reason, description FROM %s "
-        "WHERE online_id = %u "
+        "WHERE online_id = ? "
         "AND datetime('now') > datetime(starting_time) AND "
         "(expired_days is NULL OR datetime"
         "(starting_time, '+'||expired_days||' days') > datetime('now')) "
         "LIMIT 1;",
-        ServerConfig::m_online_id_ban_table.c_str(), online_id);
-
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
-    {
-        ret = sqlite3_step(stmt);
-        if (ret == SQLITE_ROW)
+        ServerConfig::m_online_id_ban_table.c_str());
+    std::weak_ptr<STKPeer> peer_weak = peer;
+    m_db_connector->read(query,
+        [this, peer_weak, online_id](bool success,
+            const std::vector<DatabaseConnector::Row>& rows)
         {
-            row_id = sqlite3_column_int(stmt, 0);
-            const char* reason = (char*)sqlite3_column_text(stmt, 1);
-            const char* desc = (char*)sqlite3_column_text(stmt, 2);
-            Log::info("ServerLobby", "%s banned by online id: %s "
-                "(online id: %u rowid: %d, description: %s).",
-                peer->getRealAddress().c_str(), reason, online_id,
-                row_id, desc);
-            kickPlayerWithReason(peer, reason);
-        }
-        ret = sqlite3_finalize(stmt);
-        if (ret != SQLITE_OK)
+            if (!success || rows.empty())
+                return;
+            const DatabaseConnector::Row& row = rows[0];
+            auto peer = peer_weak.lock();
+            if (peer && !peer->isDisconnected())
+            {
+                Log::info("ServerLobby", "%s banned by online id: %s "
+                    "(online id: %u rowid: %s, description: %s).",
+                    peer->getRealAddress().c_str(), row[1].c_str(),
+                    online_id, row[0].c_str(), row[2].c_str());
+                kickPlayerWithReason(peer.get(), row[1].c_str());
+            }
+            std::string query = StringUtils::insertValues(
+                "UPDATE %s SET trigger_count = trigger_count + 1, "
+                "last_trigger = datetime('now') "
+                "WHERE online_id = ?;",
+                ServerConfig::m_online_id_ban_table.c_str());
+            m_db_connector->write(query, [online_id](sqlite3_stmt* stmt)
+                {
+                    sqlite3_bind_int64(stmt, 1, online_id);
+                });
+        },
+        [online_id](sqlite3_stmt* stmt)
         {
-            Log::error("ServerLobby", "Error finalize database: %s",
-                sqlite3_errmsg(m_db));
-        }
-    }
-    else
-    {
-        Log::error("ServerLobby", "Error preparing database: %s",
-            sqlite3_errmsg(m_db));
-        return;
-    }
-    if (row_id != -1)
-    {
-        query = StringUtils::insertValues(
-            "UPDATE %s SET trigger_count = trigger_count + 1, "
-            "last_trigger = datetime('now') "
-            "WHERE online_id = %u;",
-            ServerConfig::m_online_id_ban_table.c_str(), online_id);
-        easySQLQuery(query);
-    }
+            sqlite3_bind_int64(stmt, 1, online_id);
+        });
 #endif
 }   // testBannedForOnlineId
 
@@ -39,6 +39,9 @@
 #endif
 
 class BareNetworkString;
+#ifdef ENABLE_SQLITE3
+class DatabaseConnector;
+#endif
 class NetworkString;
 class NetworkPlayerProfile;
 class STKPeer;
@@ -76,6 +79,15 @@ private:
 #ifdef ENABLE_SQLITE3
     sqlite3* m_db;
 
+    /** Runs all queries after the database is initialized, so they do not
+     *  block the lobby. */
+    DatabaseConnector* m_db_connector;
+
+    /** Country codes found in the ip geolocation table for peers which are
+     *  connecting. */
+    std::map<std::weak_ptr<STKPeer>, std::string,
+        std::owner_less<std::weak_ptr<STKPeer> > > m_peers_country_code;
+
     std::string m_server_stats_table;
 
     bool m_ip_ban_table_exists;
@@ -93,12 +105,14 @@ private:
 
     void checkTableExists(const std::string& table, bool& result);
 
-    std::string ip2Country(const TransportAddress& addr) const;
+    void ip2Country(std::shared_ptr<STKPeer> peer);
 #endif
     void initDatabase();
 
     void destroyDatabase();
 
+    void setState(ServerState state);
+
     std::atomic<ServerState> m_state;
 
     /* The state used in multiple threads when reseting server. */
@@ -310,6 +324,7 @@ private:
     NetworkString* getLoadWorldMessage(
         std::vector<std::shared_ptr<NetworkPlayerProfile> >& players,
         bool live_join) const;
+    void encodePositionRange(BareNetworkString* bns) const;
     void encodePlayers(BareNetworkString* bns,
         std::vector<std::shared_ptr<NetworkPlayerProfile> >& players) const;
     std::vector<std::shared_ptr<NetworkPlayerProfile> > getLivePlayers() const;
@@ -324,8 +339,13 @@ private:
     void clientInGameWantsToBackLobby(Event* event);
     void clientSelectingAssetsWantsToBackLobby(Event* event);
     void kickPlayerWithReason(STKPeer* peer, const char* reason) const;
-    void testBannedForIP(STKPeer* peer) const;
-    void testBannedForOnlineId(STKPeer* peer, uint32_t online_id) const;
+    void testBannedForIP(std::shared_ptr<STKPeer> peer);
+    void testBannedForOnlineId(std::shared_ptr<STKPeer> peer,
+                               uint32_t online_id);
+    void handleConnectionRequest(std::shared_ptr<STKPeer> peer,
+                                 BareNetworkString& data,
+                                 unsigned player_count, uint32_t online_id,
+                                 uint32_t encrypted_size);
     void writeDisconnectInfoTable(STKPeer* peer);
     void writePlayerReport(Event* event);
     bool supportsAI();
@@ -338,6 +358,7 @@ public:
     virtual void setup() OVERRIDE;
     virtual void update(int ticks) OVERRIDE;
     virtual void asynchronousUpdate() OVERRIDE;
+    virtual int getAsynchronousUpdateInterval() const OVERRIDE;
 
     void startSelection(const Event *event=NULL);
     void checkIncomingConnectionRequests();
@@ -49,11 +49,13 @@ void RewindInfo::setTicks(int ticks)
 // ============================================================================
 RewindInfoState::RewindInfoState(int ticks, int start_offset,
                                  std::vector<std::string>& rewinder_using,
-                                 std::vector<uint8_t>& buffer)
+                                 std::vector<uint8_t>& buffer,
+                                 bool rewinder_ids)
                : RewindInfo(ticks, true/*is_confirmed*/)
 {
     std::swap(m_rewinder_using, rewinder_using);
     m_start_offset = start_offset;
+    m_rewinder_ids = rewinder_ids;
     m_buffer = new BareNetworkString();
     std::swap(m_buffer->getBuffer(), buffer);
 }   // RewindInfoState
@@ -66,6 +68,7 @@ RewindInfoState::RewindInfoState(int ticks, BareNetworkString* buffer,
                : RewindInfo(ticks, is_confirmed)
 {
     m_start_offset = 0;
+    m_rewinder_ids = false;
     m_buffer = buffer;
 }   // RewindInfoState
 
@@ -80,6 +83,9 @@ void RewindInfoState::restore()
     m_buffer->skip(m_start_offset);
     for (const std::string& name : m_rewinder_using)
     {
+        // The rewinder ids were resolved to names already
+        if (m_rewinder_ids)
+            m_buffer->skip(2);
         const uint16_t data_size = m_buffer->getUInt16();
         const unsigned current_offset_now = m_buffer->getCurrentOffset();
         std::shared_ptr<Rewinder> r =
@@ -98,6 +104,18 @@ void RewindInfoState::restore()
             m_buffer->skip(data_size);
             continue;
         }
+        if (data_size == 0)
+        {
+            // The server skipped this rewinder for this client in this state
+            // (see GameProtocol::createInterestState), use the state this
+            // client predicted locally instead.
+            if (!RewindManager::get()->restorePredictedState(getTicks(), r))
+            {
+                Log::warn("RewindInfoState", "Missing predicted state of %s "
+                    "at %d", name.c_str(), getTicks());
+            }
+            continue;
+        }
         try
         {
             r->restoreState(m_buffer, data_size);
@@ -123,10 +141,32 @@ void RewindInfoState::restore()
 
 // ============================================================================
 RewindInfoEvent::RewindInfoEvent(int ticks, EventRewinder *event_rewinder,
-                                 BareNetworkString *buffer, bool is_confirmed)
+                                 const BareNetworkString *buffer,
+                                 bool is_confirmed)
                : RewindInfo(ticks, is_confirmed)
 {
-    m_event_rewinder = event_rewinder;
-    m_buffer         = buffer;
+    set(ticks, event_rewinder, buffer, is_confirmed);
 }   // RewindInfoEvent
 
+// ------------------------------------------------------------------------
+/** Sets the data of this event, used when the object is reused for another
+ *  event. The event data is copied, so the buffer remains owned by the
+ *  caller.
+ *  \param buffer The event data, can be NULL for an empty event.
+ */
+void RewindInfoEvent::set(int ticks, EventRewinder *event_rewinder,
+                          const BareNetworkString *buffer, bool is_confirmed)
+{
+    reuse(ticks, is_confirmed);
+    m_event_rewinder = event_rewinder;
+    std::vector<uint8_t>& data = m_buffer.getBuffer();
+    if (buffer)
+    {
+        const uint8_t* start = (const uint8_t*)buffer->getData();
+        data.assign(start, start + buffer->getTotalSize());
+    }
+    else
+        data.clear();
+    m_buffer.reset();
+}   // set
+
@@ -54,6 +54,15 @@ private:
      *  object.  */
     bool m_is_confirmed;
 
+protected:
+    // ------------------------------------------------------------------------
+    /** Sets the time and confirmed flag when a RewindInfo is reused. */
+    void reuse(int ticks, bool is_confirmed)
+    {
+        m_ticks        = ticks;
+        m_is_confirmed = is_confirmed;
+    }   // reuse
+
 public:
     RewindInfo(int ticks, bool is_confirmed);
 
@@ -96,6 +105,9 @@ private:
 
     int m_start_offset;
 
+    /** True if the data of each rewinder is preceded by its id. */
+    bool m_rewinder_ids;
+
     /** Pointer to the buffer which stores all states. */
     BareNetworkString *m_buffer;
 
@@ -103,7 +115,7 @@ public:
     // ------------------------------------------------------------------------
     RewindInfoState(int ticks, int start_offset,
                     std::vector<std::string>& rewinder_using,
-                    std::vector<uint8_t>& buffer);
+                    std::vector<uint8_t>& buffer, bool rewinder_ids);
     // ------------------------------------------------------------------------
     RewindInfoState(int ticks, BareNetworkString *buffer, bool is_confirmed);
     // ------------------------------------------------------------------------
@@ -138,16 +150,16 @@ private:
     /** Pointer to the event rewinder responsible for this event. */
     EventRewinder *m_event_rewinder;
 
-    /** Buffer with the event data. */
-    BareNetworkString *m_buffer;
+    /** Buffer with a copy of the event data. It keeps its memory when this
+     *  object is reused by the RewindQueue for another event. */
+    BareNetworkString m_buffer;
 public:
              RewindInfoEvent(int ticks, EventRewinder *event_rewinder,
-                             BareNetworkString *buffer, bool is_confirmed);
-    virtual ~RewindInfoEvent()
-    {
-        delete m_buffer;
-    }   // ~RewindInfoEvent
-
+                             const BareNetworkString *buffer,
+                             bool is_confirmed);
+    // ------------------------------------------------------------------------
+    void set(int ticks, EventRewinder *event_rewinder,
+             const BareNetworkString *buffer, bool is_confirmed);
     // ------------------------------------------------------------------------
     /** An event is never 'restored', it is only rewound. */
     void restore() {}
@@ -158,8 +170,8 @@ public:
      *  It calls undoEvent in the rewinder. */
     virtual void undo()
     {
-        m_buffer->reset();
-        m_event_rewinder->undo(m_buffer);
+        m_buffer.reset();
+        m_event_rewinder->undo(&m_buffer);
     }   // undo
     // ------------------------------------------------------------------------
     /** This is called while going forwards in time again to reach current
@@ -168,12 +180,12 @@ public:
     virtual void replay()
     {
         // Make sure to reset the buffer so we read from the beginning
-        m_buffer->reset();
-        m_event_rewinder->rewind(m_buffer);
+        m_buffer.reset();
+        m_event_rewinder->rewind(&m_buffer);
     }   // rewind
     // ------------------------------------------------------------------------
     /** Returns the buffer with the event information in it. */
-    BareNetworkString *getBuffer() { return m_buffer; }
+    BareNetworkString *getBuffer() { return &m_buffer; }
 };   // class RewindIndoEvent
 
 
@@ -18,7 +18,9 @@
 
 #include "network/rewind_manager.hpp"
 
+#include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
+#include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "network/network_config.hpp"
 #include "network/network_string.hpp"
@@ -31,14 +33,27 @@
 #include "tracks/check_manager.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_object_manager.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 #include "utils/profiler.hpp"
+#include "utils/string_utils.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <fstream>
 
 RewindManager* RewindManager::m_rewind_manager = NULL;
 bool           RewindManager::m_enable_rewind_manager = false;
 
+// ----------------------------------------------------------------------------
+/** Returns a monotonic time in ms with sub-millisecond precision. */
+static double getTimeMs()
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}   // getTimeMs
+
+// ----------------------------------------------------------------------------
 /** Creates the singleton. */
 RewindManager *RewindManager::create()
 {
@@ -61,6 +76,7 @@ void RewindManager::destroy()
  */
 RewindManager::RewindManager()
 {
+    m_num_rewinds = 0;
     reset();
 }   // RewindManager
 
@@ -70,6 +86,7 @@ RewindManager::RewindManager()
  */
 RewindManager::~RewindManager()
 {
+    writeRewindStats();
     for (RewindInfoEventFunction* rief : m_pending_rief)
         delete rief;
     m_pending_rief.clear();
@@ -80,12 +97,24 @@ RewindManager::~RewindManager()
  */
 void RewindManager::reset()
 {
+    writeRewindStats();
+    m_num_rewinds = 0;
+    m_num_coalesced_rewinds = 0;
+    m_total_replayed_ticks = 0;
+    m_total_rewind_time = 0.0;
+    m_max_rewind_time = 0.0;
+    m_pending_rewind_ticks = -1;
+    m_pending_rewinds = 0;
+    m_pending_since_ticks = 0;
+    m_last_rewind_time = 0.0;
+    m_last_rewind_end = 0.0;
     m_is_rewinding = false;
     m_not_rewound_ticks.store(0);
     m_overall_state_size = 0;
     m_state_frequency = stk_config->getPhysicsFPS() /
         NetworkConfig::get()->getStateFrequency();
 
+    m_predicted_state.clear();
     if (!m_enable_rewind_manager) return;
 
     clearExpiredRewinder();
@@ -93,19 +122,17 @@ void RewindManager::reset()
 }   // reset
 
 // ----------------------------------------------------------------------------    
-/** Adds an event to the rewind data. The data to be stored must be allocated
- *  and not freed by the caller!
+/** Adds an event to the rewind data. The event data is copied.
  *  \param time Time at which the event was recorded. If time is not specified
  *          (or set to -1), the current world time is used.
  *  \param buffer Pointer to the event data.
  */
 void RewindManager::addEvent(EventRewinder *event_rewinder,
-                             BareNetworkString *buffer, bool confirmed,
+                             const BareNetworkString *buffer, bool confirmed,
                              int ticks)
 {
     if (m_is_rewinding)
     {
-        delete buffer;
         Log::error("RewindManager", "Adding event when rewinding");
         return;
     }
@@ -118,13 +145,13 @@ void RewindManager::addEvent(EventRewinder *event_rewinder,
 // ----------------------------------------------------------------------------
 /** Adds an event to the list of network rewind data. This function is
  *  threadsafe so can be called by the network thread. The data is synched
- *  to m_rewind_info by the main thread. The data to be stored must be
- *  allocated and not freed by the caller!
+ *  to m_rewind_info by the main thread. The event data is copied.
  *  \param time Time at which the event was recorded.
  *  \param buffer Pointer to the event data.
  */
 void RewindManager::addNetworkEvent(EventRewinder *event_rewinder,
-                                     BareNetworkString *buffer, int ticks)
+                                     const BareNetworkString *buffer,
+                                     int ticks)
 {
     m_rewind_queue.addNetworkEvent(event_rewinder, buffer, ticks);
 }   // addNetworkEvent
@@ -160,22 +187,80 @@ void RewindManager::saveState()
 
     for (auto& p : m_all_rewinder)
     {
-        // TODO: check if it's worth passing in a sufficiently large buffer from
-        // GameProtocol - this would save the copy operation.
-        BareNetworkString* buffer = NULL;
+        // The rewinders save their state directly into the message
         if (auto r = p.second.lock())
-            buffer = r->saveState(&rewinder_using);
-        if (buffer != NULL)
-        {
-            m_overall_state_size += buffer->size();
-            gp->addState(buffer);
-        }
-        delete buffer;    // buffer can be freed
+            m_overall_state_size += gp->addState(r.get(), &rewinder_using);
     }
     gp->finalizeState(rewinder_using);
     PROFILER_POP_CPU_MARKER();
 }   // saveState
 
+// ----------------------------------------------------------------------------
+/** Saves the full state of all karts on a client, if the server may skip
+ *  far away karts in its states. Only the latest states are kept.
+ *  \param ticks Time of the state.
+ */
+void RewindManager::savePredictedState(int ticks)
+{
+    const std::set<std::string>& caps =
+        NetworkConfig::get()->getServerCapabilities();
+    if (caps.find("state_interest") == caps.end())
+        return;
+
+    // Reuse the buffers of the oldest state
+    std::map<std::string, std::shared_ptr<BareNetworkString> > old_states;
+    if (m_predicted_state.size() >= GameProtocol::MAX_DELTA_BASE_STATES)
+    {
+        std::swap(old_states, m_predicted_state.begin()->second);
+        m_predicted_state.erase(m_predicted_state.begin());
+    }
+
+    std::vector<std::string> rewinder_using;
+    auto& states = m_predicted_state[ticks];
+    states.clear();
+    for (auto& p : m_all_rewinder)
+    {
+        if (p.first.empty() || p.first[0] != RN_KART)
+            continue;
+        auto r = p.second.lock();
+        if (!r)
+            continue;
+        std::shared_ptr<BareNetworkString> buffer;
+        auto old = old_states.find(p.first);
+        if (old != old_states.end())
+        {
+            buffer = std::move(old->second);
+            buffer->getBuffer().clear();
+            buffer->reset();
+        }
+        else
+            buffer.reset(new BareNetworkString());
+        if (r->saveState(buffer.get(), &rewinder_using))
+            states[p.first] = std::move(buffer);
+    }
+}   // savePredictedState
+
+// ----------------------------------------------------------------------------
+/** Restores the state of a rewinder which was saved locally on a client
+ *  at the given time.
+ *  \param ticks Time of the state.
+ *  \param r The rewinder to restore.
+ *  \return False if no state was saved for this rewinder at that time.
+ */
+bool RewindManager::restorePredictedState(int ticks,
+                                          std::shared_ptr<Rewinder> r)
+{
+    auto it = m_predicted_state.find(ticks);
+    if (it == m_predicted_state.end())
+        return false;
+    auto state = it->second.find(r->getUniqueIdentity());
+    if (state == it->second.end())
+        return false;
+    state->second->reset();
+    r->restoreState(state->second.get(), state->second->size());
+    return true;
+}   // restorePredictedState
+
 // ----------------------------------------------------------------------------
 /** Determines if a new state snapshot should be taken, and if so calls all
  *  rewinder to do so.
@@ -205,6 +290,7 @@ void RewindManager::update(int ticks_not_used)
             if (auto r = p.second.lock())
                 ret.push_back(r->getLocalStateRestoreFunction());
         }
+        savePredictedState(ticks);
     }
     else
     {
@@ -237,11 +323,34 @@ void RewindManager::playEventsTill(int world_ticks, bool fast_forward)
     // be getTime()+dt - world time has not been updated yet).
     m_rewind_queue.mergeNetworkData(world_ticks, &needs_rewind, &rewind_ticks);
 
+    // All rewinds are combined with a rewind postponed earlier (if any)
     if (needs_rewind)
     {
+        if (m_pending_rewind_ticks == -1)
+        {
+            m_pending_rewind_ticks = rewind_ticks;
+            m_pending_since_ticks = world_ticks;
+        }
+        else
+        {
+            m_pending_rewind_ticks = std::min(m_pending_rewind_ticks,
+                                              rewind_ticks);
+        }
+        m_pending_rewinds++;
+    }
+
+    if (m_pending_rewind_ticks != -1 &&
+        (fast_forward || !postponeRewind(world_ticks)))
+    {
+        // Infos before the latest confirmed state were deleted in the
+        // meantime, so rewind to it if it's later
+        rewind_ticks = std::max(m_pending_rewind_ticks,
+                                m_rewind_queue.getLatestConfirmedState());
         Log::setPrefix("Rewind");
         PROFILER_PUSH_CPU_MARKER("Rewind", 128, 128, 128);
         rewindTo(rewind_ticks, world_ticks, fast_forward);
+        m_pending_rewind_ticks = -1;
+        m_pending_rewinds = 0;
         // This should replay everything up to 'now'
         assert(World::getWorld()->getTicksSinceStart() == world_ticks);
         PROFILER_POP_CPU_MARKER();
@@ -261,6 +370,24 @@ void RewindManager::playEventsTill(int world_ticks, bool fast_forward)
     m_is_rewinding = false;
 }   // playEventsTill
 
+// ----------------------------------------------------------------------------
+/** Checks if a rewind should be postponed because the last rewind took
+ *  longer than the rewind budget. In this case further rewinds are combined
+ *  until the same wall time has passed since the end of the last rewind, so
+ *  that at most half of the time is spent rewinding. A rewind is never
+ *  postponed for longer than the time between two states.
+ *  \param world_ticks Current world time.
+ */
+bool RewindManager::postponeRewind(int world_ticks)
+{
+    const int budget = UserConfigParams::m_rewind_budget;
+    if (budget <= 0 || m_last_rewind_time <= (double)budget)
+        return false;
+    if (world_ticks - m_pending_since_ticks >= m_state_frequency)
+        return false;
+    return getTimeMs() - m_last_rewind_end < m_last_rewind_time;
+}   // postponeRewind
+
 // ----------------------------------------------------------------------------
 /** Adds a Rewinder to the list of all rewinders.
  *  \return true If successfully added, false otherwise.
@@ -290,6 +417,7 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
                              bool fast_forward)
 {
     assert(!m_is_rewinding);
+    const double start_time = getTimeMs();
     bool is_history = history->replayHistory();
     history->setReplayHistory(false);
 
@@ -308,6 +436,7 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
 
     // This will go back till the first confirmed state is found before
     // the specified rewind ticks.
+    PROFILER_PUSH_CPU_MARKER("Rewind - undo", 0x80, 0x80, 0xA0);
     int exact_rewind_ticks = m_rewind_queue.undoUntil(rewind_ticks);
 
     // Rewind the required state(s)
@@ -368,8 +497,10 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
         Track::getCurrentTrack()->getTrackObjectManager()->resetAfterRewind();
         world->setTicksForRewind(exact_rewind_ticks);
     }
+    PROFILER_POP_CPU_MARKER();
 
     // Now go forward through the list of rewind infos till we reach 'now':
+    PROFILER_PUSH_CPU_MARKER("Rewind - replay", 0x80, 0x80, 0xC0);
     while (world->getTicksSinceStart() < now_ticks)
     { 
         m_rewind_queue.replayAllEvents(world->getTicksSinceStart());
@@ -384,12 +515,39 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
         world->updateTime(1);
 
     }   // while (world->getTicks() < current_ticks)
+    PROFILER_POP_CPU_MARKER();
 
     // Now compute the errors which need to be visually smoothed
+    RewindStats stats;
+    stats.m_max_error = 0.0f;
     for (auto& p : m_all_rewinder)
     {
         if (auto r = p.second.lock())
+        {
             r->computeError();
+            if (r->getRewindError() > stats.m_max_error)
+            {
+                stats.m_max_error = r->getRewindError();
+                stats.m_max_error_rewinder = p.first;
+            }
+        }
+    }
+
+    m_last_rewind_end = getTimeMs();
+    m_last_rewind_time = m_last_rewind_end - start_time;
+    m_num_rewinds++;
+    m_num_coalesced_rewinds += std::max(m_pending_rewinds - 1, 0);
+    m_total_replayed_ticks += now_ticks - exact_rewind_ticks;
+    m_total_rewind_time += m_last_rewind_time;
+    m_max_rewind_time = std::max(m_max_rewind_time, m_last_rewind_time);
+    if (UserConfigParams::m_rewind_stats)
+    {
+        stats.m_world_ticks = now_ticks;
+        stats.m_state_ticks = exact_rewind_ticks;
+        stats.m_replayed_ticks = now_ticks - exact_rewind_ticks;
+        stats.m_coalesced = std::max(m_pending_rewinds, 1);
+        stats.m_time = (float)m_last_rewind_time;
+        m_rewind_stats.push_back(stats);
     }
 
     history->setReplayHistory(is_history);
@@ -397,6 +555,53 @@ void RewindManager::rewindTo(int rewind_ticks, int now_ticks,
     mergeRewindInfoEventFunction();
 }   // rewindTo
 
+// ----------------------------------------------------------------------------
+/** Logs a summary of all rewinds since the last reset, and appends the
+ *  statistics of each rewind to the rewind stats file if enabled. The file
+ *  has one line per rewind with: world ticks, ticks of the restored state,
+ *  replayed ticks, number of combined rewinds, time in ms, largest error and
+ *  the rewinder causing it (the bytes of its unique identity).
+ */
+void RewindManager::writeRewindStats()
+{
+    if (m_num_rewinds == 0)
+        return;
+    Log::info("RewindManager", "%u rewinds (%u combined), %lld ticks "
+        "replayed, %.2f ms average, %.2f ms max.", m_num_rewinds,
+        m_num_coalesced_rewinds, (long long)m_total_replayed_ticks,
+        m_total_rewind_time / m_num_rewinds, m_max_rewind_time);
+    if (m_rewind_stats.empty() || !file_manager)
+        return;
+
+    const std::string name = file_manager->getUserConfigFile(
+        file_manager->getStdoutName()) + ".rewind-stats";
+    std::ofstream f(FileUtils::getPortableWritingPath(name),
+                    std::ios::out | std::ios::app);
+    if (!f.is_open())
+    {
+        Log::warn("RewindManager", "Can't write rewind stats to %s.",
+            name.c_str());
+        m_rewind_stats.clear();
+        return;
+    }
+    f << "# world_ticks state_ticks replayed_ticks coalesced time_ms "
+         "max_error max_error_rewinder\n";
+    for (const RewindStats& rs : m_rewind_stats)
+    {
+        std::string uid;
+        for (char c : rs.m_max_error_rewinder)
+            uid += StringUtils::toString((int)(uint8_t)c) + ".";
+        if (!uid.empty())
+            uid.pop_back();
+        else
+            uid = "-";
+        f << rs.m_world_ticks << " " << rs.m_state_ticks << " "
+          << rs.m_replayed_ticks << " " << rs.m_coalesced << " "
+          << rs.m_time << " " << rs.m_max_error << " " << uid << "\n";
+    }
+    m_rewind_stats.clear();
+}   // writeRewindStats
+
 // ----------------------------------------------------------------------------
 bool RewindManager::useLocalEvent() const
 {
@@ -32,6 +32,7 @@
 #include <string>
 #include <vector>
 
+class BareNetworkString;
 class Rewinder;
 class RewindInfo;
 class RewindInfoEventFunction;
@@ -84,6 +85,26 @@ class EventRewinder;
 
 class RewindManager
 {
+public:
+    /** Statistics of one rewind, used to tune the network settings. */
+    struct RewindStats
+    {
+        /** World time at which the rewind happened. */
+        int m_world_ticks;
+        /** Time of the confirmed state the world was rewound to. */
+        int m_state_ticks;
+        /** Number of ticks which were simulated again. */
+        int m_replayed_ticks;
+        /** Number of rewinds which were combined into this one. */
+        int m_coalesced;
+        /** Wall time the rewind took in ms. */
+        float m_time;
+        /** The largest error of all rewinders caused by the rewind. */
+        float m_max_error;
+        /** Unique identity of the rewinder with the largest error. */
+        std::string m_max_error_rewinder;
+    };
+
 private:
     /** Singleton pointer. */
     static RewindManager *m_rewind_manager;
@@ -94,6 +115,11 @@ private:
 
     std::map<int, std::vector<std::function<void()> > > m_local_state;
 
+    /** On the client: full states of karts as predicted locally, used if the
+     *  server skipped the kart in a state because it is far away. */
+    std::map<int, std::map<std::string, std::shared_ptr<BareNetworkString> > >
+        m_predicted_state;
+
     /** A list of all objects that can be rewound. */
     std::map<std::string, std::weak_ptr<Rewinder> > m_all_rewinder;
 
@@ -116,6 +142,28 @@ private:
 
     std::vector<RewindInfoEventFunction*> m_pending_rief;
 
+    /** Statistics of all rewinds not yet written to the stats file. */
+    std::vector<RewindStats> m_rewind_stats;
+
+    /** Overall statistics of all rewinds since the last reset. */
+    unsigned m_num_rewinds, m_num_coalesced_rewinds;
+    int64_t m_total_replayed_ticks;
+    double m_total_rewind_time, m_max_rewind_time;
+
+    /** The earliest time of rewinds postponed because the rewind budget
+     *  was exceeded, -1 if there is none. */
+    int m_pending_rewind_ticks;
+
+    /** Number of rewinds combined into the pending rewind. */
+    int m_pending_rewinds;
+
+    /** World time at which the first rewind was postponed. */
+    int m_pending_since_ticks;
+
+    /** Duration and end (both in ms) of the last rewind, used to check the
+     *  rewind budget. */
+    double m_last_rewind_time, m_last_rewind_end;
+
     RewindManager();
    ~RewindManager();
     // ------------------------------------------------------------------------
@@ -133,6 +181,12 @@ private:
     }
     // ------------------------------------------------------------------------
     void mergeRewindInfoEventFunction();
+    // ------------------------------------------------------------------------
+    void savePredictedState(int ticks);
+    // ------------------------------------------------------------------------
+    bool postponeRewind(int world_ticks);
+    // ------------------------------------------------------------------------
+    void writeRewindStats();
 
 public:
     // First static functions to manage rewinding.
@@ -160,12 +214,14 @@ public:
     void update(int ticks);
     void rewindTo(int target_ticks, int ticks_now, bool fast_forward);
     void playEventsTill(int world_ticks, bool fast_forward);
-    void addEvent(EventRewinder *event_rewinder, BareNetworkString *buffer,
-                  bool confirmed, int ticks = -1);
+    void addEvent(EventRewinder *event_rewinder,
+                  const BareNetworkString *buffer, bool confirmed,
+                  int ticks = -1);
     void addNetworkEvent(EventRewinder *event_rewinder,
-                         BareNetworkString *buffer, int ticks);
+                         const BareNetworkString *buffer, int ticks);
     void addNetworkState(BareNetworkString *buffer, int ticks);
     void saveState();
+    bool restorePredictedState(int ticks, std::shared_ptr<Rewinder> r);
     // ------------------------------------------------------------------------
     std::shared_ptr<Rewinder> getRewinder(const std::string& name)
     {
@@ -189,6 +245,13 @@ public:
         return m_not_rewound_ticks.load(std::memory_order_relaxed);
     }   // getNotRewoundWorldTicks
     // ------------------------------------------------------------------------
+    /** Returns the statistics of the rewinds not yet written to file. */
+    const std::vector<RewindStats>& getRewindStats() const
+                                                     { return m_rewind_stats; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of rewinds since the start of the race. */
+    unsigned getNumRewinds() const                    { return m_num_rewinds; }
+    // ------------------------------------------------------------------------
     /** Returns the time of the latest confirmed state. */
     int getLatestConfirmedState() const
     {
@@ -42,9 +42,15 @@
  *  the state is restored from the TimeStepInfo object (see replayAllStates)
  *  then the rewind manager re-executes the time steps (using the events
  *  stored at each timestep).
+ *  All RewindInfos are stored in a ring buffer sorted by time, and the
+ *  objects of events are reused, so in the usual case of adding new
+ *  information at the end and removing old information at the front no
+ *  memory is allocated.
  */
 RewindQueue::RewindQueue()
 {
+    m_first = 0;
+    m_size = 0;
     reset();
 }   // RewindQueue
 
@@ -56,6 +62,11 @@ RewindQueue::~RewindQueue()
 {
     // This frees all current data
     reset();
+    m_free_events.lock();
+    for (RewindInfoEvent* rie : m_free_events.getData())
+        delete rie;
+    m_free_events.getData().clear();
+    m_free_events.unlock();
 }   // ~RewindQueue
 
 // ----------------------------------------------------------------------------
@@ -69,63 +80,124 @@ void RewindQueue::reset()
     for (AllNetworkRewindInfo::const_iterator i  = info.begin(); 
                                               i != info.end(); ++i)
     {
-        delete *i;
+        freeRewindInfo(*i);
     }
     m_network_events.getData().clear();
     m_network_events.unlock();
 
-    AllRewindInfo::const_iterator i;
-    for (i = m_all_rewind_info.begin(); i != m_all_rewind_info.end(); ++i)
-        delete *i;
+    for (unsigned int i = 0; i < m_size; i++)
+        freeRewindInfo(at(i));
 
-    m_all_rewind_info.clear();
-    m_current = m_all_rewind_info.end();
+    m_first = 0;
+    m_size = 0;
+    m_current = 0;
     m_latest_confirmed_state_time = -1;
 }   // reset
 
+// ----------------------------------------------------------------------------
+/** Returns an event info with the given data, reusing a previously freed
+ *  object if possible. This function is thread-safe.
+ */
+RewindInfoEvent* RewindQueue::createEvent(int ticks,
+                                          EventRewinder *event_rewinder,
+                                          const BareNetworkString *buffer,
+                                          bool confirmed)
+{
+    RewindInfoEvent* rie = NULL;
+    m_free_events.lock();
+    if (!m_free_events.getData().empty())
+    {
+        rie = m_free_events.getData().back();
+        m_free_events.getData().pop_back();
+    }
+    m_free_events.unlock();
+
+    if (rie)
+        rie->set(ticks, event_rewinder, buffer, confirmed);
+    else
+        rie = new RewindInfoEvent(ticks, event_rewinder, buffer, confirmed);
+    return rie;
+}   // createEvent
+
+// ----------------------------------------------------------------------------
+/** Frees a rewind info which is not needed anymore. Events are kept to be
+ *  reused by createEvent().
+ */
+void RewindQueue::freeRewindInfo(RewindInfo *ri)
+{
+    // Enough for a few seconds of events of all karts
+    const unsigned int MAX_FREE_EVENTS = 1024;
+    RewindInfoEvent* rie = dynamic_cast<RewindInfoEvent*>(ri);
+    if (rie)
+    {
+        m_free_events.lock();
+        if (m_free_events.getData().size() < MAX_FREE_EVENTS)
+        {
+            m_free_events.getData().push_back(rie);
+            rie = NULL;
+        }
+        m_free_events.unlock();
+        delete rie;
+        return;
+    }
+    delete ri;
+}   // freeRewindInfo
+
 // ----------------------------------------------------------------------------
 /** Inserts a RewindInfo object in the list of all events at the correct time.
  *  If there are several RewindInfo at the exact same time, state RewindInfo
  *  will be insert at the front, and event info at the end of the RewindInfo
  *  with the same time.
  *  \param ri The RewindInfo object to insert.
- *  \param update_current If set, the current pointer will be updated if
- *         necessary to point to the new event
  */
 void RewindQueue::insertRewindInfo(RewindInfo *ri)
 {
-    AllRewindInfo::iterator i = m_all_rewind_info.end();
+    if (m_size == m_all_rewind_info.size())
+    {
+        // Double the size, and move all infos to the start of the buffer
+        std::vector<RewindInfo*> all_rewind_info(
+            std::max<size_t>(64, m_all_rewind_info.size() * 2), NULL);
+        for (unsigned int i = 0; i < m_size; i++)
+            all_rewind_info[i] = at(i);
+        std::swap(m_all_rewind_info, all_rewind_info);
+        m_first = 0;
+    }
 
-    while (i != m_all_rewind_info.begin())
+    // Binary search for the first info which must be after ri
+    unsigned int start = 0, end = m_size;
+    while (start < end)
     {
-        AllRewindInfo::iterator i_prev = i;
-        i_prev--;
-        // Now test if 'ri' needs to be inserted after the
-        // previous element, i.e. before the current element:
-        if ((*i_prev)->getTicks() < ri->getTicks()) break;
-        if ((*i_prev)->getTicks() == ri->getTicks() &&
-            ri->isEvent()                              ) break;
-        i = i_prev;
+        const unsigned int middle = (start + end) / 2;
+        const int ticks = at(middle)->getTicks();
+        if (ticks < ri->getTicks() ||
+            (ticks == ri->getTicks() && ri->isEvent()))
+            start = middle + 1;
+        else
+            end = middle;
     }
-    if(m_current == m_all_rewind_info.end())
-        m_current = m_all_rewind_info.insert(i, ri);
-    else
-        m_all_rewind_info.insert(i, ri);  
+
+    // Usually ri is added at the end, so this rarely moves anything
+    m_size++;
+    for (unsigned int i = m_size - 1; i > start; i--)
+        at(i) = at(i - 1);
+    at(start) = ri;
+
+    if (m_current == m_size - 1)
+        m_current = start;
+    else if (start <= m_current)
+        m_current++;
 }   // insertRewindInfo
 
 // ----------------------------------------------------------------------------
-/** Adds an event to the rewind data. The data to be stored must be allocated
- *  and not freed by the caller!
+/** Adds an event to the rewind data. The event data is copied.
  *  \param buffer Pointer to the event data. 
  *  \param ticks Time at which the event happened.
  */
 void RewindQueue::addLocalEvent(EventRewinder *event_rewinder,
-                                BareNetworkString *buffer, bool confirmed,
-                                int ticks                                  )
+                                const BareNetworkString *buffer,
+                                bool confirmed, int ticks)
 {
-    RewindInfo *ri = new RewindInfoEvent(ticks, event_rewinder,
-                                         buffer, confirmed);
-    insertRewindInfo(ri);
+    insertRewindInfo(createEvent(ticks, event_rewinder, buffer, confirmed));
 }   // addLocalEvent
 
 // ----------------------------------------------------------------------------
@@ -151,23 +223,37 @@ void RewindQueue::addLocalState(BareNetworkString *buffer,
     }
 }   // addLocalState
 
+// ----------------------------------------------------------------------------
+/** Adds a RewindInfo to the list of network rewind data, sorted by time.
+ *  This function is threadsafe so can be called by the network thread.
+ *  Infos with the same time are kept in the order they were received.
+ *  \param ri The RewindInfo, which will be freed by the RewindQueue.
+ */
+void RewindQueue::addNetworkRewindInfo(RewindInfo* ri)
+{
+    m_network_events.lock();
+    AllNetworkRewindInfo& info = m_network_events.getData();
+    // Network infos are usually received in order
+    AllNetworkRewindInfo::iterator i = info.end();
+    while (i != info.begin() && (*(i - 1))->getTicks() > ri->getTicks())
+        i--;
+    info.insert(i, ri);
+    m_network_events.unlock();
+}   // addNetworkRewindInfo
+
 // ----------------------------------------------------------------------------
 /** Adds an event to the list of network rewind data. This function is
  *  threadsafe so can be called by the network thread. The data is synched
- *  to m_tRewindInformation list by the main thread. The data to be stored
- *  must be allocated and not freed by the caller!
+ *  to m_tRewindInformation list by the main thread. The event data is
+ *  copied.
  *  \param buffer Pointer to the event data.
  *  \param ticks Time at which the event happened.
  */
 void RewindQueue::addNetworkEvent(EventRewinder *event_rewinder,
-                                  BareNetworkString *buffer, int ticks)
+                                  const BareNetworkString *buffer, int ticks)
 {
-    RewindInfo *ri = new RewindInfoEvent(ticks, event_rewinder,
-                                         buffer, /*confirmed*/true);
-
-    m_network_events.lock();
-    m_network_events.getData().push_back(ri);
-    m_network_events.unlock();
+    addNetworkRewindInfo(createEvent(ticks, event_rewinder, buffer,
+                                     /*confirmed*/true));
 }   // addNetworkEvent
 
 // ----------------------------------------------------------------------------
@@ -180,11 +266,8 @@ void RewindQueue::addNetworkEvent(EventRewinder *event_rewinder,
  */
 void RewindQueue::addNetworkState(BareNetworkString *buffer, int ticks)
 {
-    RewindInfo *ri = new RewindInfoState(ticks, buffer, /*confirmed*/true);
-
-    m_network_events.lock();
-    m_network_events.getData().push_back(ri);
-    m_network_events.unlock();
+    addNetworkRewindInfo(new RewindInfoState(ticks, buffer,
+                                             /*confirmed*/true));
 }   // addNetworkState
 
 // ----------------------------------------------------------------------------
@@ -214,19 +297,16 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
     // received state before current world time (if any)
     *rewind_ticks = -9999;
 
-    // FIXME: making m_network_events sorted would prevent the need to 
-    // go through the whole list of events
+    // The network events are sorted, so all events up to the first one in
+    // the future are merged.
     int latest_confirmed_state = -1;
     AllNetworkRewindInfo::iterator i = m_network_events.getData().begin();
-    while (i != m_network_events.getData().end())
+    for (; i != m_network_events.getData().end(); i++)
     {
         // Ignore any events that will happen in the future. The current
         // time step is world_ticks.
         if ((*i)->getTicks() > world_ticks)
-        {
-            i++;
-            continue;
-        }
+            break;
         // Any state of event that is received before the latest confirmed
         // state can be deleted.
         if ((*i)->getTicks() < m_latest_confirmed_state_time)
@@ -236,8 +316,7 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
                       (*i)->isEvent() ? "event" : "state",
                       (*i)->getTicks(),
                       m_latest_confirmed_state_time);
-            delete *i;
-            i = m_network_events.getData().erase(i);
+            freeRewindInfo(*i);
             continue;
         }
 
@@ -288,9 +367,8 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
         {
             latest_confirmed_state = (*i)->getTicks();
         }
-
-        i = m_network_events.getData().erase(i);
     }   // for i in m_network_events
+    m_network_events.getData().erase(m_network_events.getData().begin(), i);
 
     m_network_events.unlock();
 
@@ -327,25 +405,20 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
  */
 void RewindQueue::cleanupOldRewindInfo(int ticks)
 {
-    auto i = m_all_rewind_info.begin();
-
-    while (!m_all_rewind_info.empty() &&
-        (*i)->getTicks() < ticks)
+    while (m_size > 0 && at(0)->getTicks() < ticks)
     {
-        if (m_current == i) next();
-        delete *i;
-        i = m_all_rewind_info.erase(i);
+        if (m_current == 0) next();
+        freeRewindInfo(at(0));
+        m_first = (m_first + 1) & (m_all_rewind_info.size() - 1);
+        m_size--;
+        m_current--;
     }
-
-    if (m_all_rewind_info.empty())
-        m_current = m_all_rewind_info.end();
-
 }   // cleanupOldRewindInfo
 
 // ----------------------------------------------------------------------------
 bool RewindQueue::isEmpty() const
 {
-    return m_current == m_all_rewind_info.end();
+    return m_current == m_size;
 }   // isEmpty
 
 // ----------------------------------------------------------------------------
@@ -353,7 +426,7 @@ bool RewindQueue::isEmpty() const
  */
 bool RewindQueue::hasMoreRewindInfo() const
 {
-    return m_current != m_all_rewind_info.end();
+    return m_current < m_size;
 }   // hasMoreRewindInfo
 
 // ----------------------------------------------------------------------------
@@ -367,27 +440,26 @@ int RewindQueue::undoUntil(int undo_ticks)
 {
     // A rewind is done after a state in the past is inserted. This function
     // makes sure that m_current is not end()
-    //assert(m_current != m_all_rewind_info.end());
-    assert(!m_all_rewind_info.empty());
-    m_current = m_all_rewind_info.end();
-    m_current--;
-    while((*m_current)->getTicks() > undo_ticks ||
-        (*m_current)->isEvent() || !(*m_current)->isConfirmed())
+    assert(m_size > 0);
+    m_current = m_size - 1;
+    while(at(m_current)->getTicks() > undo_ticks ||
+        at(m_current)->isEvent() || !at(m_current)->isConfirmed())
     {
         // Undo all events and states from the current time
-        (*m_current)->undo();
-        if(m_current == m_all_rewind_info.begin())
+        at(m_current)->undo();
+        if(m_current == 0)
         {
             // This shouldn't happen, but add some debug info just in case
             Log::error("undoUntil",
                        "At %d rewinding to %d current = %d = begin",
                        World::getWorld()->getTicksSinceStart(), undo_ticks, 
-                       (*m_current)->getTicks());
+                       at(m_current)->getTicks());
+            break;
         }
         m_current--;
     }
 
-    return (*m_current)->getTicks();
+    return at(m_current)->getTicks();
 }   // undoUntil
 
 // ----------------------------------------------------------------------------
@@ -397,10 +469,10 @@ int RewindQueue::undoUntil(int undo_ticks)
 void RewindQueue::replayAllEvents(int ticks)
 {
     // Replay all events that happened at the current time step
-    while ( hasMoreRewindInfo() && (*m_current)->getTicks() == ticks )
+    while ( hasMoreRewindInfo() && at(m_current)->getTicks() == ticks )
     {
-        if ((*m_current)->isEvent())
-            (*m_current)->replay();
+        if (at(m_current)->isEvent())
+            at(m_current)->replay();
         m_current++;
     }   // while current->getTIcks == ticks
 
@@ -413,6 +485,7 @@ void RewindQueue::replayAllEvents(int ticks)
  *  - Sorting order of RewindInfos with different timestamps (and a mixture
  *    of types).
  *  - Special cases that triggered incorrect behaviour previously.
+ *  - Growing and wrapping around of the ring buffer.
  */
 void RewindQueue::unitTesting()
 {
@@ -427,57 +500,47 @@ void RewindQueue::unitTesting()
     assert(!q0.hasMoreRewindInfo());
 
     q0.addLocalState(NULL, /*confirmed*/true, 0);
-    assert(q0.m_all_rewind_info.front()->isState());
-    assert(!q0.m_all_rewind_info.front()->isEvent());
+    assert(q0.at(0)->isState());
+    assert(!q0.at(0)->isEvent());
     assert(q0.hasMoreRewindInfo());
     assert(q0.undoUntil(0) == 0);
 
     q0.addNetworkEvent(dummy_rewinder.get(), NULL, 0);
     // Network events are not immediately merged
-    assert(q0.m_all_rewind_info.size() == 1);
+    assert(q0.m_size == 1);
 
     bool needs_rewind;
     int rewind_ticks;
     int world_ticks = 0;
     q0.mergeNetworkData(world_ticks, &needs_rewind, &rewind_ticks);
     assert(q0.hasMoreRewindInfo());
-    assert(q0.m_all_rewind_info.size() == 2);
-    AllRewindInfo::iterator rii = q0.m_all_rewind_info.begin();
-    assert((*rii)->isState());
-    rii++;
-    assert((*rii)->isEvent());
+    assert(q0.m_size == 2);
+    assert(q0.at(0)->isState());
+    assert(q0.at(1)->isEvent());
 
     // Another state must be sorted before the event:
     q0.addNetworkState(NULL, 0);
     assert(q0.hasMoreRewindInfo());
     q0.mergeNetworkData(world_ticks, &needs_rewind, &rewind_ticks);
-    assert(q0.m_all_rewind_info.size() == 3);
-    rii = q0.m_all_rewind_info.begin();
-    assert((*rii)->isState());
-    rii++;
-    assert((*rii)->isState());
-    rii++;
-    assert((*rii)->isEvent());
+    assert(q0.m_size == 3);
+    assert(q0.at(0)->isState());
+    assert(q0.at(1)->isState());
+    assert(q0.at(2)->isEvent());
 
     // Test time base comparisons: adding an event to the end
     q0.addLocalEvent(dummy_rewinder.get(), NULL, true, 4);
     // Then adding an earlier event
     q0.addLocalEvent(dummy_rewinder.get(), NULL, false, 1);
-    // rii points to the 3rd element, the ones added just now
-    // should be elements4 and 5:
-    rii++;
-    assert((*rii)->getTicks()==1);
-    rii++;
-    assert((*rii)->getTicks()==4);
+    // The ones added just now should be elements 4 and 5:
+    assert(q0.at(3)->getTicks()==1);
+    assert(q0.at(4)->getTicks()==4);
 
     // Now test inserting an event first, then the state
     RewindQueue q1;
     q1.addLocalEvent(NULL, NULL, true, 5);
     q1.addLocalState(NULL, true, 5);
-    rii = q1.m_all_rewind_info.begin();
-    assert((*rii)->isState());
-    rii++;
-    assert((*rii)->isEvent());
+    assert(q1.at(0)->isState());
+    assert(q1.at(1)->isEvent());
 
     // Bugs seen before
     // ----------------
@@ -496,7 +559,7 @@ void RewindQueue::unitTesting()
     //    event, that m_current pooints to the first event, otherwise
     //    events with same time stamp will not be handled correctly.
     //    At this stage current points to the event at time 2 from above
-    AllRewindInfo::iterator current_old = b1.m_current;
+    unsigned int current_old = b1.m_current;
     b1.addLocalEvent(NULL, NULL, true, 2);
     // Make sure that current was not modified, i.e. the new event at time
     // 2 was added at the end of the list:
@@ -509,7 +572,7 @@ void RewindQueue::unitTesting()
     assert(ri->getTicks() == 2);
     assert(ri->isEvent());
     b1.next();
-    assert(b1.m_current == b1.m_all_rewind_info.end());
+    assert(b1.m_current == b1.m_size);
 
     // 3) Test that if cleanupOldRewindInfo is called, it will if necessary
     //    adjust m_current to point to the latest confirmed state.
@@ -518,7 +581,48 @@ void RewindQueue::unitTesting()
     b2.addNetworkState(NULL, 2);
     b2.addNetworkState(NULL, 3);
     b2.mergeNetworkData(4, &needs_rewind, &rewind_ticks);
-    assert((*b2.m_current)->getTicks() == 3);
-
-
+    assert(b2.at(b2.m_current)->getTicks() == 3);
+
+    // Network infos received out of order are merged sorted, and infos
+    // in the future stay in the network list
+    RewindQueue n1;
+    n1.addNetworkEvent(NULL, NULL, 3);
+    n1.addNetworkEvent(NULL, NULL, 1);
+    n1.addNetworkEvent(NULL, NULL, 9);
+    n1.addNetworkEvent(NULL, NULL, 2);
+    n1.mergeNetworkData(5, &needs_rewind, &rewind_ticks);
+    assert(n1.m_size == 3);
+    assert(n1.m_network_events.getData().size() == 1);
+    for (unsigned int i = 0; i < n1.m_size; i++)
+        assert(n1.at(i)->getTicks() == (int)i + 1);
+
+    // Ring buffer: keep adding at the end and removing at the front, so
+    // the buffer wraps around, then grow it while it is wrapped around
+    RewindQueue r1;
+    BareNetworkString event_data;
+    event_data.addUInt32(1234);
+    RewindInfo* first_event = NULL;
+    for (int ticks = 0; ticks < 200; ticks++)
+    {
+        // The confirmed state removes all older infos
+        r1.addLocalState(NULL, /*confirmed*/true, ticks);
+        r1.addLocalEvent(NULL, &event_data, true, ticks);
+        assert(r1.m_size == 2);
+        // The event object removed with the older infos is reused
+        if (ticks == 0)
+            first_event = r1.at(1);
+        else if (r1.at(1) != first_event)
+            Log::fatal("RewindQueue", "Event object was not reused.");
+    }
+    for (int ticks = 200; ticks < 300; ticks++)
+        r1.addLocalEvent(NULL, &event_data, true, ticks);
+    assert(r1.m_size == 102);
+    assert(r1.at(0)->isState() && r1.at(0)->getTicks() == 199);
+    for (unsigned int i = 1; i < r1.m_size; i++)
+    {
+        assert(r1.at(i)->isEvent());
+        assert(r1.at(i)->getTicks() == 198 + (int)i);
+        assert(dynamic_cast<RewindInfoEvent*>(r1.at(i))->getBuffer()
+               ->getUInt32() == 1234);
+    }
 }   // unitTesting
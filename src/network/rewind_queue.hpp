@@ -22,12 +22,12 @@
 #include "utils/synchronised.hpp"
 
 #include <assert.h>
-#include <list>
 #include <vector>
 
 class BareNetworkString;
 class EventRewinder;
 class RewindInfo;
+class RewindInfoEvent;
 class TimeStepInfo;
 
 /** \ingroup network
@@ -37,26 +37,59 @@ class RewindQueue
 {
 private:
 
-    typedef std::list<RewindInfo*> AllRewindInfo;
+    /** All rewind infos sorted by time. They are stored in a ring buffer,
+     *  so adding new infos at the end and removing old infos at the front
+     *  does not need to allocate or move any memory. The size is always a
+     *  power of 2, indices are relative to m_first (see at()). */
+    std::vector<RewindInfo*> m_all_rewind_info;
 
-    AllRewindInfo m_all_rewind_info;
+    /** Index of the oldest rewind info in m_all_rewind_info. */
+    unsigned int m_first;
 
-    /** The list of all events received from the network. They are stored
-     *  in a separate thread (so this data structure is thread-save), and
-     *  merged into m_rewind_info from the main thread. This design (as
-     *  opposed to locking m_rewind_info) reduces the synchronisation
-     *  between main thread and network thread. */
+    /** Number of rewind infos stored. */
+    unsigned int m_size;
+
+    /** The list of all events received from the network, sorted by time.
+     *  They are stored in a separate thread (so this data structure is
+     *  thread-save), and merged into m_rewind_info from the main thread.
+     *  This design (as opposed to locking m_rewind_info) reduces the
+     *  synchronisation between main thread and network thread. */
     typedef std::vector<RewindInfo*> AllNetworkRewindInfo;
     Synchronised<AllNetworkRewindInfo> m_network_events;
 
-    /** Iterator to the curren time step info to be handled. */
-    AllRewindInfo::iterator m_current;
+    /** Event infos which are not used anymore. They are reused for new
+     *  events, which avoids allocating memory for each event. */
+    Synchronised<std::vector<RewindInfoEvent*> > m_free_events;
+
+    /** Index of the current time step info to be handled, m_size if
+     *  there is no current info. */
+    unsigned int m_current;
 
     /** Time at which the latest confirmed state is at. */
     int m_latest_confirmed_state_time;
 
 
     void cleanupOldRewindInfo(int ticks);
+    RewindInfoEvent* createEvent(int ticks, EventRewinder *event_rewinder,
+                                 const BareNetworkString *buffer,
+                                 bool confirmed);
+    void freeRewindInfo(RewindInfo *ri);
+    // ------------------------------------------------------------------------
+    /** Returns the rewind info with the specified index, 0 being the oldest
+     *  one. */
+    RewindInfo*& at(unsigned int i)
+    {
+        assert(i < m_size);
+        return m_all_rewind_info[(m_first + i) &
+                                 (m_all_rewind_info.size() - 1)];
+    }   // at
+    // ------------------------------------------------------------------------
+    const RewindInfo* at(unsigned int i) const
+    {
+        assert(i < m_size);
+        return m_all_rewind_info[(m_first + i) &
+                                 (m_all_rewind_info.size() - 1)];
+    }   // at
 
 public:
         static void unitTesting();
@@ -64,18 +97,14 @@ public:
          RewindQueue();
         ~RewindQueue();
     void reset();
-    void addLocalEvent(EventRewinder *event_rewinder, BareNetworkString *buffer,
+    void addLocalEvent(EventRewinder *event_rewinder,
+                       const BareNetworkString *buffer,
                        bool confirmed, int ticks);
     void addLocalState(BareNetworkString *buffer, bool confirmed, int ticks);
     void addNetworkEvent(EventRewinder *event_rewinder,
-                         BareNetworkString *buffer, int ticks);
+                         const BareNetworkString *buffer, int ticks);
     void addNetworkState(BareNetworkString *buffer, int ticks);
-    void addNetworkRewindInfo(RewindInfo* ri)
-    {
-        m_network_events.lock();
-        m_network_events.getData().push_back(ri);
-        m_network_events.unlock();
-    }
+    void addNetworkRewindInfo(RewindInfo* ri);
     void mergeNetworkData(int world_ticks,  bool *needs_rewind, 
                           int *rewind_ticks);
     void replayAllEvents(int ticks);
@@ -95,7 +124,7 @@ public:
      *  RewindInfo element. */
     void next()
     {
-        assert(m_current != m_all_rewind_info.end());
+        assert(m_current < m_size);
         m_current++;
         return;
     }   // operator++
@@ -105,7 +134,7 @@ public:
      *  least one more RewindInfo (see hasMoreRewindInfo()). */
     RewindInfo* getCurrent()
     {
-        return (m_current != m_all_rewind_info.end() ) ? *m_current : NULL;
+        return m_current < m_size ? at(m_current) : NULL;
     }   // getNext
 
 };   // RewindQueue
@@ -70,12 +70,19 @@ public:
      *  caused by the rewind (which is then visually smoothed over time). */
     virtual void computeError() = 0;
 
-    /** Provides a copy of the state of the object in one memory buffer.
-     *  The memory is managed by the RewindManager.
+    /** Returns the error computed by the last computeError() call, i.e.
+     *  how far the object was moved by the rewind. Used for statistics. */
+    virtual float getRewindError() const { return 0.0f; }
+
+    /** Appends a copy of the state of the object to a buffer provided by
+     *  the caller, which can contain data of other rewinders before.
+     *  \param buffer The buffer to append the state to.
      *  \param[out] ru The unique identity of rewinder writing to.
-     *  \return The address of the memory buffer with the state.
+     *  \return False if no state is saved, nothing is added to the buffer
+     *          then.
      */
-    virtual BareNetworkString* saveState(std::vector<std::string>* ru) = 0;
+    virtual bool saveState(BareNetworkString* buffer,
+                           std::vector<std::string>* ru) = 0;
 
     /** Called when an event needs to be undone. This is called while going
      *  backwards for rewinding - all stored events will get an 'undo' call.
@@ -327,6 +327,21 @@ namespace ServerConfig
         "more rewind, which clients with slow device may have problem playing "
         "this server, use the default value is recommended."));
 
+    SERVER_CFG_PREFIX FloatServerConfigParam m_interest_distance
+        SERVER_CFG_DEFAULT(FloatServerConfigParam(75.0f,
+        "interest-distance",
+        "Distance (in meters along the track or arena graph) within which "
+        "other karts are sent to a player in every state, karts further away "
+        "are sent less often, the interval grows with the distance. Only "
+        "clients which support it are affected, 0 to disable."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_interest_max_interval
+        SERVER_CFG_DEFAULT(IntServerConfigParam(4,
+        "interest-max-interval",
+        "Maximum number of states between two updates of a far away kart "
+        "sent to a player when interest-distance is enabled. Every this "
+        "many states a player gets the state of all karts."));
+
     SERVER_CFG_PREFIX BoolServerConfigParam m_sql_management
         SERVER_CFG_DEFAULT(BoolServerConfigParam(false,
         "sql-management",
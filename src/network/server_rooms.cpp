@@ -0,0 +1,220 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/server_rooms.hpp"
+
+#include "config/stk_config.hpp"
+#include "config/user_config.hpp"
+#include "io/file_manager.hpp"
+#include "network/server_config.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <signal.h>
+#include <vector>
+
+#ifndef WIN32
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+#ifdef __linux__
+#  include <sys/prctl.h>
+#endif
+
+namespace ServerRooms
+{
+    /** Number of rooms to host, only one server is hosted if less than 2. */
+    int g_num_rooms = 0;
+
+    /** Index of the room hosted by this process, -1 if not a room. */
+    int g_current_room = -1;
+
+#ifndef WIN32
+    /** Set by the signal handler of the supervising process. */
+    volatile sig_atomic_t g_stop_rooms = 0;
+
+    /** Process ids of all rooms, -1 for rooms which are not running. */
+    std::vector<pid_t> g_room_pids;
+
+    /** Signal handlers which were installed before supervising the rooms,
+     *  they are restored in the rooms. */
+    void (*g_old_sigterm_handler)(int) = SIG_DFL;
+    void (*g_old_sigint_handler)(int) = SIG_DFL;
+
+    // ------------------------------------------------------------------------
+    /** Forks the process of a room.
+     *  \return True in the forked room process.
+     */
+    bool forkRoom(int room)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            g_current_room = room;
+            g_room_pids.clear();
+            signal(SIGTERM, g_old_sigterm_handler);
+            signal(SIGINT, g_old_sigint_handler);
+#ifdef __linux__
+            // Don't keep rooms running if the supervisor gets killed
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+            // Each room writes its own log file
+            FileManager::setStdoutName(StringUtils::removeExtension(
+                FileManager::getStdoutName()) + "-room" +
+                StringUtils::toString(room + 1) + ".log");
+            Log::closeOutputFiles();
+            file_manager->redirectOutput();
+            return true;
+        }
+        if (pid < 0)
+        {
+            Log::error("ServerRooms", "Failed to fork room %d.", room + 1);
+            g_room_pids[room] = -1;
+        }
+        else
+        {
+            Log::info("ServerRooms", "Started room %d with pid %d.",
+                room + 1, (int)pid);
+            g_room_pids[room] = pid;
+        }
+        return false;
+    }   // forkRoom
+#endif
+
+    // ------------------------------------------------------------------------
+    bool isEnabled()
+    {
+        return g_num_rooms > 1;
+    }   // isEnabled
+
+    // ------------------------------------------------------------------------
+    void setNumRooms(int num_rooms)
+    {
+        g_num_rooms = num_rooms;
+    }   // setNumRooms
+
+    // ------------------------------------------------------------------------
+    /** Returns the index of the room hosted by this process, or -1 if this
+     *  process does not host one of several rooms. */
+    int getCurrentRoom()
+    {
+        return g_current_room;
+    }   // getCurrentRoom
+
+    // ------------------------------------------------------------------------
+    /** Forks one process for each room, and supervises them till all rooms
+     *  have stopped. Rooms which crashed are forked again.
+     *  \return True in a process which should host a server (a room, or
+     *          the only server if rooms are not enabled), false in the
+     *          supervising process after all rooms have stopped.
+     */
+    bool startRooms()
+    {
+        if (!isEnabled())
+            return true;
+#ifdef WIN32
+        Log::error("ServerRooms", "Server rooms are not supported on this "
+            "platform, only one server will be hosted.");
+        g_num_rooms = 0;
+        return true;
+#else
+        g_room_pids.resize(g_num_rooms, -1);
+        g_old_sigterm_handler = signal(SIGTERM, [](int signum)
+            {
+                g_stop_rooms = 1;
+            });
+        g_old_sigint_handler = signal(SIGINT, [](int signum)
+            {
+                g_stop_rooms = 1;
+            });
+
+        for (int room = 0; room < g_num_rooms; room++)
+        {
+            if (forkRoom(room))
+                return true;
+        }
+
+        bool stopping = false;
+        while (std::any_of(g_room_pids.begin(), g_room_pids.end(),
+            [](pid_t pid) { return pid > 0; }))
+        {
+            if (g_stop_rooms != 0 && !stopping)
+            {
+                Log::info("ServerRooms", "Stopping all rooms.");
+                stopping = true;
+                for (pid_t pid : g_room_pids)
+                {
+                    if (pid > 0)
+                        kill(pid, SIGTERM);
+                }
+            }
+            int status = 0;
+            pid_t pid = waitpid(-1, &status, WNOHANG);
+            if (pid <= 0)
+            {
+                StkTime::sleep(100);
+                continue;
+            }
+            auto it = std::find(g_room_pids.begin(), g_room_pids.end(), pid);
+            if (it == g_room_pids.end())
+                continue;
+            const int room = int(it - g_room_pids.begin());
+            *it = -1;
+            if (!stopping && WIFSIGNALED(status))
+            {
+                Log::warn("ServerRooms", "Room %d was stopped by signal %d, "
+                    "restarting it.", room + 1, WTERMSIG(status));
+                if (forkRoom(room))
+                    return true;
+            }
+            else
+                Log::info("ServerRooms", "Room %d has stopped.", room + 1);
+        }
+        return false;
+#endif
+    }   // startRooms
+
+    // ------------------------------------------------------------------------
+    /** Changes the server config of a room, so that each room uses its own
+     *  port, name and database tables. Must be called before the server is
+     *  created. */
+    void setupRoom()
+    {
+        if (g_current_room < 0)
+            return;
+
+        if (ServerConfig::m_server_port != 0 ||
+            !UserConfigParams::m_random_server_port)
+        {
+            int port = ServerConfig::m_server_port;
+            if (port == 0)
+                port = stk_config->m_server_port;
+            ServerConfig::m_server_port = port + g_current_room;
+        }
+        const std::string room = StringUtils::toString(g_current_room + 1);
+        ServerConfig::m_server_name =
+            std::string(ServerConfig::m_server_name) + " " + room;
+        ServerConfig::m_server_uid += "_room" + room;
+        Log::info("ServerRooms", "Hosting room %s on port %d.", room.c_str(),
+            (int)ServerConfig::m_server_port);
+    }   // setupRoom
+
+}   // namespace ServerRooms
@@ -0,0 +1,41 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SERVER_ROOMS_HPP
+#define HEADER_SERVER_ROOMS_HPP
+
+/** \ingroup network
+ *  Hosts several independent server rooms from one set of loaded assets.
+ *  After karts, tracks, materials and configs are loaded, the process forks
+ *  one child process per room. The children share all memory pages of the
+ *  loaded assets with the supervising parent (copy on write), while each
+ *  room gets its own STKHost, protocols, world and other singletons. The
+ *  parent restarts rooms which crashed and forwards termination signals.
+ *  Forking requires that no thread besides the main thread runs, so
+ *  threads (e.g. the request manager) must only be started in the rooms.
+ */
+namespace ServerRooms
+{
+    bool isEnabled();
+    void setNumRooms(int num_rooms);
+    bool startRooms();
+    int  getCurrentRoom();
+    void setupRoom();
+};   // namespace ServerRooms
+
+#endif // HEADER_SERVER_ROOMS_HPP
@@ -64,6 +64,7 @@ void SmoothNetworkBody::checkSmoothing(const btTransform& current_transform,
 
     float adjust_length = (current_transform.getOrigin() -
         m_prev_position_data.first.getOrigin()).length();
+    m_last_adjust_length = adjust_length;
     if (adjust_length < m_min_adjust_length ||
         adjust_length > m_max_adjust_length)
         return;
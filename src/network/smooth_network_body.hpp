@@ -59,6 +59,9 @@ private:
 
     float m_adjust_time, m_adjust_time_dt;
 
+    /** Distance between the positions before and after the last rewind. */
+    float m_last_adjust_length;
+
     SmoothingState m_smoothing;
 
     bool m_enabled;
@@ -84,8 +87,12 @@ public:
         m_prev_position_data = std::make_pair(m_smoothed_transform, Vec3());
         m_smoothing = SS_NONE;
         m_adjust_time = m_adjust_time_dt = 0.0f;
+        m_last_adjust_length = 0.0f;
     }
     // ------------------------------------------------------------------------
+    /** Returns how far the body was moved by the last rewind. */
+    float getLastAdjustLength() const           { return m_last_adjust_length; }
+    // ------------------------------------------------------------------------
     void setEnable(bool val)                               { m_enabled = val; }
     // ------------------------------------------------------------------------
     bool isEnabled() const                                { return m_enabled; }
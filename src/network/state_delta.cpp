@@ -0,0 +1,194 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/state_delta.hpp"
+
+#include "network/network_string.hpp"
+
+#include <assert.h>
+#include <stdexcept>
+
+namespace StateDelta
+{
+    /** Unchanged runs shorter than this are stored as changed bytes, since
+     *  starting a new run would cost at least the same amount of bytes. */
+    const unsigned MIN_UNCHANGED_RUN = 3;
+    // ------------------------------------------------------------------------
+    /** Adds an unsigned integer using 7 bits per byte, the highest bit is
+     *  set if more bytes follow. */
+    void addVarUInt(BareNetworkString* out, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            out->addUInt8((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        out->addUInt8((uint8_t)value);
+    }   // addVarUInt
+    // ------------------------------------------------------------------------
+    uint32_t getVarUInt(const BareNetworkString& in)
+    {
+        uint32_t value = 0;
+        for (unsigned shift = 0; shift < 35; shift += 7)
+        {
+            uint8_t byte = in.getUInt8();
+            value |= (uint32_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        throw std::out_of_range("getVarUInt too many bytes.");
+    }   // getVarUInt
+    // ------------------------------------------------------------------------
+    /** Returns the XOR of the state byte with the corresponding base byte,
+     *  the base is treated as zero padded if it is shorter than the state. */
+    inline uint8_t diffAt(const std::vector<uint8_t>& base,
+                          const uint8_t* state, unsigned i)
+    {
+        return i < base.size() ? state[i] ^ base[i] : state[i];
+    }   // diffAt
+
+    // ------------------------------------------------------------------------
+    /** Appends the difference between state and base to out.
+     *  \param base The state previously acknowledged by the receiver.
+     *  \param state Pointer to the new state.
+     *  \param state_size Size of the new state in bytes.
+     *  \param out The network string to which the delta is appended.
+     */
+    void encode(const std::vector<uint8_t>& base, const uint8_t* state,
+                unsigned state_size, BareNetworkString* out)
+    {
+        addVarUInt(out, state_size);
+        unsigned i = 0;
+        while (i < state_size)
+        {
+            unsigned unchanged_start = i;
+            while (i < state_size && diffAt(base, state, i) == 0)
+                i++;
+            // Remaining bytes are identical to the base, nothing to store
+            if (i == state_size)
+                break;
+
+            unsigned changed_start = i;
+            unsigned changed_end = i;
+            while (i < state_size)
+            {
+                if (diffAt(base, state, i) != 0)
+                {
+                    changed_end = ++i;
+                    continue;
+                }
+                // Only end the changed run if enough unchanged bytes follow
+                unsigned j = i;
+                while (j < state_size && j - i < MIN_UNCHANGED_RUN &&
+                       diffAt(base, state, j) == 0)
+                    j++;
+                if (j == state_size || j - i >= MIN_UNCHANGED_RUN)
+                    break;
+                i = j;
+            }
+            i = changed_end;
+            addVarUInt(out, changed_start - unchanged_start);
+            addVarUInt(out, changed_end - changed_start);
+            for (unsigned k = changed_start; k < changed_end; k++)
+                out->addUInt8(diffAt(base, state, k));
+        }
+    }   // encode
+
+    // ------------------------------------------------------------------------
+    /** Reconstructs a state from a base state and the remaining content of
+     *  a delta created by encode.
+     *  \param base The state that was used as base when encoding.
+     *  \param delta Network string to read the delta from, it is read till
+     *         the end.
+     *  \param state On return contains the reconstructed state.
+     *  \return False if the delta is corrupted.
+     */
+    bool decode(const std::vector<uint8_t>& base,
+                const BareNetworkString& delta, std::vector<uint8_t>* state)
+    {
+        try
+        {
+            const uint32_t state_size = getVarUInt(delta);
+            state->assign(base.begin(), base.size() > state_size ?
+                base.begin() + state_size : base.end());
+            state->resize(state_size, 0);
+            uint32_t pos = 0;
+            while (delta.size() > 0)
+            {
+                pos += getVarUInt(delta);
+                const uint32_t changed = getVarUInt(delta);
+                if (pos > state_size || changed > state_size - pos ||
+                    changed > delta.size())
+                    return false;
+                for (uint32_t i = 0; i < changed; i++)
+                    (*state)[pos++] ^= delta.getUInt8();
+            }
+        }
+        catch (std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }   // decode
+
+    // ------------------------------------------------------------------------
+    /** Checks that decoding an encoded state restores the state, for longer
+     *  and shorter states than the base, too. */
+    void unitTesting()
+    {
+        std::vector<uint8_t> base;
+        for (unsigned i = 0; i < 200; i++)
+            base.push_back((uint8_t)(i * 7));
+
+        std::vector<std::vector<uint8_t> > states;
+        states.push_back(base);
+        std::vector<uint8_t> s = base;
+        s[0] = 1; s[5] = 2; s[7] = 3; s[100] = 4; s[199] = 5;
+        states.push_back(s);
+        s.resize(300, 9);
+        states.push_back(s);
+        s.resize(20);
+        states.push_back(s);
+        states.push_back(std::vector<uint8_t>());
+
+        for (const std::vector<uint8_t>& state : states)
+        {
+            BareNetworkString delta;
+            encode(base, state.data(), (unsigned)state.size(), &delta);
+            std::vector<uint8_t> result;
+            bool success = decode(base, delta, &result);
+            (void)success;
+            assert(success);
+            assert(result == state);
+        }
+
+        // An unchanged state only needs the size
+        BareNetworkString same;
+        encode(base, base.data(), (unsigned)base.size(), &same);
+        assert(same.size() == 2);
+
+        // Corrupted delta should be detected
+        BareNetworkString corrupted;
+        corrupted.addUInt8(10).addUInt8(8).addUInt8(5);
+        std::vector<uint8_t> result;
+        bool success = decode(base, corrupted, &result);
+        (void)success;
+        assert(!success);
+    }   // unitTesting
+
+}   // namespace StateDelta
@@ -0,0 +1,44 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_STATE_DELTA_HPP
+#define HEADER_STATE_DELTA_HPP
+
+#include "utils/types.hpp"
+
+#include <vector>
+
+class BareNetworkString;
+
+/** \ingroup network
+ *  Encodes a game state as a difference to a previous state which the
+ *  receiver has already acknowledged. The new state is XOR'ed with the base
+ *  state (which is padded with zeros if shorter), and the result is stored
+ *  as a list of (unchanged byte count, changed byte count, changed bytes)
+ *  runs. Trailing unchanged bytes are not stored at all.
+ */
+namespace StateDelta
+{
+    void encode(const std::vector<uint8_t>& base, const uint8_t* state,
+                unsigned state_size, BareNetworkString* out);
+    bool decode(const std::vector<uint8_t>& base,
+                const BareNetworkString& delta, std::vector<uint8_t>* state);
+    void unitTesting();
+}   // namespace StateDelta
+
+#endif // HEADER_STATE_DELTA_HPP
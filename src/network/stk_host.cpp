@@ -41,6 +41,7 @@
 #include "utils/string_utils.hpp"
 #include "utils/time.hpp"
 #include "utils/vs.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <string.h>
 #if defined(WIN32)
@@ -292,7 +293,14 @@ STKHost::STKHost(bool server)
     }
     setPrivatePort();
     if (server)
+    {
         Log::info("STKHost", "Server port is %d", m_private_port);
+        // The broadcasting thread takes part in the work too
+        const unsigned threads =
+            std::min(std::thread::hardware_concurrency(), 4u);
+        m_crypto_pool.reset(new WorkerPool(threads > 1 ? threads - 1 : 0,
+            "CryptoPool"));
+    }
 }   // STKHost
 
 // ----------------------------------------------------------------------------
@@ -1423,6 +1431,42 @@ bool STKHost::isConnectedTo(const TransportAddress& peer)
     return false;
 }   // isConnectedTo
 
+//-----------------------------------------------------------------------------
+/** Sends data to several peers. The packets for different peers are created
+ *  and encrypted in parallel, and then handed to the listening thread at
+ *  once. The caller must make sure the peers are not deleted meanwhile.
+ *  \param packets The peers with the data to send to each of them.
+ *  \param reliable If the data should be sent reliable or now.
+ */
+void STKHost::sendPackets(const std::vector<std::pair<STKPeer*,
+                          NetworkString*> >& packets, bool reliable)
+{
+    // Below that the thread synchronisation costs more than it saves
+    const unsigned MIN_PARALLEL_PACKETS = 4;
+    std::vector<ENetPacket*> enet_packets(packets.size(), NULL);
+    auto create_packet = [&packets, &enet_packets, reliable](unsigned i)
+        {
+            enet_packets[i] = packets[i].first->createPacket(
+                packets[i].second, reliable, true/*encrypted*/);
+        };
+    if (m_crypto_pool && packets.size() >= MIN_PARALLEL_PACKETS)
+        m_crypto_pool->run((unsigned)packets.size(), create_packet);
+    else
+    {
+        for (unsigned i = 0; i < packets.size(); i++)
+            create_packet(i);
+    }
+
+    std::lock_guard<std::mutex> lock(m_enet_cmd_mutex);
+    for (unsigned i = 0; i < packets.size(); i++)
+    {
+        if (!enet_packets[i])
+            continue;
+        m_enet_cmd.emplace_back(packets[i].first->getENetPeer(),
+            enet_packets[i], EVENT_CHANNEL_NORMAL, ECT_SEND_PACKET);
+    }
+}   // sendPackets
+
 //-----------------------------------------------------------------------------
 /** Sends data to all validated peers currently in server
  *  \param data Data to sent.
@@ -1431,11 +1475,13 @@ bool STKHost::isConnectedTo(const TransportAddress& peer)
 void STKHost::sendPacketToAllPeersInServer(NetworkString *data, bool reliable)
 {
     std::lock_guard<std::mutex> lock(m_peers_mutex);
+    std::vector<std::pair<STKPeer*, NetworkString*> > packets;
     for (auto p : m_peers)
     {
         if (p.second->isValidated())
-            p.second->sendPacket(data, reliable);
+            packets.emplace_back(p.second.get(), data);
     }
+    sendPackets(packets, reliable);
 }   // sendPacketToAllPeersInServer
 
 //-----------------------------------------------------------------------------
@@ -1446,11 +1492,13 @@ void STKHost::sendPacketToAllPeersInServer(NetworkString *data, bool reliable)
 void STKHost::sendPacketToAllPeers(NetworkString *data, bool reliable)
 {
     std::lock_guard<std::mutex> lock(m_peers_mutex);
+    std::vector<std::pair<STKPeer*, NetworkString*> > packets;
     for (auto p : m_peers)
     {
         if (p.second->isValidated() && !p.second->isWaitingForGame())
-            p.second->sendPacket(data, reliable);
+            packets.emplace_back(p.second.get(), data);
     }
+    sendPackets(packets, reliable);
 }   // sendPacketToAllPeers
 
 //-----------------------------------------------------------------------------
@@ -1463,15 +1511,17 @@ void STKHost::sendPacketExcept(STKPeer* peer, NetworkString *data,
                                bool reliable)
 {
     std::lock_guard<std::mutex> lock(m_peers_mutex);
+    std::vector<std::pair<STKPeer*, NetworkString*> > packets;
     for (auto p : m_peers)
     {
         STKPeer* stk_peer = p.second.get();
         if (!stk_peer->isSamePeer(peer) && p.second->isValidated() &&
             !p.second->isWaitingForGame())
         {
-            stk_peer->sendPacket(data, reliable);
+            packets.emplace_back(stk_peer, data);
         }
     }
+    sendPackets(packets, reliable);
 }   // sendPacketExcept
 
 //-----------------------------------------------------------------------------
@@ -1484,14 +1534,16 @@ void STKHost::sendPacketToAllPeersWith(std::function<bool(STKPeer*)> predicate,
                                        NetworkString* data, bool reliable)
 {
     std::lock_guard<std::mutex> lock(m_peers_mutex);
+    std::vector<std::pair<STKPeer*, NetworkString*> > packets;
     for (auto p : m_peers)
     {
         STKPeer* stk_peer = p.second.get();
         if (!stk_peer->isValidated())
             continue;
         if (predicate(stk_peer))
-            stk_peer->sendPacket(data, reliable);
+            packets.emplace_back(stk_peer, data);
     }
+    sendPackets(packets, reliable);
 }   // sendPacketToAllPeersWith
 
 //-----------------------------------------------------------------------------
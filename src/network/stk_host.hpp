@@ -54,6 +54,7 @@ class NetworkTimerSynchronizer;
 class Server;
 class ServerLobby;
 class SeparateProcess;
+class WorkerPool;
 
 enum ENetCommandType : unsigned int
 {
@@ -100,6 +101,10 @@ private:
     /** Protect \ref m_enet_cmd from multiple threads usage. */
     std::mutex m_enet_cmd_mutex;
 
+    /** Creates (and encrypts) the packets of one broadcast for different
+     *  peers in parallel, only used in servers. */
+    std::unique_ptr<WorkerPool> m_crypto_pool;
+
     /** The list of peers connected to this instance. */
     std::map<ENetPeer*, std::shared_ptr<STKPeer> > m_peers;
 
@@ -240,6 +245,9 @@ public:
     void sendPacketToAllPeersWith(std::function<bool(STKPeer*)> predicate,
                                   NetworkString* data, bool reliable = true);
     // ------------------------------------------------------------------------
+    void sendPackets(const std::vector<std::pair<STKPeer*, NetworkString*> >&
+                     packets, bool reliable = true);
+    // ------------------------------------------------------------------------
     /** Returns true if this client instance is allowed to control the server.
      *  It will auto transfer ownership if previous server owner disconnected.
      */
@@ -101,21 +101,24 @@ void STKPeer::reset()
 }   // reset
 
 //-----------------------------------------------------------------------------
-/** Sends a packet to this host.
+/** Creates the enet packet (encrypted if needed) for sending data to this
+ *  host. It can be called in parallel for different peers.
  *  \param data The data to send.
  *  \param reliable If the data is sent reliable or not.
  *  \param encrypted If the data is sent encrypted or not.
+ *  \return The packet, or NULL if it cannot be sent to this host.
  */
-void STKPeer::sendPacket(NetworkString *data, bool reliable, bool encrypted)
+ENetPacket* STKPeer::createPacket(NetworkString *data, bool reliable,
+                                  bool encrypted)
 {
     if (m_disconnected.load())
-        return;
+        return NULL;
     TransportAddress a(m_enet_peer->address);
     // Enet will reuse a disconnected peer so we check here to avoid sending
     // to wrong peer
     if (m_enet_peer->state != ENET_PEER_STATE_CONNECTED ||
         a != m_peer_address)
-        return;
+        return NULL;
 
     ENetPacket* packet = NULL;
     if (m_crypto && encrypted)
@@ -131,14 +134,26 @@ void STKPeer::sendPacket(NetworkString *data, bool reliable, bool encrypted)
             ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)));
     }
 
+    if (packet && Network::m_connection_debug)
+    {
+        Log::verbose("STKPeer", "sending packet of size %d to %s at %lf",
+            packet->dataLength, a.toString().c_str(),
+            StkTime::getRealTime());
+    }
+    return packet;
+}   // createPacket
+
+//-----------------------------------------------------------------------------
+/** Sends a packet to this host.
+ *  \param data The data to send.
+ *  \param reliable If the data is sent reliable or not.
+ *  \param encrypted If the data is sent encrypted or not.
+ */
+void STKPeer::sendPacket(NetworkString *data, bool reliable, bool encrypted)
+{
+    ENetPacket* packet = createPacket(data, reliable, encrypted);
     if (packet)
     {
-        if (Network::m_connection_debug)
-        {
-            Log::verbose("STKPeer", "sending packet of size %d to %s at %lf",
-                packet->dataLength, a.toString().c_str(),
-                StkTime::getRealTime());
-        }
         m_host->addEnetCommand(m_enet_peer, packet,
                 encrypted ? EVENT_CHANNEL_NORMAL : EVENT_CHANNEL_UNENCRYPTED,
                 ECT_SEND_PACKET);
@@ -111,6 +111,9 @@ public:
     // ------------------------------------------------------------------------
     ~STKPeer();
     // ------------------------------------------------------------------------
+    ENetPacket* createPacket(NetworkString *data, bool reliable,
+                             bool encrypted);
+    // ------------------------------------------------------------------------
     void sendPacket(NetworkString *data, bool reliable = true,
                     bool encrypted = true);
     // ------------------------------------------------------------------------
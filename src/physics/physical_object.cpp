@@ -812,14 +812,15 @@ void PhysicalObject::computeError()
 }   // computeError
 
 // ----------------------------------------------------------------------------
-BareNetworkString* PhysicalObject::saveState(std::vector<std::string>* ru)
+bool PhysicalObject::saveState(BareNetworkString* buffer,
+                               std::vector<std::string>* ru)
 {
     bool has_live_join = false;
 
     if (auto sl = LobbyProtocol::get<LobbyProtocol>())
         has_live_join = sl->hasLiveJoiningRecently();
 
-    BareNetworkString* buffer = new BareNetworkString();
+    const unsigned start = buffer->getTotalSize();
     // This will compress and round down values of body, use the rounded
     // down value to test if sending state is needed
     // If any client live-joined always send new state for this object
@@ -833,15 +834,15 @@ BareNetworkString* PhysicalObject::saveState(std::vector<std::string>* ru)
         (current_lv - m_last_lv).length() < 0.01f &&
         (current_av - m_last_av).length() < 0.01f && !has_live_join)
     {
-        delete buffer;
-        return nullptr;
+        buffer->getBuffer().resize(start);
+        return false;
     }
 
     ru->push_back(getUniqueIdentity());
     m_last_transform = cur_transform;
     m_last_lv = current_lv;
     m_last_av = current_av;
-    return buffer;
+    return true;
 }   // saveState
 
 // ----------------------------------------------------------------------------
@@ -22,11 +22,22 @@
 #include "main_loop.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
+#include "utils/file_utils.hpp"
+#include "utils/log.hpp"
 #include "utils/time.hpp"
 
 #include "btBulletDynamicsCommon.h"
 
-#include <fstream>
+#include <string.h>
+
+namespace
+{
+    /** Identifies a file with a cached bounding volume hierarchy. */
+    const uint32_t BVH_CACHE_MAGIC = 0x43485642;   // "BVHC"
+    /** Increase this whenever the cache content changes, so that old cache
+     *  files are ignored. */
+    const uint32_t BVH_CACHE_VERSION = 3;
+}   // namespace
 
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
@@ -44,6 +55,7 @@ TriangleMesh::TriangleMesh(bool can_be_transformed) : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_bvh_buffer       = NULL;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -89,10 +101,12 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
 // -----------------------------------------------------------------------------
 /** Creates a collision body only, which can be used for raycasting, but
  *  has no physical properties.
- *  @param serialized_bhv if non-null, load the serialized bhv from file instead
- *                        of builing it on the fly
+ *  @param bvh_cache_file if non-null, the bvh is loaded from this file if it
+ *                        was created for the same triangles. Otherwise the
+ *                        bvh is built on the fly and saved in this file.
  */
-void TriangleMesh::createCollisionShape(bool create_collision_object, const char* serialized_bhv)
+void TriangleMesh::createCollisionShape(bool create_collision_object,
+                                        const char* bvh_cache_file)
 {
     if(m_triangleIndex2Material.size()==0)
     {
@@ -105,53 +119,23 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
     // Now convert the triangle mesh into a static rigid body
     btBvhTriangleMeshShape* bhv_triangle_mesh;
 
-    if (serialized_bhv != NULL)
+    const uint64_t hash = bvh_cache_file ? getMeshHash() : 0;
+    btOptimizedBvh* bvh = bvh_cache_file ? loadBvh(bvh_cache_file, hash)
+                                         : NULL;
+    if (bvh != NULL)
     {
-        FILE *f = fopen(serialized_bhv, "rb");
-        fseek(f, 0, SEEK_END);
-        long pos = ftell(f);
-        assert(pos != -1L);
-        fseek(f, 0, SEEK_SET);
-
-        void* bytes = btAlignedAlloc(pos, 16);
-        fread(bytes, pos, 1, f);
-        fclose(f);
-
-        btOptimizedBvh* bhv = btOptimizedBvh::deSerializeInPlace(bytes, pos, !IS_LITTLE_ENDIAN);
-        if (bhv == NULL)
-        {
-            Log::warn("TriangleMesh", "Failed to load serialized BHV");
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-        }
-        else
-        {
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
-                                                           false /* buildBvh */);
-            bhv_triangle_mesh->setOptimizedBvh( bhv );
-        }
-        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the btOptimizedBvh object
-        // directly at this memory location
-        //free(bytes);
-
+        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
+                                                       false /* buildBvh */);
+        bhv_triangle_mesh->setOptimizedBvh(bvh);
     }
     else
     {
         bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
+        if (bvh_cache_file)
+        {
+            saveBvh(bvh_cache_file, hash,
+                    *bhv_triangle_mesh->getOptimizedBvh());
+        }
     }
 
     m_collision_shape = bhv_triangle_mesh;
@@ -178,16 +162,16 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
  *  for height of terrain detection).
  *  \param friction Friction to be used for this TriangleMesh.
  *  \param flags Additional collision flags (default 0).
- *  \param serializedBhv if non-NULL, the bhv is deserialized instead of
- *                       being calculated on the fly
+ *  \param bvh_cache_file if non-NULL, the cache file to load the bvh from
+ *                        or to save it in, see createCollisionShape.
  */
 void TriangleMesh::createPhysicalBody(float friction,
                                       btCollisionObject::CollisionFlags flags,
-                                      const char* serializedBhv)
+                                      const char* bvh_cache_file)
 {
     // We need the collision shape, but not the collision object (since
     // this will be created when the dynamics body is anyway).
-    createCollisionShape(/*create_collision_object*/false, serializedBhv);
+    createCollisionShape(/*create_collision_object*/false, bvh_cache_file);
     main_loop->renderGUI(5583);
 
     btTransform startTransform;
@@ -232,8 +216,97 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    // The shape does not own a bvh loaded from the cache
+    if (m_bvh_buffer)
+    {
+        btAlignedFree(m_bvh_buffer);
+        m_bvh_buffer = NULL;
+    }
 }   // removeAll
 
+// -----------------------------------------------------------------------------
+/** Returns a hash of all vertices and triangles of the mesh, which is used
+ *  to check if a cached bvh was created for this mesh. It includes the size
+ *  of btScalar and the number of triangles, which the serialized bvh
+ *  depends on.
+ */
+uint64_t TriangleMesh::getMeshHash() const
+{
+    const uint32_t sizes[2] = { (uint32_t)sizeof(btScalar),
+                                (uint32_t)m_triangleIndex2Material.size() };
+    uint64_t hash = FileUtils::checksum(sizes, sizeof(sizes));
+    const IndexedMeshArray &meshes = m_mesh.getIndexedMeshArray();
+    for (int i = 0; i < meshes.size(); i++)
+    {
+        const btIndexedMesh &m = meshes[i];
+        hash = FileUtils::checksum(m.m_vertexBase,
+            (size_t)m.m_numVertices * m.m_vertexStride, hash);
+        hash = FileUtils::checksum(m.m_triangleIndexBase,
+            (size_t)m.m_numTriangles * m.m_triangleIndexStride, hash);
+    }
+    return hash;
+}   // getMeshHash
+
+// -----------------------------------------------------------------------------
+/** Loads a serialized bvh from the cache. The bvh is used directly in the
+ *  buffer it is copied into, which is freed in removeAll.
+ *  \param file_name Name of the cache file.
+ *  \param hash Hash of this mesh.
+ *  \return The bvh, or NULL if there is no valid cache file for this mesh.
+ */
+btOptimizedBvh* TriangleMesh::loadBvh(const std::string &file_name,
+                                      uint64_t hash)
+{
+    std::string data;
+    if (!FileUtils::readCacheFile(file_name, BVH_CACHE_MAGIC,
+                                  BVH_CACHE_VERSION, hash, 0xffffffff,
+                                  &data) || data.empty())
+        return NULL;
+
+    // The bvh must be 16 byte aligned
+    char* buffer = (char*)btAlignedAlloc(data.size(), 16);
+    memcpy(buffer, data.data(), data.size());
+    btOptimizedBvh* bvh = btOptimizedBvh::deSerializeInPlace(buffer,
+        (unsigned)data.size(), !IS_LITTLE_ENDIAN);
+    if (bvh == NULL)
+    {
+        Log::warn("TriangleMesh", "Ignoring invalid bvh cache file '%s'.",
+                  file_name.c_str());
+        btAlignedFree(buffer);
+        return NULL;
+    }
+    // Do *NOT* free the buffer while the bvh is used, 'deSerializeInPlace'
+    // makes the btOptimizedBvh object directly at this memory location
+    assert(m_bvh_buffer == NULL);
+    m_bvh_buffer = buffer;
+    return bvh;
+}   // loadBvh
+
+// -----------------------------------------------------------------------------
+/** Saves the bvh in the cache.
+ *  \param file_name Name of the cache file.
+ *  \param hash Hash of this mesh.
+ *  \param bvh The bvh to save.
+ */
+void TriangleMesh::saveBvh(const std::string &file_name, uint64_t hash,
+                           const btOptimizedBvh &bvh) const
+{
+    const unsigned int bvh_size = bvh.calculateSerializeBufferSize();
+    char* buffer = (char*)btAlignedAlloc(bvh_size, 16);
+    // The cache is always stored in little endian
+    if (bvh.serializeInPlace(buffer, bvh_size, !IS_LITTLE_ENDIAN))
+    {
+        FileUtils::writeCacheFile(file_name, BVH_CACHE_MAGIC,
+                                  BVH_CACHE_VERSION, hash, buffer, bvh_size);
+    }
+    else
+    {
+        Log::warn("TriangleMesh", "Can't serialize bvh for '%s'.",
+                  file_name.c_str());
+    }
+    btAlignedFree(buffer);
+}   // saveBvh
+
 // -----------------------------------------------------------------------------
 /** Interpolates the normal at the given position for the triangle with
  *  a given index. The position must be inside of the given triangle.
@@ -19,6 +19,8 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <stdint.h>
+#include <string>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
@@ -57,6 +59,18 @@ private:
      *  to the current transform of the body. */
     bool m_can_be_transformed;
 
+    /** The buffer a bvh loaded from the cache is stored in, NULL if the
+     *  bvh was built. */
+    void                        *m_bvh_buffer;
+
+    // ------------------------------------------------------------------------
+    uint64_t getMeshHash() const;
+    // ------------------------------------------------------------------------
+    btOptimizedBvh* loadBvh(const std::string &file_name, uint64_t hash);
+    // ------------------------------------------------------------------------
+    void saveBvh(const std::string &file_name, uint64_t hash,
+                 const btOptimizedBvh &bvh) const;
+
 public:
     class RigidBodyTriangleMesh : public btRigidBody
     {
@@ -76,11 +90,12 @@ public:
                      const btVector3 &t3, const btVector3 &n1,
                      const btVector3 &n2, const btVector3 &n3,
                      const Material* m);
-    void createCollisionShape(bool create_collision_object=true, const char* serialized_bhv=NULL);
+    void createCollisionShape(bool create_collision_object=true,
+                              const char* bvh_cache_file=NULL);
     void createPhysicalBody(float friction,
                             btCollisionObject::CollisionFlags flags=
                                (btCollisionObject::CollisionFlags)0,
-                            const char* serializedBhv = NULL);
+                            const char* bvh_cache_file = NULL);
     void removeAll();
     void removeCollisionObject();
     btVector3 getInterpolatedNormal(unsigned int index,
@@ -18,7 +18,11 @@
 #include "replay/replay_base.hpp"
 
 #include "io/file_manager.hpp"
+#include "network/network_string.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/mini_glm.hpp"
+
+#include <string.h>
 
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
@@ -28,13 +32,15 @@ ReplayBase::ReplayBase()
 /** Opens a replay file which is determined by sub classes.
  *  \param writeable True if the file should be opened for writing.
  *  \param full_path True if the file is full path.
+ *  \param binary True if the file is a binary replay file.
  *  \return A FILE *, or NULL if the file could not be opened.
  */
-FILE* ReplayBase::openReplayFile(bool writeable, bool full_path, int replay_file_number)
+FILE* ReplayBase::openReplayFile(bool writeable, bool full_path,
+                                 int replay_file_number, bool binary)
 {
     FILE* fd = FileUtils::fopenU8Path(full_path ? getReplayFilename(replay_file_number) :
         file_manager->getReplayDir() + getReplayFilename(replay_file_number),
-        writeable ? "w" : "r");
+        binary ? (writeable ? "wb" : "rb") : (writeable ? "w" : "r"));
     if (!fd)
     {
         return NULL;
@@ -42,3 +48,88 @@ FILE* ReplayBase::openReplayFile(bool writeable, bool full_path, int replay_file
     return fd;
 
 }   // openReplayFile
+
+// -----------------------------------------------------------------------------
+/** Reads the start of a binary replay file. A binary replay file starts
+ *  with the magic bytes, the version and the size of the header, followed
+ *  by the header, the chunks with the frames of all karts, and the chunk
+ *  index. The last 4 bytes are the offset of the chunk index.
+ *  \param fd The file to read from, opened in binary mode.
+ *  \param version On return the version of the binary replay.
+ *  \param header On return the content of the header.
+ *  \return False if this is not a binary replay file.
+ */
+bool ReplayBase::readBinaryReplayHeader(FILE *fd, unsigned int *version,
+                                        BareNetworkString *header)
+{
+    char start[12];
+    if (fread(start, 1, 12, fd) != 12 ||
+        memcmp(start, getBinaryReplayMagic(), 4) != 0)
+        return false;
+    BareNetworkString sizes(start + 4, 8);
+    *version = sizes.getUInt32();
+    const uint32_t header_size = sizes.getUInt32();
+    // Avoid allocating huge amounts of memory for corrupted files
+    if (header_size > 1024 * 1024)
+        return false;
+    std::vector<char> data(header_size);
+    if (header_size > 0 && fread(data.data(), 1, header_size, fd) != header_size)
+        return false;
+    *header = BareNetworkString(data.data(), header_size);
+    return true;
+}   // readBinaryReplayHeader
+
+// -----------------------------------------------------------------------------
+/** Adds one frame of a kart to a binary replay. The rotation is compressed
+ *  to 4 bytes, and values with a small range are stored as half floats.
+ */
+void ReplayBase::encodeFrame(BareNetworkString *buffer,
+                             const TransformEvent &te, const PhysicInfo &pi,
+                             const BonusInfo &bi, const KartReplayEvent &kre)
+{
+    buffer->addFloat(te.m_time).add(Vec3(te.m_transform.getOrigin()))
+        .addUInt32(MiniGLM::compressQuaternion(te.m_transform.getRotation()))
+        .addUInt16(MiniGLM::toFloat16(pi.m_speed))
+        .addUInt16(MiniGLM::toFloat16(pi.m_steer));
+    for (int i = 0; i < 4; i++)
+        buffer->addUInt16(MiniGLM::toFloat16(pi.m_suspension_length[i]));
+    buffer->addUInt8((uint8_t)pi.m_skidding_state)
+        .addUInt8((uint8_t)bi.m_attachment)
+        .addUInt16(MiniGLM::toFloat16(bi.m_nitro_amount))
+        .addUInt8((uint8_t)bi.m_item_amount).addUInt8((uint8_t)bi.m_item_type)
+        .addUInt16((uint16_t)(int16_t)bi.m_special_value)
+        .addFloat(kre.m_distance).addUInt8((uint8_t)kre.m_nitro_usage)
+        .addUInt8((uint8_t)kre.m_skidding_effect)
+        .addUInt8((kre.m_zipper_usage ? 1 : 0) | (kre.m_red_skidding ? 2 : 0) |
+                  (kre.m_jumping ? 4 : 0));
+}   // encodeFrame
+
+// -----------------------------------------------------------------------------
+/** Reads one frame of a kart from a binary replay, see encodeFrame.
+ */
+void ReplayBase::decodeFrame(const BareNetworkString &buffer,
+                             TransformEvent *te, PhysicInfo *pi,
+                             BonusInfo *bi, KartReplayEvent *kre)
+{
+    te->m_time = buffer.getFloat();
+    te->m_transform.setOrigin(buffer.getVec3());
+    te->m_transform.setRotation(
+        MiniGLM::decompressbtQuaternion(buffer.getUInt32()));
+    pi->m_speed = MiniGLM::toFloat32(buffer.getUInt16());
+    pi->m_steer = MiniGLM::toFloat32(buffer.getUInt16());
+    for (int i = 0; i < 4; i++)
+        pi->m_suspension_length[i] = MiniGLM::toFloat32(buffer.getUInt16());
+    pi->m_skidding_state = buffer.getUInt8();
+    bi->m_attachment = buffer.getUInt8();
+    bi->m_nitro_amount = MiniGLM::toFloat32(buffer.getUInt16());
+    bi->m_item_amount = buffer.getUInt8();
+    bi->m_item_type = buffer.getUInt8();
+    bi->m_special_value = buffer.getInt16();
+    kre->m_distance = buffer.getFloat();
+    kre->m_nitro_usage = buffer.getUInt8();
+    kre->m_skidding_effect = buffer.getUInt8();
+    const uint8_t flags = buffer.getUInt8();
+    kre->m_zipper_usage = (flags & 1) != 0;
+    kre->m_red_skidding = (flags & 2) != 0;
+    kre->m_jumping = (flags & 4) != 0;
+}   // decodeFrame
@@ -26,6 +26,8 @@
 #include <string>
 #include <vector>
 
+class BareNetworkString;
+
 /**
   * \ingroup race
   */
@@ -98,7 +100,25 @@ protected:
     };   // KartReplayEvent
 
     // ------------------------------------------------------------------------
-    FILE *openReplayFile(bool writeable, bool full_path = false, int replay_file_number=1);
+    /** Number of frames of one kart stored in one chunk of a binary replay
+     *  file. The chunk index at the end of the file allows one to read the
+     *  chunks of a kart without reading the whole file. */
+    static const unsigned int BINARY_CHUNK_FRAMES = 256;
+
+    // ------------------------------------------------------------------------
+    FILE *openReplayFile(bool writeable, bool full_path = false,
+                         int replay_file_number=1, bool binary = false);
+    // ------------------------------------------------------------------------
+    static bool readBinaryReplayHeader(FILE *fd, unsigned int *version,
+                                       BareNetworkString *header);
+    // ------------------------------------------------------------------------
+    static void encodeFrame(BareNetworkString *buffer,
+                            const TransformEvent &te, const PhysicInfo &pi,
+                            const BonusInfo &bi, const KartReplayEvent &kre);
+    // ------------------------------------------------------------------------
+    static void decodeFrame(const BareNetworkString &buffer,
+                            TransformEvent *te, PhysicInfo *pi,
+                            BonusInfo *bi, KartReplayEvent *kre);
     // ------------------------------------------------------------------------
     /** Returns the filename that was opened. */
     virtual const std::string& getReplayFilename(int replay_file_number = 1) const = 0;
@@ -112,6 +132,17 @@ protected:
      *  be understood by this executable. */
     unsigned int getMinSupportedReplayVersion() const { return 3; }
 
+    // ------------------------------------------------------------------------
+    /** Returns the version number of binary replay files recorded by this
+     *  executable. Binary replays are written as a second format next to
+     *  the text format, so it is counted separately. */
+    static unsigned int getCurrentBinaryReplayVersion() { return 1; }
+
+    // ------------------------------------------------------------------------
+    /** The first bytes of a binary replay file, text replay files start with
+     *  "version:" instead. */
+    static const char* getBinaryReplayMagic() { return "STKR"; }
+
 public:
              ReplayBase();
     virtual ~ReplayBase() {};
@@ -23,6 +23,7 @@
 #include "karts/ghost_kart.hpp"
 #include "karts/controller/ghost_controller.hpp"
 #include "modes/world.hpp"
+#include "network/network_string.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
@@ -30,6 +31,7 @@
 #include "utils/string_utils.hpp"
 
 #include <irrlicht.h>
+#include <stdexcept>
 #include <stdio.h>
 #include <string>
 #include <cinttypes>
@@ -109,8 +111,9 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     char s[1024], s1[1024];
     if (StringUtils::getExtension(fn) != "replay") return false;
-    FILE* fd = FileUtils::fopenU8Path(custom_replay ? fn :
-        file_manager->getReplayDir() + fn, "r");
+    const std::string path = custom_replay ? fn :
+                             file_manager->getReplayDir() + fn;
+    FILE* fd = FileUtils::fopenU8Path(path, "rb");
     if (fd == NULL) return false;
     ReplayData rd;
 
@@ -118,8 +121,35 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
     rd.m_custom_replay_file = custom_replay;
     rd.m_filename = fn;
 
-    fgets(s, 1023, fd);
     unsigned int version;
+    BareNetworkString header;
+    if (readBinaryReplayHeader(fd, &version, &header))
+    {
+        fclose(fd);
+        if (version > getCurrentBinaryReplayVersion())
+        {
+            Log::warn("Replay", "Binary replay is version '%d'", version);
+            Log::warn("Replay", "STK binary replay version is '%d'",
+                      getCurrentBinaryReplayVersion());
+            Log::warn("Replay", "Skipped '%s'", fn.c_str());
+            return false;
+        }
+        rd.m_binary_replay = true;
+        rd.m_replay_version = version;
+        if (!readBinaryReplayInfo(header, fn, &rd) ||
+            !findReplayTrack(&rd, fn))
+            return false;
+        addReplayData(rd, custom_replay);
+        return true;
+    }
+
+    // Otherwise this is a text replay
+    fclose(fd);
+    fd = FileUtils::fopenU8Path(path, "r");
+    if (fd == NULL) return false;
+    rd.m_binary_replay = false;
+
+    fgets(s, 1023, fd);
     if (sscanf(s,"version: %u", &version) != 1)
     {
         Log::warn("Replay", "No Version information "
@@ -246,23 +276,12 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
     }
     rd.m_track_name = std::string(s1);
 
-    // If former official tracks are present as addons, show the matching replays.
-    if (rd.m_track_name.compare("greenvalley") == 0)
-        rd.m_track_name = std::string("addon_green-valley");
-    if (rd.m_track_name.compare("mansion") == 0)
-        rd.m_track_name = std::string("addon_blackhill-mansion");
-
-    Track* t = track_manager->getTrack(rd.m_track_name);
-    if (t == NULL)
+    if (!findReplayTrack(&rd, fn))
     {
-        Log::warn("Replay", "Track '%s' used in replay '%s' not found in STK!",
-        rd.m_track_name.c_str(), fn.c_str());
         fclose(fd);
         return false;
     }
 
-    rd.m_track = t;
-
     fgets(s, 1023, fd);
     if (sscanf(s, "laps: %u", &rd.m_laps) != 1)
     {
@@ -294,16 +313,94 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
         rd.m_replay_uid = call_index;
 
     fclose(fd);
+    addReplayData(rd, custom_replay);
+    return true;
+
+}   // addReplayFile
+
+//-----------------------------------------------------------------------------
+/** Reads the header of a binary replay, which contains the same information
+ *  as the start of a text replay.
+ *  \param header The header read by readBinaryReplayHeader.
+ *  \param fn Name of the replay file, used for messages.
+ *  \param rd The replay data to fill in.
+ *  \return False if the header is invalid.
+ */
+bool ReplayPlay::readBinaryReplayInfo(const BareNetworkString &header,
+                                      const std::string &fn, ReplayData *rd)
+{
+    try
+    {
+        std::string stk_version;
+        header.decodeString(&stk_version);
+        rd->m_stk_version = stk_version.c_str();
+        const unsigned int num_karts = header.getUInt8();
+        for (unsigned int i = 0; i < num_karts; i++)
+        {
+            std::string ident;
+            core::stringw name;
+            header.decodeString(&ident);
+            header.decodeStringW(&name);
+            rd->m_kart_list.push_back(ident);
+            rd->m_name_list.push_back(name);
+            rd->m_kart_color.push_back(header.getFloat());
+        }
+        // First user is the game master and the "owner" of this replay file
+        if (num_karts > 0)
+            rd->m_user_name = rd->m_name_list[0];
+        rd->m_reverse = header.getUInt8() != 0;
+        rd->m_difficulty = header.getUInt8();
+        header.decodeString(&rd->m_minor_mode);
+        header.decodeString(&rd->m_track_name);
+        rd->m_laps = header.getUInt32();
+        rd->m_min_time = header.getFloat();
+        rd->m_replay_uid = header.getUInt64();
+    }
+    catch (std::exception& e)
+    {
+        Log::warn("Replay", "Invalid binary replay file '%s': %s.",
+                  fn.c_str(), e.what());
+        return false;
+    }
+    return true;
+}   // readBinaryReplayInfo
+
+//-----------------------------------------------------------------------------
+/** Finds the track used in a replay.
+ *  \param rd The replay data, m_track is set on return.
+ *  \param fn Name of the replay file, used for messages.
+ *  \return False if the track is not available.
+ */
+bool ReplayPlay::findReplayTrack(ReplayData *rd, const std::string &fn)
+{
+    // If former official tracks are present as addons, show the matching replays.
+    if (rd->m_track_name.compare("greenvalley") == 0)
+        rd->m_track_name = std::string("addon_green-valley");
+    if (rd->m_track_name.compare("mansion") == 0)
+        rd->m_track_name = std::string("addon_blackhill-mansion");
+
+    Track* t = track_manager->getTrack(rd->m_track_name);
+    if (t == NULL)
+    {
+        Log::warn("Replay", "Track '%s' used in replay '%s' not found in STK!",
+        rd->m_track_name.c_str(), fn.c_str());
+        return false;
+    }
+
+    rd->m_track = t;
+    return true;
+}   // findReplayTrack
+
+//-----------------------------------------------------------------------------
+void ReplayPlay::addReplayData(const ReplayData &rd, bool custom_replay)
+{
     m_replay_file_list.push_back(rd);
 
     assert(m_replay_file_list.size() > 0);
     // Force to use custom replay file immediately
     if (custom_replay)
         m_current_replay_file = (unsigned int)m_replay_file_list.size() - 1;
-
-    return true;
-
-}   // addReplayFile
+}   // addReplayData
 
 //-----------------------------------------------------------------------------
 void ReplayPlay::load()
@@ -326,8 +423,9 @@ void ReplayPlay::loadFile(bool second_replay)
     int replay_index = second_replay ? m_second_replay_file : m_current_replay_file;
     int replay_file_number = second_replay ? 2 : 1;
 
-    FILE *fd = openReplayFile(/*writeable*/false,
-            m_replay_file_list.at(replay_index).m_custom_replay_file, replay_file_number);
+    ReplayData &rd = m_replay_file_list[replay_index];
+    FILE *fd = openReplayFile(/*writeable*/false, rd.m_custom_replay_file,
+                              replay_file_number, rd.m_binary_replay);
 
     if(!fd)
     {
@@ -340,7 +438,13 @@ void ReplayPlay::loadFile(bool second_replay)
     Log::info("Replay", "Reading replay file '%s'.",
                     getReplayFilename(replay_file_number).c_str());
 
-    ReplayData &rd = m_replay_file_list[replay_index];
+    if (rd.m_binary_replay)
+    {
+        loadBinaryFile(fd, second_replay);
+        fclose(fd);
+        return;
+    }
+
     unsigned int num_kart = (unsigned int)m_replay_file_list.at(replay_index)
                                                             .m_kart_list.size();
     unsigned int lines_to_skip = (rd.m_replay_version == 3) ? 7 : 10;
@@ -362,13 +466,91 @@ void ReplayPlay::loadFile(bool second_replay)
 }   // loadFile
 
 //-----------------------------------------------------------------------------
-/** Reads all data from a replay file for a specific kart.
- *  \param fd The file descriptor from which to read.
+/** Reads all karts from a binary replay file. The chunk index at the end of
+ *  the file is used to read the chunks of each kart in turn, and the start
+ *  time of each chunk is passed to the ghost controller so that a ghost can
+ *  seek to any time.
+ *  \param fd The file to read from.
+ *  \param second_replay True if this is the second replay.
  */
-void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
+void ReplayPlay::loadBinaryFile(FILE *fd, bool second_replay)
 {
-    char s[1024];
+    int replay_index = second_replay ? m_second_replay_file
+                                     : m_current_replay_file;
+    const unsigned int num_kart =
+        (unsigned int)m_replay_file_list[replay_index].m_kart_list.size();
+
+    try
+    {
+        // The last 4 bytes are the offset of the chunk index
+        char data[4];
+        if (fseek(fd, -4, SEEK_END) != 0 || fread(data, 1, 4, fd) != 4)
+            throw std::runtime_error("No chunk index");
+        const long end = ftell(fd) - 4;
+        const long index_offset = BareNetworkString(data, 4).getUInt32();
+        if (index_offset > end || fseek(fd, index_offset, SEEK_SET) != 0)
+            throw std::runtime_error("Invalid chunk index offset");
+        std::vector<char> index_data(end - index_offset);
+        if (fread(index_data.data(), 1, index_data.size(), fd) !=
+            index_data.size())
+            throw std::runtime_error("Can't read chunk index");
+        BareNetworkString index(index_data.data(), (int)index_data.size());
+        const unsigned int num_chunks = index.getUInt32();
+
+        std::vector<unsigned int> kart_of_chunk, chunk_offset, chunk_size;
+        std::vector<float> chunk_time;
+        for (unsigned int i = 0; i < num_chunks; i++)
+        {
+            kart_of_chunk.push_back(index.getUInt8());
+            chunk_time.push_back(index.getFloat());
+            chunk_offset.push_back(index.getUInt32());
+            chunk_size.push_back(index.getUInt32());
+        }
+
+        for (unsigned int k = 0; k < num_kart; k++)
+        {
+            const unsigned int kart_num = createGhostKart(second_replay);
+            GhostController* gc = dynamic_cast<GhostController*>(
+                m_ghost_karts[kart_num]->getController());
+            for (unsigned int i = 0; i < num_chunks; i++)
+            {
+                if (kart_of_chunk[i] != k) continue;
+                std::vector<char> chunk_data(chunk_size[i]);
+                if (fseek(fd, chunk_offset[i], SEEK_SET) != 0 ||
+                    fread(chunk_data.data(), 1, chunk_size[i], fd) !=
+                    chunk_size[i])
+                    throw std::runtime_error("Can't read chunk");
+                BareNetworkString chunk(chunk_data.data(), chunk_size[i]);
+                gc->addReplayChunk(chunk_time[i]);
+                chunk.getUInt8();   // Kart index, already in the chunk index
+                const unsigned int num_frames = chunk.getUInt16();
+                for (unsigned int j = 0; j < num_frames; j++)
+                {
+                    TransformEvent te;
+                    PhysicInfo pi;
+                    BonusInfo bi;
+                    KartReplayEvent kre;
+                    decodeFrame(chunk, &te, &pi, &bi, &kre);
+                    m_ghost_karts[kart_num]->addReplayEvent(te.m_time,
+                        te.m_transform, pi, bi, kre);
+                }
+            }   // for i < num_chunks
+        }   // for k < num_kart
+    }
+    catch (std::exception& e)
+    {
+        Log::error("Replay", "Can't read binary replay file '%s': %s.",
+            getReplayFilename(second_replay ? 2 : 1).c_str(), e.what());
+    }
+}   // loadBinaryFile
 
+//-----------------------------------------------------------------------------
+/** Creates the next ghost kart of a replay.
+ *  \param second_replay True if the kart is from the second replay.
+ *  \return Index of the new kart in m_ghost_karts.
+ */
+unsigned int ReplayPlay::createGhostKart(bool second_replay)
+{
     int replay_index = second_replay ? m_second_replay_file
                                      : m_current_replay_file;
 
@@ -387,6 +569,21 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
     Controller* controller = new GhostController(getGhostKart(kart_num).get(),
                                                  rd.m_name_list[kart_num-first_loaded_f_num]);
     getGhostKart(kart_num)->setController(controller);
+    return kart_num;
+}   // createGhostKart
+
+//-----------------------------------------------------------------------------
+/** Reads all data from a replay file for a specific kart.
+ *  \param fd The file descriptor from which to read.
+ */
+void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
+{
+    char s[1024];
+
+    int replay_index = second_replay ? m_second_replay_file
+                                     : m_current_replay_file;
+    ReplayData &rd = m_replay_file_list[replay_index];
+    const unsigned int kart_num = createGhostKart(second_replay);
 
     unsigned int size;
     if(sscanf(next_line,"size: %u",&size)!=1)
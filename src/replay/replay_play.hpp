@@ -30,6 +30,7 @@
 
 using namespace irr;
 
+class BareNetworkString;
 class GhostKart;
 
 /**
@@ -67,6 +68,7 @@ public:
         std::vector<float>         m_kart_color; //no sorting for this
         bool                       m_reverse;
         bool                       m_custom_replay_file;
+        bool                       m_binary_replay; //no sorting for this
         unsigned int               m_difficulty;
         unsigned int               m_laps;
         unsigned int               m_replay_version; //no sorting for this
@@ -124,7 +126,13 @@ private:
 
           ReplayPlay();
          ~ReplayPlay();
+    unsigned int createGhostKart(bool second_replay);
     void  readKartData(FILE *fd, char *next_line, bool second_replay);
+    void  loadBinaryFile(FILE *fd, bool second_replay);
+    bool  readBinaryReplayInfo(const BareNetworkString &header,
+                               const std::string &fn, ReplayData *rd);
+    bool  findReplayTrack(ReplayData *rd, const std::string &fn);
+    void  addReplayData(const ReplayData &rd, bool custom_replay);
 public:
     void  reset();
     void  load();
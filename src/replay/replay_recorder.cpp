@@ -19,6 +19,7 @@
 #include "replay/replay_recorder.hpp"
 
 #include "config/stk_config.hpp"
+#include "config/user_config.hpp"
 #include "io/file_manager.hpp"
 #include "items/attachment.hpp"
 #include "items/powerup.hpp"
@@ -31,6 +32,7 @@
 #include "modes/easter_egg_hunt.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/world.hpp"
+#include "network/network_string.hpp"
 #include "physics/btKart.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
@@ -385,7 +387,9 @@ void ReplayRecorder::save()
         << "_" << num_karts << "_" << time << ".replay";
     m_filename = oss.str();
 
-    FILE *fd = openReplayFile(/*writeable*/true);
+    const bool binary = UserConfigParams::m_binary_replay;
+    FILE *fd = openReplayFile(/*writeable*/true, /*full_path*/false,
+                              /*replay_file_number*/1, binary);
     if (!fd)
     {
         Log::error("ReplayRecorder", "Can't open '%s' for writing - "
@@ -397,6 +401,14 @@ void ReplayRecorder::save()
         StringUtils::utf8ToWide(file_manager->getReplayDir() + getReplayFilename()));
     MessageQueue::add(MessageQueue::MT_GENERIC, msg);
 
+    if (binary)
+    {
+        m_last_uid = computeUID(min_time);
+        saveBinary(fd, min_time);
+        fclose(fd);
+        return;
+    }
+
     fprintf(fd, "version: %d\n", getCurrentReplayVersion());
     fprintf(fd, "stk_version: %s\n", STK_VERSION);
 
@@ -479,6 +491,103 @@ void ReplayRecorder::save()
     fclose(fd);
 }   // save
 
+//-----------------------------------------------------------------------------
+/** Writes the replay in the binary format, see
+ *  ReplayBase::readBinaryReplayHeader for the layout. The frames of each
+ *  kart are split into chunks of BINARY_CHUNK_FRAMES frames, and the chunk
+ *  index stores the kart, the time of the first frame, the offset and the
+ *  size of each chunk.
+ *  \param fd The file to write to, opened in binary mode.
+ *  \param min_time The finish time of the fastest kart.
+ */
+void ReplayRecorder::saveBinary(FILE *fd, float min_time)
+{
+    const World *world           = World::getWorld();
+    const unsigned int num_karts = world->getNumKarts();
+
+    BareNetworkString header;
+    header.encodeString(std::string(STK_VERSION));
+    uint8_t num_real_karts = 0;
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        if (!world->getKart(k)->isGhostKart())
+            num_real_karts++;
+    }
+    header.addUInt8(num_real_karts);
+
+    unsigned int player_count = 0;
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        const AbstractKart *kart = world->getKart(k);
+        if (kart->isGhostKart()) continue;
+        header.encodeString(kart->getIdent())
+              .encodeString(kart->getController()->getName());
+        if (kart->getController()->isPlayerController())
+        {
+            header.addFloat(StateManager::get()
+                ->getActivePlayer(player_count)->getConstProfile()
+                ->getDefaultKartColor());
+            player_count++;
+        }
+        else
+            header.addFloat(0.0f);
+    }
+
+    int num_laps = race_manager->getNumLaps();
+    if (num_laps == 9999) num_laps = 0; // no lap in that race mode
+
+    header.addUInt8(race_manager->getReverseTrack() ? 1 : 0)
+          .addUInt8((uint8_t)race_manager->getDifficulty())
+          .encodeString(race_manager->getMinorModeName())
+          .encodeString(Track::getCurrentTrack()->getIdent())
+          .addUInt32(num_laps).addFloat(min_time).addUInt64(m_last_uid);
+
+    BareNetworkString start;
+    start.addUInt32(getCurrentBinaryReplayVersion())
+         .addUInt32(header.getTotalSize());
+    fwrite(getBinaryReplayMagic(), 1, 4, fd);
+    fwrite(start.getData(), 1, start.getTotalSize(), fd);
+    fwrite(header.getData(), 1, header.getTotalSize(), fd);
+    uint32_t offset = 4 + start.getTotalSize() + header.getTotalSize();
+
+    BareNetworkString index;
+    uint32_t num_chunks = 0;
+    uint8_t kart_index = 0;
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        if (world->getKart(k)->isGhostKart()) continue;
+        unsigned int num_transforms = std::min(m_max_frames,
+                                               m_count_transforms[k]);
+        for (unsigned int first = 0; first < num_transforms;
+             first += BINARY_CHUNK_FRAMES)
+        {
+            const unsigned int n = std::min(BINARY_CHUNK_FRAMES,
+                                            num_transforms - first);
+            BareNetworkString chunk(n * 48 + 3);
+            chunk.addUInt8(kart_index).addUInt16(n);
+            for (unsigned int i = first; i < first + n; i++)
+            {
+                encodeFrame(&chunk, m_transform_events[k][i],
+                    m_physic_info[k][i], m_bonus_info[k][i],
+                    m_kart_replay_event[k][i]);
+            }
+            fwrite(chunk.getData(), 1, chunk.getTotalSize(), fd);
+            index.addUInt8(kart_index)
+                 .addFloat(m_transform_events[k][first].m_time)
+                 .addUInt32(offset).addUInt32(chunk.getTotalSize());
+            offset += chunk.getTotalSize();
+            num_chunks++;
+        }
+        kart_index++;
+    }
+
+    BareNetworkString footer;
+    footer.addUInt32(num_chunks);
+    footer += index;
+    footer.addUInt32(offset);
+    fwrite(footer.getData(), 1, footer.getTotalSize(), fd);
+}   // saveBinary
+
 /* Returns an encoding value for a given attachment type.
  * The internal values of the enum for attachments may change if attachments
  * are introduced, removed or even reordered. To avoid compatibility issues
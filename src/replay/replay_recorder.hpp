@@ -85,6 +85,8 @@ private:
     /** Compute the replay's UID ; partly based on race data ; partly randomly */
     uint64_t computeUID(float min_time);
 
+    void saveBinary(FILE *fd, float min_time);
+
 
           ReplayRecorder();
          ~ReplayRecorder();
@@ -37,6 +37,7 @@
 #include "states_screens/dialogs/tutorial_message_dialog.hpp"
 #include "tracks/track_object_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/constants.hpp"
 #include "utils/file_utils.hpp"
 #include "utils/profiler.hpp"
 
@@ -47,6 +48,46 @@ namespace Scripting
 {
     const char* MODULE_ID_MAIN_SCRIPT_FILE = "main";
 
+    /** Identifies a file with cached byte code of the track scripts. */
+    const uint32_t BYTE_CODE_MAGIC = 0x53435342;   // "BSCS"
+    /** Increase this whenever the registered script interface changes in a
+     *  way that old byte code must not be used anymore. */
+    const uint32_t BYTE_CODE_VERSION = 2;
+    /** Larger cache files are considered corrupted. */
+    const uint64_t MAX_BYTE_CODE_SIZE = 64 * 1024 * 1024;
+
+    /** An AngelScript binary stream reading from or writing to memory, so
+     *  that the checksum of the byte code can be computed or verified. */
+    class MemoryBinaryStream : public asIBinaryStream
+    {
+    private:
+        std::string* m_data;
+        size_t m_read_position;
+        bool m_ok;
+    public:
+        MemoryBinaryStream(std::string* data)
+            : m_data(data), m_read_position(0), m_ok(true) {}
+        virtual int Read(void *ptr, asUINT size)
+        {
+            if (size > m_data->size() - m_read_position)
+            {
+                m_ok = false;
+                return asERROR;
+            }
+            if (size > 0)
+                memcpy(ptr, m_data->data() + m_read_position, size);
+            m_read_position += size;
+            return asSUCCESS;
+        }
+        virtual int Write(const void *ptr, asUINT size)
+        {
+            m_data->append((const char*)ptr, size);
+            return asSUCCESS;
+        }
+        /** True if all reads were successful. */
+        bool isOk() const { return m_ok; }
+    };   // MemoryBinaryStream
+
     void AngelScript_ErrorCallback (const asSMessageInfo *msg, void *param)
     {
         const char *type = "ERR ";
@@ -81,6 +122,9 @@ namespace Scripting
     {
         // Release the engine
         m_pending_timeouts.clearAndDeleteAll();
+        for (asIScriptContext* ctx : m_context_pool)
+            ctx->Release();
+        m_context_pool.clear();
         m_engine->DiscardModule(MODULE_ID_MAIN_SCRIPT_FILE);
         m_engine->Release();
     }
@@ -120,6 +164,31 @@ namespace Scripting
         return script;
     }
 
+    //-----------------------------------------------------------------------------
+    /** Returns a context to execute a script function, either an unused one
+     *  from the pool or a new one. It must be given back with returnContext.
+     *  Nested calls (a script function triggering another one) each get
+     *  their own context.
+     */
+    asIScriptContext* ScriptEngine::requestContext()
+    {
+        if (m_context_pool.empty())
+            return m_engine->CreateContext();
+        asIScriptContext* ctx = m_context_pool.back();
+        m_context_pool.pop_back();
+        return ctx;
+    }   // requestContext
+
+    //-----------------------------------------------------------------------------
+    /** Puts a context that is not used anymore back into the pool.
+     */
+    void ScriptEngine::returnContext(asIScriptContext *ctx)
+    {
+        // Release the references to the last function and its arguments
+        ctx->Unprepare();
+        m_context_pool.push_back(ctx);
+    }   // returnContext
+
     //-----------------------------------------------------------------------------
 
     void ScriptEngine::evalScript(std::string script_fragment)
@@ -136,7 +205,7 @@ namespace Scripting
             return;
         }
 
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = requestContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "evalScript: Failed to create the context.");
@@ -148,7 +217,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "evalScript: Failed to prepare the context.");
-            ctx->Release();
+            returnContext(ctx);
             return;
         }
 
@@ -171,7 +240,7 @@ namespace Scripting
             }
         }
 
-        ctx->Release();
+        returnContext(ctx);
         func->Release();
     }
 
@@ -179,7 +248,7 @@ namespace Scripting
 
     void ScriptEngine::runDelegate(asIScriptFunction* delegate)
     {
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = requestContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "runMethod: Failed to create the context.");
@@ -191,7 +260,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "runMethod: Failed to prepare the context.");
-            ctx->Release();
+            returnContext(ctx);
             return;
         }
 
@@ -216,7 +285,7 @@ namespace Scripting
             }
         }
 
-        ctx->Release();
+        returnContext(ctx);
     }
 
     //-----------------------------------------------------------------------------
@@ -350,8 +419,8 @@ namespace Scripting
             return; // function unavailable
         }
 
-        // Create a context that will execute the script.
-        asIScriptContext *ctx = m_engine->CreateContext();
+        // Get a context that will execute the script.
+        asIScriptContext *ctx = requestContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "Failed to create the context.");
@@ -368,7 +437,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "Failed to prepare the context.");
-            ctx->Release();
+            returnContext(ctx);
             //m_engine->Release();
             return;
         }
@@ -416,8 +485,8 @@ namespace Scripting
                 get_return_value(ctx);
         }
 
-        // We must release the contexts when no longer using them
-        ctx->Release();
+        // Keep the context for the next function call
+        returnContext(ctx);
     }
 
     //-----------------------------------------------------------------------------
@@ -466,8 +535,6 @@ namespace Scripting
 
     bool ScriptEngine::loadScript(std::string script_path, bool clear_previous)
     {
-        int r;
-
         std::string script = getScript(script_path);
         if (script.size() == 0)
         {
@@ -475,20 +542,17 @@ namespace Scripting
             return false;
         }
 
-        // Add the script sections that will be compiled into executable code.
+        // The script sections are only added to the module when the scripts
+        // are compiled, and only if there is no cached byte code for them.
         // If we want to combine more than one file into the same script, then 
-        // we can call AddScriptSection() several times for the same module and
-        // the script engine will treat them all as if they were one. The script
-        // section name, will allow us to localize any errors in the script code.
-        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE,
+        // we can call loadScript() several times for the same module and
+        // the script engine will treat them all as if they were one.
+        m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE,
             clear_previous ? asGM_ALWAYS_CREATE : asGM_CREATE_IF_NOT_EXISTS);
-        r = mod->AddScriptSection("script", &script[0], script.size());
-        if (r < 0)
-        {
-            Log::error("Scripting", "AddScriptSection() failed");
-            return false;
-        }
-    
+        if (clear_previous)
+            m_script_sections.clear();
+        m_script_sections.push_back(script);
+
         return true;
     }
 
@@ -499,6 +563,31 @@ namespace Scripting
         int r;
         asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_CREATE_IF_NOT_EXISTS);
 
+        // Use the byte code of a previous compilation of the same scripts
+        const uint64_t hash = getScriptHash();
+        if (loadByteCode(mod, hash))
+        {
+            m_script_sections.clear();
+            return true;
+        }
+        // Loading the byte code could have left a partial module behind
+        mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_ALWAYS_CREATE);
+
+        // Add the script sections that will be compiled into executable code.
+        // The script section name, will allow us to localize any errors in
+        // the script code.
+        for (const std::string& script : m_script_sections)
+        {
+            r = mod->AddScriptSection("script", script.c_str(), script.size());
+            if (r < 0)
+            {
+                Log::error("Scripting", "AddScriptSection() failed");
+                m_script_sections.clear();
+                return false;
+            }
+        }
+        m_script_sections.clear();
+
         // Compile the script. If there are any compiler messages they will
         // be written to the message stream that we set right after creating the 
         // script engine. If there are no errors, and no warnings, nothing will
@@ -509,6 +598,7 @@ namespace Scripting
             Log::error("Scripting", "Build() failed");
             return false;
         }
+        saveByteCode(mod, hash);
 
         // The engine doesn't keep a copy of the script sections after Build() has
         // returned. So if the script needs to be recompiled, then all the script
@@ -523,6 +613,89 @@ namespace Scripting
         return true;
     }
 
+    //-----------------------------------------------------------------------------
+    /** Returns a FNV-1a hash of all loaded script sections together with the
+     *  STK and AngelScript versions, which identifies the cached byte code.
+     *  Returns 0 if no script is loaded.
+     */
+    uint64_t ScriptEngine::getScriptHash() const
+    {
+        if (m_script_sections.empty())
+            return 0;
+        const std::string version = std::string(STK_VERSION) + " " +
+            asGetLibraryVersion() + " " + asGetLibraryOptions();
+        uint64_t hash = FileUtils::checksum(version.c_str(),
+                                            version.size() + 1);
+        for (const std::string& script : m_script_sections)
+        {
+            const uint64_t len = script.size();
+            hash = FileUtils::checksum(&len, sizeof(len), hash);
+            hash = FileUtils::checksum(script.c_str(), script.size(), hash);
+        }
+        return hash;
+    }   // getScriptHash
+
+    //-----------------------------------------------------------------------------
+    std::string ScriptEngine::getByteCodeFileName(uint64_t hash) const
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "script-%016llx.bin",
+                 (unsigned long long)hash);
+        return file_manager->getCachedDataDir() + name;
+    }   // getByteCodeFileName
+
+    //-----------------------------------------------------------------------------
+    /** Loads the byte code of the loaded scripts into the module, if it was
+     *  cached by an earlier compilation.
+     *  \param mod The (empty) module to load the byte code into.
+     *  \param hash Hash of the loaded scripts.
+     *  \return True if the byte code was loaded.
+     */
+    bool ScriptEngine::loadByteCode(asIScriptModule *mod, uint64_t hash)
+    {
+        if (hash == 0)
+            return false;
+        const std::string file_name = getByteCodeFileName(hash);
+        // Only give byte code to AngelScript if it is complete and unchanged
+        std::string byte_code;
+        if (!FileUtils::readCacheFile(file_name, BYTE_CODE_MAGIC,
+                                      BYTE_CODE_VERSION, hash,
+                                      MAX_BYTE_CODE_SIZE, &byte_code))
+            return false;
+        MemoryBinaryStream stream(&byte_code);
+        const bool success = mod->LoadByteCode(&stream) >= 0 &&
+                             stream.isOk();
+        if (!success)
+        {
+            Log::warn("Scripting", "Ignoring invalid byte code file '%s'.",
+                      file_name.c_str());
+        }
+        return success;
+    }   // loadByteCode
+
+    //-----------------------------------------------------------------------------
+    /** Saves the byte code of the compiled module, so that the same scripts
+     *  don't need to be compiled again.
+     *  \param mod The compiled module.
+     *  \param hash Hash of the compiled scripts.
+     */
+    void ScriptEngine::saveByteCode(asIScriptModule *mod, uint64_t hash) const
+    {
+        if (hash == 0)
+            return;
+        // Keep the debug info, so that script errors show line numbers
+        std::string byte_code;
+        MemoryBinaryStream stream(&byte_code);
+        if (mod->SaveByteCode(&stream) < 0)
+        {
+            Log::warn("Scripting", "Can't save byte code.");
+            return;
+        }
+        FileUtils::writeCacheFile(getByteCodeFileName(hash), BYTE_CODE_MAGIC,
+                                  BYTE_CODE_VERSION, hash, byte_code.data(),
+                                  byte_code.size());
+    }   // saveByteCode
+
     //-----------------------------------------------------------------------------
 
     PendingTimeout::PendingTimeout(double time, asIScriptFunction* callback_delegate) 
@@ -27,7 +27,9 @@
 #include <angelscript.h>
 #include <functional>
 #include <map>
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 class TrackObjectPresentation;
 
@@ -91,7 +93,21 @@ namespace Scripting
         std::map<std::string, asIScriptFunction*> m_functions_cache;
         PtrVector<PendingTimeout> m_pending_timeouts;
 
+        /** Contexts which are not in use, to avoid creating a new context
+         *  for each function call (e.g. for each collision callback). */
+        std::vector<asIScriptContext*> m_context_pool;
+
+        /** The script sections loaded since the last compilation. They are
+         *  only added to the module if no cached byte code is found. */
+        std::vector<std::string> m_script_sections;
+
         void configureEngine(asIScriptEngine *engine);
+        asIScriptContext* requestContext();
+        void returnContext(asIScriptContext *ctx);
+        uint64_t getScriptHash() const;
+        std::string getByteCodeFileName(uint64_t hash) const;
+        bool loadByteCode(asIScriptModule *mod, uint64_t hash);
+        void saveByteCode(asIScriptModule *mod, uint64_t hash) const;
     };   // class ScriptEngine
 
 }
@@ -25,20 +25,39 @@
 #include "tracks/arena_node.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
+#include "utils/vs.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <queue>
+#include <string.h>
+#include <thread>
+
+namespace
+{
+    /** Identifies a file with cached shortest paths of an arena. */
+    const uint32_t CACHE_MAGIC = 0x4d56414e;   // "NAVM"
+    /** Increase this whenever the cache content or the shortest path
+     *  computation changes, so that old cache files are ignored. */
+    const uint32_t CACHE_VERSION = 2;
+}   // namespace
 
 // -----------------------------------------------------------------------------
 ArenaGraph::ArenaGraph(const std::string &navmesh, const XMLNode *node)
           : Graph()
 {
     loadNavmesh(navmesh);
-    buildGraph();
-    // Compute shortest distance from all nodes
-    for (unsigned int i = 0; i < getNumNodes(); i++)
-        computeDijkstra(i);
+    buildSpatialIndex();
+    // Compute shortest distance from all nodes, unless they are cached
+    const uint64_t hash = getNavmeshHash(navmesh);
+    if (!loadShortestPaths(hash))
+    {
+        buildGraph();
+        computeAllDijkstra();
+        saveShortestPaths(hash);
+    }
 
     setNearbyNodesOfAllNodes();
     if (node && race_manager->getMinorMode() == RaceManager::MINOR_MODE_SOCCER)
@@ -57,6 +76,19 @@ ArenaNode* ArenaGraph::getNode(unsigned int i) const
     return n;
 }   // getNode
 
+// -----------------------------------------------------------------------------
+/** Adds the shortest path matrices, which use most of the memory of an arena
+ *  graph, to the estimate of the base class. */
+size_t ArenaGraph::getMemoryUsage() const
+{
+    size_t size = Graph::getMemoryUsage() +
+        m_distance_matrix.capacity() * sizeof(float) +
+        m_parent_node.capacity() * sizeof(int16_t);
+    for (unsigned int i = 0; i < m_all_nodes.size(); i++)
+        size += getNode(i)->getNearbyNodes()->capacity() * sizeof(int);
+    return size;
+}   // getMemoryUsage
+
 // -----------------------------------------------------------------------------
 void ArenaGraph::differentNodeColor(int n, video::SColor* c) const
 {
@@ -179,8 +211,7 @@ void ArenaGraph::buildGraph()
 {
     const unsigned int n_nodes = getNumNodes();
 
-    m_distance_matrix = std::vector<std::vector<float>>
-        (n_nodes, std::vector<float>(n_nodes, 9999.9f));
+    m_distance_matrix.assign(n_nodes * n_nodes, 9999.9f);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         ArenaNode* cur_node = getNode(i);
@@ -188,22 +219,21 @@ void ArenaGraph::buildGraph()
         {
             Vec3 diff = getNode(adjacent)->getCenter() - cur_node->getCenter();
             float distance = diff.length();
-            m_distance_matrix[i][adjacent] = distance;
+            m_distance_matrix[i * n_nodes + adjacent] = distance;
         }
-        m_distance_matrix[i][i] = 0.0f;
+        m_distance_matrix[i * n_nodes + i] = 0.0f;
     }
 
     // Allocate and initialise the previous node data structure:
-    m_parent_node = std::vector<std::vector<int16_t>>
-        (n_nodes, std::vector<int16_t>(n_nodes, Graph::UNKNOWN_SECTOR));
+    m_parent_node.assign(n_nodes * n_nodes, Graph::UNKNOWN_SECTOR);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         for (unsigned int j = 0; j < n_nodes; j++)
         {
-            if (i == j || m_distance_matrix[i][j] >= 9899.9f)
-                m_parent_node[i][j] = -1;
+            if (i == j || m_distance_matrix[i * n_nodes + j] >= 9899.9f)
+                m_parent_node[i * n_nodes + j] = -1;
             else
-                m_parent_node[i][j] = i;
+                m_parent_node[i * n_nodes + j] = i;
         }   // for j
     }   // for i
 
@@ -216,6 +246,8 @@ void ArenaGraph::buildGraph()
  *  source to j and m_parent_node[source][j] stores the last vertex visited on
  *  the shortest path from i to j before visiting j. Suppose the shortest path
  *  from i to j is i->......->k->j  then m_parent_node[i][j] = k
+ *  Only the row of 'source' is modified, so this can be called for different
+ *  sources at the same time.
  */
 void ArenaGraph::computeDijkstra(int source)
 {
@@ -235,6 +267,8 @@ void ArenaGraph::computeDijkstra(int source)
     IndDistPair begin(source, 0.0f);
     queue.push(begin);
     const unsigned int n = getNumNodes();
+    float* distance = m_distance_matrix.data() + source * n;
+    int16_t* parent = m_parent_node.data() + source * n;
     std::vector<bool> visited;
     visited.resize(n, false);
     while (!queue.empty())
@@ -246,17 +280,20 @@ void ArenaGraph::computeDijkstra(int source)
         if (visited[cur_index]) continue;
         visited[cur_index] = true;
 
+        const Vec3& center = getNode(cur_index)->getCenter();
         for (const int& adjacent : getNode(cur_index)->getAdjacentNodes())
         {
             // Distance already computed, can be ignored
             if (visited[adjacent]) continue;
 
-            float new_dist =
-                current.second + m_distance_matrix[cur_index][adjacent];
-            if (new_dist < m_distance_matrix[source][adjacent])
+            // Use the same edge length as buildGraph, the rows of the
+            // other nodes might be modified by other threads
+            float new_dist = current.second +
+                (getNode(adjacent)->getCenter() - center).length();
+            if (new_dist < distance[adjacent])
             {
-                m_distance_matrix[source][adjacent] = new_dist;
-                m_parent_node[source][adjacent] = cur_index;
+                distance[adjacent] = new_dist;
+                parent[adjacent] = cur_index;
             }
             IndDistPair pair(adjacent, new_dist);
             queue.push(pair);
@@ -264,6 +301,37 @@ void ArenaGraph::computeDijkstra(int source)
     }
 }   // computeDijkstra
 
+// ----------------------------------------------------------------------------
+/** Computes the shortest paths from all nodes, distributing the nodes over
+ *  one thread per CPU core. buildGraph must have been called before.
+ */
+void ArenaGraph::computeAllDijkstra()
+{
+    const unsigned int n = getNumNodes();
+    // Small graphs are not worth starting threads for
+    unsigned int thread_count = std::thread::hardware_concurrency();
+    thread_count = std::max(1u, std::min(thread_count, n / 64));
+
+    std::atomic<unsigned int> next_source(0);
+    auto compute = [this, n, &next_source]()
+    {
+        for (unsigned int i = next_source++; i < n; i = next_source++)
+            computeDijkstra(i);
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < thread_count; i++)
+    {
+        threads.emplace_back([compute]()
+            {
+                VS::setThreadName("ArenaGraph");
+                compute();
+            });
+    }
+    compute();
+    for (std::thread& t : threads)
+        t.join();
+}   // computeAllDijkstra
+
 // ----------------------------------------------------------------------------
 /** THIS FUNCTION IS ONLY USED FOR UNIT-TESTING, to verify that the new
  *  Dijkstra algorithm gives the same results.
@@ -284,12 +352,14 @@ void ArenaGraph::computeFloydWarshall()
         {
             for (unsigned int j = 0; j < n; j++)
             {
-                if ((m_distance_matrix[i][k] + m_distance_matrix[k][j]) <
-                    m_distance_matrix[i][j])
+                if ((m_distance_matrix[i * n + k] +
+                     m_distance_matrix[k * n + j]) <
+                    m_distance_matrix[i * n + j])
                 {
-                    m_distance_matrix[i][j] =
-                        m_distance_matrix[i][k] + m_distance_matrix[k][j];
-                    m_parent_node[i][j] = m_parent_node[k][j];
+                    m_distance_matrix[i * n + j] =
+                        m_distance_matrix[i * n + k] +
+                        m_distance_matrix[k * n + j];
+                    m_parent_node[i * n + j] = m_parent_node[k * n + j];
                 }
             }
         }
@@ -297,6 +367,82 @@ void ArenaGraph::computeFloydWarshall()
 
 }   // computeFloydWarshall
 
+// ----------------------------------------------------------------------------
+/** Returns a FNV-1a hash of the content of the navmesh file, which is used
+ *  to identify the cached shortest paths. Returns 0 if the file can't be
+ *  read.
+ */
+uint64_t ArenaGraph::getNavmeshHash(const std::string &navmesh)
+{
+    FILE* fp = FileUtils::fopenU8Path(navmesh, "rb");
+    if (!fp)
+        return 0;
+    uint64_t hash = FileUtils::CHECKSUM_START;
+    uint8_t buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        hash = FileUtils::checksum(buffer, len, hash);
+    fclose(fp);
+    return hash;
+}   // getNavmeshHash
+
+// ----------------------------------------------------------------------------
+std::string ArenaGraph::getCacheFileName(uint64_t hash)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "navmesh-%016llx.bin",
+             (unsigned long long)hash);
+    return file_manager->getCachedDataDir() + name;
+}   // getCacheFileName
+
+// ----------------------------------------------------------------------------
+/** Loads the distance and parent matrices from the cache.
+ *  \param hash Hash of the navmesh the matrices were computed for.
+ *  \return True if the matrices were loaded, false if there is no valid
+ *          cache file.
+ */
+bool ArenaGraph::loadShortestPaths(uint64_t hash)
+{
+    if (hash == 0)
+        return false;
+    const unsigned int n = getNumNodes();
+    const size_t matrix_size = (size_t)n * n;
+    const size_t size = matrix_size * (sizeof(float) + sizeof(int16_t));
+    std::string data;
+    if (!FileUtils::readCacheFile(getCacheFileName(hash), CACHE_MAGIC,
+                                  CACHE_VERSION, hash, size, &data))
+        return false;
+    if (data.size() != size)
+    {
+        Log::warn("ArenaGraph", "Ignoring invalid cache file '%s'.",
+                  getCacheFileName(hash).c_str());
+        return false;
+    }
+    m_distance_matrix.resize(matrix_size);
+    m_parent_node.resize(matrix_size);
+    memcpy(m_distance_matrix.data(), data.data(),
+           matrix_size * sizeof(float));
+    memcpy(m_parent_node.data(), data.data() + matrix_size * sizeof(float),
+           matrix_size * sizeof(int16_t));
+    return true;
+}   // loadShortestPaths
+
+// ----------------------------------------------------------------------------
+/** Saves the distance and parent matrices in the cache.
+ *  \param hash Hash of the navmesh the matrices were computed for.
+ */
+void ArenaGraph::saveShortestPaths(uint64_t hash) const
+{
+    if (hash == 0)
+        return;
+    std::string data((const char*)m_distance_matrix.data(),
+                     m_distance_matrix.size() * sizeof(float));
+    data.append((const char*)m_parent_node.data(),
+                m_parent_node.size() * sizeof(int16_t));
+    FileUtils::writeCacheFile(getCacheFileName(hash), CACHE_MAGIC,
+                              CACHE_VERSION, hash, data.data(), data.size());
+}   // saveShortestPaths
+
 // -----------------------------------------------------------------------------
 void ArenaGraph::loadGoalNodes(const XMLNode *node)
 {
@@ -341,7 +487,8 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
         // Get the distance to all nodes at i
         ArenaNode* cur_node = getNode(i);
         std::vector<int> nearby_nodes;
-        std::vector<float> dist = m_distance_matrix[i];
+        std::vector<float> dist(m_distance_matrix.begin() + i * getNumNodes(),
+            m_distance_matrix.begin() + (i + 1) * getNumNodes());
 
         // Skip the same node
         dist[i] = 999999.0f;
@@ -363,13 +510,13 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
  *  std::vector (in reverse order). Used only for unit testing.
  */
 std::vector<int16_t> ArenaGraph::getPathFromTo(int from, int to,
-                      const std::vector< std::vector< int16_t > >& parent_node)
+                               const std::vector<int16_t>& parent_node) const
 {
     std::vector<int16_t> path;
     path.push_back(to);
     while(from!=to)
     {
-        to = parent_node[from][to];
+        to = parent_node[from * getNumNodes() + to];
         path.push_back(to);
     }
     return path;
@@ -392,9 +539,19 @@ void ArenaGraph::unitTesting()
     double e = StkTime::getRealTime();
     Log::error("Time", "Dijkstra       %lf", e-s);
 
-    // Save the Dijkstra results
-    std::vector< std::vector< float > > distance_matrix = ag->m_distance_matrix;
-    std::vector< std::vector< int16_t > > parent_node = ag->m_parent_node;
+    // Save the Dijkstra results (which might have been loaded from the
+    // cache), and check that computing them again gives the same results
+    std::vector<float> distance_matrix = ag->m_distance_matrix;
+    std::vector<int16_t> parent_node = ag->m_parent_node;
+    ag->buildGraph();
+    ag->computeAllDijkstra();
+    int error_count = 0;
+    if (ag->m_distance_matrix != distance_matrix ||
+        ag->m_parent_node != parent_node)
+    {
+        Log::error("ArenaGraph", "Cached shortest paths are different.");
+        error_count++;
+    }
     ag->buildGraph();
 
     // Now compute results with Floyd-Warshall
@@ -403,16 +560,17 @@ void ArenaGraph::unitTesting()
     e = StkTime::getRealTime();
     Log::error("Time", "Floyd-Warshall %lf", e-s);
 
-    int error_count = 0;
-    for(unsigned int i=0; i<ag->m_distance_matrix.size(); i++)
+    const unsigned int n = ag->getNumNodes();
+    for(unsigned int i=0; i<n; i++)
     {
-        for(unsigned int j=0; j<ag->m_distance_matrix[i].size(); j++)
+        for(unsigned int j=0; j<n; j++)
         {
-            if(ag->m_distance_matrix[i][j] - distance_matrix[i][j] > 0.001f)
+            if(ag->m_distance_matrix[i*n+j] - distance_matrix[i*n+j] > 0.001f)
             {
                 Log::error("ArenaGraph",
                            "Incorrect distance %d, %d: Dijkstra: %f F.W.: %f",
-                           i, j, distance_matrix[i][j], ag->m_distance_matrix[i][j]);
+                           i, j, distance_matrix[i*n+j],
+                           ag->m_distance_matrix[i*n+j]);
                 error_count++;
             }    // if distance is too different
 
@@ -424,16 +582,16 @@ void ArenaGraph::unitTesting()
             // debugging in the feature
 #undef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
 #ifdef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
-            if(ag->m_parent_node[i][j] != parent_node[i][j])
+            if(ag->m_parent_node[i*n+j] != parent_node[i*n+j])
             {
                 error_count++;
-                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, parent_node);
-                std::vector<int16_t> floyd_path = getPathFromTo(i, j, ag->m_parent_node);
+                std::vector<int16_t> dijkstra_path = ag->getPathFromTo(i, j, parent_node);
+                std::vector<int16_t> floyd_path = ag->getPathFromTo(i, j, ag->m_parent_node);
                 if(dijkstra_path.size()!=floyd_path.size())
                 {
                     Log::error("ArenaGraph",
                                "Incorrect path length %d, %d: Dijkstra: %d F.W.: %d",
-                               i, j, parent_node[i][j], ag->m_parent_node[i][j]);
+                               i, j, parent_node[i*n+j], ag->m_parent_node[i*n+j]);
                     continue;
                 }
                 Log::error("ArenaGraph", "Path problems from %d to %d:",
@@ -451,6 +609,37 @@ void ArenaGraph::unitTesting()
         }   // for j
     }   // for i
 
+    // Check that the spatial index finds the same nodes as testing all nodes
+    for (unsigned int i = 0; i < ag->getNumNodes(); i++)
+    {
+        const Vec3 xyz = ag->getNode(i)->getCenter() + Vec3(0.3f, 0.0f, 0.7f);
+        int sector = Graph::UNKNOWN_SECTOR;
+        ag->findRoadSector(xyz, &sector, NULL, true);
+        if (sector != Graph::UNKNOWN_SECTOR &&
+            !ag->getNode(sector)->pointInside(xyz, true))
+        {
+            Log::error("ArenaGraph", "Incorrect road sector %d for node %d",
+                       sector, i);
+            error_count++;
+        }
+        const Vec3 far_away = xyz * 1.5f + Vec3(20.0f, 0.0f, -20.0f);
+        float min_dist_2 = 999999.0f * 999999.0f;
+        for (unsigned int j = 0; j < ag->getNumNodes(); j++)
+        {
+            min_dist_2 = std::min(min_dist_2,
+                ag->getNode(j)->getDistance2FromPoint(far_away));
+        }
+        const int out_sector = ag->findOutOfRoadSector(far_away, NULL,
+            true);
+        if (ag->getNode(out_sector)->getDistance2FromPoint(far_away) -
+            min_dist_2 > 0.001f)
+        {
+            Log::error("ArenaGraph", "Incorrect out of road sector %d",
+                       out_sector);
+            error_count++;
+        }
+    }   // for i
+
     delete ag;
 
 }   // unitTesting
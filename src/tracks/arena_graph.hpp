@@ -34,11 +34,13 @@ class XMLNode;
 class ArenaGraph : public Graph
 {
 private:
-    /** The actual graph data structure, it is an adjacency matrix. */
-    std::vector<std::vector<float>> m_distance_matrix;
+    /** The actual graph data structure, it is an adjacency matrix stored
+     *  row by row: the distance from i to j is at i * getNumNodes() + j. */
+    std::vector<float> m_distance_matrix;
 
-    /** The matrix that is used to store computed shortest paths. */
-    std::vector<std::vector<int16_t>> m_parent_node;
+    /** The matrix that is used to store computed shortest paths, stored
+     *  like m_distance_matrix. */
+    std::vector<int16_t> m_parent_node;
 
     /** Used in soccer mode to colorize the goal lines in minimap. */
     std::set<int> m_red_node;
@@ -56,10 +58,20 @@ private:
     // ------------------------------------------------------------------------
     void computeDijkstra(int n);
     // ------------------------------------------------------------------------
+    void computeAllDijkstra();
+    // ------------------------------------------------------------------------
     void computeFloydWarshall();
     // ------------------------------------------------------------------------
-    static std::vector<int16_t> getPathFromTo(int from, int to,
-                     const std::vector< std::vector< int16_t > >& parent_node);
+    static uint64_t getNavmeshHash(const std::string &navmesh);
+    // ------------------------------------------------------------------------
+    static std::string getCacheFileName(uint64_t hash);
+    // ------------------------------------------------------------------------
+    bool loadShortestPaths(uint64_t hash);
+    // ------------------------------------------------------------------------
+    void saveShortestPaths(uint64_t hash) const;
+    // ------------------------------------------------------------------------
+    std::vector<int16_t> getPathFromTo(int from, int to,
+                              const std::vector<int16_t>& parent_node) const;
     // ------------------------------------------------------------------------
     virtual bool hasLapLine() const OVERRIDE                  { return false; }
     // ------------------------------------------------------------------------
@@ -74,6 +86,8 @@ public:
     // ------------------------------------------------------------------------
     virtual ~ArenaGraph() {}
     // ------------------------------------------------------------------------
+    virtual size_t getMemoryUsage() const OVERRIDE;
+    // ------------------------------------------------------------------------
     ArenaNode* getNode(unsigned int i) const;
     // ------------------------------------------------------------------------
     /** Returns the next node on the shortest path from i to j.
@@ -84,7 +98,7 @@ public:
     {
         if (i == Graph::UNKNOWN_SECTOR || j == Graph::UNKNOWN_SECTOR)
             return Graph::UNKNOWN_SECTOR;
-        return (int)(m_parent_node[j][i]);
+        return (int)(m_parent_node[j * getNumNodes() + i]);
     }
     // ------------------------------------------------------------------------
     /** Returns the distance between any two nodes */
@@ -92,7 +106,7 @@ public:
     {
         if (from == Graph::UNKNOWN_SECTOR || to == Graph::UNKNOWN_SECTOR)
             return 99999.0f;
-        return m_distance_matrix[from][to];
+        return m_distance_matrix[from * getNumNodes() + to];
     }
 
 };   // ArenaGraph
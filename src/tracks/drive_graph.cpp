@@ -160,6 +160,7 @@ void DriveGraph::load(const std::string &quad_file_name,
             max_height_testing);
     }
     delete quad;
+    buildSpatialIndex();
 
     const XMLNode *xml = file_manager->createXMLTree(filename);
 
@@ -282,10 +283,21 @@ unsigned int DriveGraph::getStartNode() const
  */
 void DriveGraph::computeChecklineRequirements()
 {
+    // A graph reused from the cache has the requirements of an earlier race
+    clearChecklineRequirements();
     computeChecklineRequirements(getNode(0),
                                  CheckManager::get()->getLapLineIndex());
 }   // computeChecklineRequirements
 
+// ----------------------------------------------------------------------------
+/** Removes the checkline requirements of all nodes.
+ */
+void DriveGraph::clearChecklineRequirements()
+{
+    for (unsigned int i = 0; i < getNumNodes(); i++)
+        getNode(i)->clearChecklineRequirements();
+}   // clearChecklineRequirements
+
 // ----------------------------------------------------------------------------
 /** Finds which checklines must be visited before driving on this quad
  *  (useful for rescue)
@@ -99,6 +99,8 @@ public:
     // ------------------------------------------------------------------------
     void computeChecklineRequirements();
     // ------------------------------------------------------------------------
+    void clearChecklineRequirements();
+    // ------------------------------------------------------------------------
     /** Return the distance to the j-th successor of node n. */
     float getDistanceToNext(int n, int j) const;
     // ------------------------------------------------------------------------
@@ -180,6 +180,9 @@ public:
     const std::vector<int>& getChecklineRequirements() const
                                            { return m_checkline_requirements; }
     // ------------------------------------------------------------------------
+    /** Removes all checkline requirements of this drive node. */
+    void clearChecklineRequirements()    { m_checkline_requirements.clear(); }
+    // ------------------------------------------------------------------------
     /** Returns the direction in which the successor n is. */
     void getDirectionData(unsigned int succ, DirectionType *dir,
                           unsigned int *last) const
@@ -33,10 +33,14 @@
 #include "tracks/track.hpp"
 #include "utils/log.hpp"
 
+#include <algorithm>
+#include <limits>
+
 const int Graph::UNKNOWN_SECTOR = -1;
 const float Graph::MIN_HEIGHT_TESTING = -1.0f;
 const float Graph::MAX_HEIGHT_TESTING = 5.0f;
 Graph *Graph::m_graph = NULL;
+std::list<Graph*> Graph::m_cached_graphs;
 // -----------------------------------------------------------------------------
 Graph::Graph()
 {
@@ -48,6 +52,9 @@ Graph::Graph()
     m_bb_min      = Vec3( 99999,  99999,  99999);
     m_bb_max      = Vec3(-99999, -99999, -99999);
     memset(m_bb_nodes, 0, 4 * sizeof(int));
+    m_grid_min_x = m_grid_min_z = 0.0f;
+    m_grid_cell_size = 1.0f;
+    m_grid_size_x = m_grid_size_z = 0;
 }  // Graph
 
 // -----------------------------------------------------------------------------
@@ -63,6 +70,95 @@ Graph::~Graph()
     m_all_nodes.clear();
 }  // ~Graph
 
+// -----------------------------------------------------------------------------
+/** Cleans up the graph. It is possible that this function is called even
+ *  if no instance exists (e.g. arena without navmesh). So it is not an
+ *  error if there is no instance. On a server without graphics the graph
+ *  is kept in a cache (up to the configured memory size), so that it can
+ *  be reused if the same track is played again. Only the graph is cached:
+ *  the collision meshes and the items are still created for each race, only
+ *  the bvh of the collision mesh is read from the bvh cache file.
+ */
+void Graph::destroy()
+{
+    if (!m_graph)
+        return;
+    const size_t budget =
+        (size_t)std::max(0, (int)UserConfigParams::m_graph_cache_size) *
+        1024 * 1024;
+    if (m_graph->m_cache_key.empty() || !ProfileWorld::isNoGraphics() ||
+        budget == 0)
+    {
+        delete m_graph;
+        m_graph = NULL;
+        return;
+    }
+    m_cached_graphs.push_front(m_graph);
+    m_graph = NULL;
+
+    // Remove the least recently used graphs which exceed the memory size
+    size_t used = 0;
+    std::list<Graph*>::iterator it = m_cached_graphs.begin();
+    while (it != m_cached_graphs.end())
+    {
+        used += (*it)->getMemoryUsage();
+        if (used <= budget)
+        {
+            it++;
+            continue;
+        }
+        Log::debug("Graph", "Removing graph '%s' from the cache.",
+                   (*it)->m_cache_key.c_str());
+        delete *it;
+        it = m_cached_graphs.erase(it);
+    }
+}   // destroy
+
+// -----------------------------------------------------------------------------
+/** Uses a graph from the cache as the graph of the current track.
+ *  \param key Identifies the track files and settings of the graph.
+ *  \return The graph, or NULL if no graph with this key is cached.
+ */
+Graph* Graph::reuseCachedGraph(const std::string &key)
+{
+    for (std::list<Graph*>::iterator it = m_cached_graphs.begin();
+         it != m_cached_graphs.end(); it++)
+    {
+        if ((*it)->m_cache_key != key)
+            continue;
+        Graph* graph = *it;
+        m_cached_graphs.erase(it);
+        setGraph(graph);
+        Log::info("Graph", "Reusing cached graph '%s'.", key.c_str());
+        return graph;
+    }
+    return NULL;
+}   // reuseCachedGraph
+
+// -----------------------------------------------------------------------------
+/** Deletes all cached graphs, e.g. because tracks were updated.
+ */
+void Graph::clearCache()
+{
+    for (Graph* graph : m_cached_graphs)
+        delete graph;
+    m_cached_graphs.clear();
+}   // clearCache
+
+// -----------------------------------------------------------------------------
+/** Returns an estimate of the memory used by this graph, which is used to
+ *  limit the size of the graph cache.
+ */
+size_t Graph::getMemoryUsage() const
+{
+    return sizeof(*this) +
+        m_all_nodes.size() * std::max(sizeof(DriveNode3D),
+                                      sizeof(ArenaNode3D)) +
+        m_node_bounds.capacity() * sizeof(NodeBounds) +
+        m_grid_cell_start.capacity() * sizeof(unsigned int) +
+        m_grid_nodes.capacity() * sizeof(int);
+}   // getMemoryUsage
+
 // -----------------------------------------------------------------------------
 /** Creates the debug mesh to display the graph on top of the track
  *  model. */
@@ -591,6 +687,98 @@ void Graph::createQuad(const Vec3 &p0, const Vec3 &p1, const Vec3 &p2,
 
 }   // createQuad
 
+//-----------------------------------------------------------------------------
+/** Builds the grid used to find the quads close to a point. This must be
+ *  called once all quads are created, and before findRoadSector or
+ *  findOutOfRoadSector are used.
+ */
+void Graph::buildSpatialIndex()
+{
+    const int num_nodes = (int)m_all_nodes.size();
+    m_node_bounds.resize(num_nodes);
+    m_grid_cell_start.clear();
+    m_grid_nodes.clear();
+    m_grid_size_x = m_grid_size_z = 0;
+    if (num_nodes == 0)
+        return;
+
+    float min_x = std::numeric_limits<float>::max();
+    float min_z = std::numeric_limits<float>::max();
+    float max_x = -std::numeric_limits<float>::max();
+    float max_z = -std::numeric_limits<float>::max();
+    for (int i = 0; i < num_nodes; i++)
+    {
+        const Quad* q = m_all_nodes[i];
+        NodeBounds& b = m_node_bounds[i];
+        b.m_min_x = b.m_min_z = std::numeric_limits<float>::max();
+        b.m_max_x = b.m_max_z = -std::numeric_limits<float>::max();
+        for (int j = 0; j < 4; j++)
+        {
+            // 3d quads test points inside a box which extends along the
+            // normal of the quad (see BoundingBox3D)
+            Vec3 points[3] = { (*q)[j], (*q)[j], (*q)[j] };
+            if (q->is3DQuad())
+            {
+                points[1] += 5.0f * q->getNormal();
+                points[2] -= 1.0f * q->getNormal();
+            }
+            for (const Vec3& p : points)
+            {
+                b.m_min_x = std::min(b.m_min_x, p.getX());
+                b.m_min_z = std::min(b.m_min_z, p.getZ());
+                b.m_max_x = std::max(b.m_max_x, p.getX());
+                b.m_max_z = std::max(b.m_max_z, p.getZ());
+            }
+        }
+        min_x = std::min(min_x, b.m_min_x);
+        min_z = std::min(min_z, b.m_min_z);
+        max_x = std::max(max_x, b.m_max_x);
+        max_z = std::max(max_z, b.m_max_z);
+    }
+
+    // Use about one cell per quad
+    const float dx = std::max(max_x - min_x, 1.0f);
+    const float dz = std::max(max_z - min_z, 1.0f);
+    m_grid_cell_size = std::max(sqrtf(dx * dz / num_nodes), 1.0f);
+    // Limit the number of cells for very long and narrow tracks
+    m_grid_cell_size = std::max(m_grid_cell_size, std::max(dx, dz) / 1024.0f);
+    m_grid_min_x = min_x;
+    m_grid_min_z = min_z;
+    m_grid_size_x = (int)(dx / m_grid_cell_size) + 1;
+    m_grid_size_z = (int)(dz / m_grid_cell_size) + 1;
+
+    // First count the quads in each cell, then fill them in
+    m_grid_cell_start.resize(m_grid_size_x * m_grid_size_z + 1, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        std::vector<unsigned int> offset;
+        if (pass == 1)
+        {
+            for (unsigned int i = 1; i < m_grid_cell_start.size(); i++)
+                m_grid_cell_start[i] += m_grid_cell_start[i - 1];
+            m_grid_nodes.resize(m_grid_cell_start.back());
+            offset.assign(m_grid_cell_start.begin(),
+                          m_grid_cell_start.end() - 1);
+        }
+        for (int i = 0; i < num_nodes; i++)
+        {
+            const NodeBounds& b = m_node_bounds[i];
+            for (int z = getGridZ(b.m_min_z); z <= getGridZ(b.m_max_z); z++)
+            {
+                for (int x = getGridX(b.m_min_x); x <= getGridX(b.m_max_x);
+                     x++)
+                {
+                    const int cell = z * m_grid_size_x + x;
+                    if (pass == 0)
+                        m_grid_cell_start[cell + 1]++;
+                    else
+                        m_grid_nodes[offset[cell]++] = i;
+                }
+            }
+        }
+    }
+}   // buildSpatialIndex
+
 //-----------------------------------------------------------------------------
 /** findRoadSector returns in which sector on the road the position
  *  xyz is. If xyz is not on top of the road, it sets UNKNOWN_SECTOR as sector.
@@ -615,12 +803,8 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
         return;
     }   // if still on same quad
 
-    // Now we search through all quads, starting with
-    // the current one
-    int indx       = *sector;
-
-    // If a current sector is given, and max_lookahead is specify, only test
-    // the next max_lookahead quads instead of testing the whole graph.
+    // If a list of sectors is given, only test those sectors in the given
+    // order instead of testing the whole graph.
     // This is necessary for the AI: if the track contains a loop, e.g.:
     // -A--+---B---+----F--------
     //     E       C
@@ -628,27 +812,125 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
     // and the track is supposed to be driven: ABCDEBF, the AI might find
     // the quad on F, and then keep on going straight ahead instead of
     // using the loop at all.
-    unsigned int max_count  = (*sector!=UNKNOWN_SECTOR && all_sectors!=NULL)
-                            ? (unsigned int)all_sectors->size()
-                            : (unsigned int)m_all_nodes.size();
-    *sector = UNKNOWN_SECTOR;
-    for(unsigned int i=0; i<max_count; i++)
+    if (all_sectors)
     {
-        if(all_sectors)
-            indx = (*all_sectors)[i];
-        else
-            indx = indx<(int)m_all_nodes.size()-1 ? indx +1 : 0;
-        const Quad* q = getQuad(indx);
-        if (q->pointInside(xyz, ignore_vertical))
+        *sector = UNKNOWN_SECTOR;
+        for (int indx : *all_sectors)
         {
-            *sector  = indx;
-            return;
+            if (insideNodeBounds(indx, xyz) &&
+                getQuad(indx)->pointInside(xyz, ignore_vertical))
+            {
+                *sector = indx;
+                return;
+            }
         }
-    }   // for i<m_all_nodes.size()
+        return;
+    }
 
-    return;
+    // Otherwise only test the quads in the grid cell of xyz. If the point
+    // is inside of more than one quad (e.g. a shortcut overlapping the
+    // main driveline), use the first one after the current sector.
+    const int num_nodes = (int)m_all_nodes.size();
+    const int start = *sector + 1;
+    int min_order = num_nodes;
+    *sector = UNKNOWN_SECTOR;
+    if (m_grid_cell_start.empty())
+        return;
+    const int cell = getGridZ(xyz.getZ()) * m_grid_size_x +
+                     getGridX(xyz.getX());
+    for (unsigned int i = m_grid_cell_start[cell];
+         i < m_grid_cell_start[cell + 1]; i++)
+    {
+        const int indx = m_grid_nodes[i];
+        const int order = (indx - start + num_nodes) % num_nodes;
+        if (order < min_order && insideNodeBounds(indx, xyz) &&
+            getQuad(indx)->pointInside(xyz, ignore_vertical))
+        {
+            *sector = indx;
+            min_order = order;
+        }
+    }
 }   // findRoadSector
 
+//-----------------------------------------------------------------------------
+/** Finds all quads which might contain a point that is less than radius
+ *  away from xyz. Only the x/z bounds of the quads are tested, so the result
+ *  can contain some quads which are further away.
+ *  \param xyz The center of the area to search.
+ *  \param radius Radius of the area to search.
+ *  \param nodes On return contains the sorted indices of the quads found.
+ */
+void Graph::findNodesInRadius(const Vec3& xyz, float radius,
+                              std::vector<int> *nodes) const
+{
+    nodes->clear();
+    if (m_grid_cell_start.empty())
+        return;
+    const float radius_2 = radius * radius;
+    for (int z = getGridZ(xyz.getZ() - radius);
+         z <= getGridZ(xyz.getZ() + radius); z++)
+    {
+        for (int x = getGridX(xyz.getX() - radius);
+             x <= getGridX(xyz.getX() + radius); x++)
+        {
+            const int cell = z * m_grid_size_x + x;
+            for (unsigned int i = m_grid_cell_start[cell];
+                 i < m_grid_cell_start[cell + 1]; i++)
+            {
+                const int indx = m_grid_nodes[i];
+                if (getDistance2FromNodeBounds(indx, xyz) <= radius_2)
+                    nodes->push_back(indx);
+            }
+        }
+    }
+    // A quad can overlap more than one cell
+    std::sort(nodes->begin(), nodes->end());
+    nodes->erase(std::unique(nodes->begin(), nodes->end()), nodes->end());
+}   // findNodesInRadius
+
+//-----------------------------------------------------------------------------
+/** Tests if a node is closer to xyz than the closest node found so far,
+ *  see findOutOfRoadSector.
+ *  \param xyz The point to find the closest node for.
+ *  \param node The node to test.
+ *  \param phase 0 if the height of the node is tested, 1 otherwise.
+ *  \param ignore_vertical If the height should be ignored in all phases.
+ *  \param min_dist_2 The squared distance to the closest node so far, will
+ *         be updated.
+ *  \param min_sector The closest node so far, will be updated.
+ *  \return True if this node is the closest node found so far.
+ */
+bool Graph::testOutOfRoadSector(const Vec3& xyz, int node, int phase,
+                                bool ignore_vertical, float *min_dist_2,
+                                int *min_sector) const
+{
+    const Quad* q = getQuad(node);
+    if (q->isIgnored() ||
+        getDistance2FromNodeBounds(node, xyz) >= *min_dist_2)
+        return false;
+
+    // A first simple test uses the 2d distance to the center of the
+    // quad.
+    float dist_2 = q->getDistance2FromPoint(xyz);
+    if (dist_2 >= *min_dist_2)
+        return false;
+
+    float dist = xyz.getY() - q->getMinHeight();
+    // While negative distances are unlikely, we allow some small
+    // negative numbers in case that the kart is partly in the
+    // track. Only do the height test in phase==0, in phase==1
+    // accept any point, independent of height, or this node is 3d
+    // which already takes height into account
+    if (phase == 1 || (dist < 5.0f && dist>-1.0f) ||
+        q->is3DQuad() || ignore_vertical)
+    {
+        *min_dist_2 = dist_2;
+        *min_sector = node;
+        return true;
+    }
+    return false;
+}   // testOutOfRoadSector
+
 //-----------------------------------------------------------------------------
 /** findOutOfRoadSector finds the sector where XYZ is, but as it name
     implies, it is more accurate for the outside of the track than the
@@ -660,13 +942,9 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
     right and left drivelines, and the number of that segment will be
     the sector.
 
-    The SIDE argument is used to speed up the function only; if we know
-    that XYZ is on the left or right side of the track, we know that
-    the closest driveline must be the one that matches that condition.
-    In reality, the side used in STK is the one from the previous frame,
-    but in order to move from one side to another a point would go
-    through the middle, that is handled by findRoadSector() which doesn't
-    has speed ups based on the side.
+    The closest quad is searched in the grid cells around XYZ, in rings of
+    increasing size, until no quad in a further ring can be closer than the
+    closest quad found so far.
 
     NOTE: This method of finding the sector outside of the road is *not*
     perfect: if two line segments have a similar altitude (but enough to
@@ -677,34 +955,10 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
     until the next higher overlapping line segment, and find the closest
     one to XYZ.
  */
-int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
+int Graph::findOutOfRoadSector(const Vec3& xyz,
                                std::vector<int> *all_sectors,
                                bool ignore_vertical) const
 {
-    int count = (all_sectors!=NULL) ? (int)all_sectors->size() : getNumNodes();
-    int current_sector = 0;
-    if(curr_sector != UNKNOWN_SECTOR && !all_sectors)
-    {
-        // We have to test all quads here: reason is that on track with
-        // shortcuts the n quads of the main drivelines is followed by
-        // the quads of the shortcuts. So after quad n-1 (the last one
-        // before the lap counting line) quad n will not be 0 (the first
-        // quad after the lap counting line), but one of the quads on a
-        // shortcut. If we only tested a limited number of quads to
-        // improve the performance the crossing of a lap might not be
-        // detected (because quad 0 is not tested, only quads on the
-        // shortcuts are tested). If this should become a performance
-        // bottleneck, we need to set up a graph of 'next' quads for each
-        // quad (similar to what the AI does), and only test the quads
-        // in this graph.
-        const int LIMIT = getNumNodes();
-        count           = LIMIT;
-        // Start 10 quads before the current quad, so the quads closest
-        // to the current position are tested first.
-        current_sector  = curr_sector -10;
-        if(current_sector<0) current_sector += getNumNodes();
-    }
-
     int   min_sector = UNKNOWN_SECTOR;
     float min_dist_2 = 999999.0f*999999.0f;
 
@@ -715,41 +969,73 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
     // it always comes back with some kind of quad.
     for(int phase=0; phase<2; phase++)
     {
-        for(int j=0; j<count; j++)
+        if (all_sectors)
         {
-            int next_sector;
-            if(all_sectors)
-                next_sector = (*all_sectors)[j];
-            else
-                next_sector  = current_sector+1 == (int)getNumNodes()
-                ? 0
-                : current_sector+1;
-
-            const Quad* q = getQuad(next_sector);
-            if (!q->isIgnored())
+            for (int node : *all_sectors)
             {
-                // A first simple test uses the 2d distance to the center of the
-                // quad.
-                float dist_2 =
-                    m_all_nodes[next_sector]->getDistance2FromPoint(xyz);
-                if (dist_2 < min_dist_2)
+                testOutOfRoadSector(xyz, node, phase, ignore_vertical,
+                    &min_dist_2, &min_sector);
+            }
+        }
+        else if (!m_grid_cell_start.empty())
+        {
+            const int cx = getGridX(xyz.getX());
+            const int cz = getGridZ(xyz.getZ());
+            const int max_ring = std::max(m_grid_size_x, m_grid_size_z);
+            for (int ring = 0; ring <= max_ring; ring++)
+            {
+                for (int z = std::max(cz - ring, 0);
+                     z <= std::min(cz + ring, m_grid_size_z - 1); z++)
                 {
-                    float dist = xyz.getY() - q->getMinHeight();
-                    // While negative distances are unlikely, we allow some small
-                    // negative numbers in case that the kart is partly in the
-                    // track. Only do the height test in phase==0, in phase==1
-                    // accept any point, independent of height, or this node is 3d
-                    // which already takes height into account
-                    if (phase == 1 || (dist < 5.0f && dist>-1.0f) ||
-                        q->is3DQuad() || ignore_vertical)
+                    for (int x = std::max(cx - ring, 0);
+                         x <= std::min(cx + ring, m_grid_size_x - 1); x++)
                     {
-                        min_dist_2 = dist_2;
-                        min_sector = next_sector;
+                        // Only the border cells of this ring are new
+                        if (z != cz - ring && z != cz + ring &&
+                            x != cx - ring && x != cx + ring)
+                        {
+                            x = cx + ring - 1;
+                            continue;
+                        }
+                        const int cell = z * m_grid_size_x + x;
+                        for (unsigned int i = m_grid_cell_start[cell];
+                             i < m_grid_cell_start[cell + 1]; i++)
+                        {
+                            testOutOfRoadSector(xyz, m_grid_nodes[i], phase,
+                                ignore_vertical, &min_dist_2, &min_sector);
+                        }
                     }
                 }
-            }
-            current_sector = next_sector;
-        }   // for j
+
+                // All quads not tested so far are outside of the cells
+                // tested, so they can't be closer than the distance to the
+                // border of these cells.
+                float border = std::numeric_limits<float>::max();
+                if (cx - ring > 0)
+                {
+                    border = std::min(border, xyz.getX() - m_grid_min_x -
+                        (cx - ring) * m_grid_cell_size);
+                }
+                if (cx + ring < m_grid_size_x - 1)
+                {
+                    border = std::min(border, m_grid_min_x +
+                        (cx + ring + 1) * m_grid_cell_size - xyz.getX());
+                }
+                if (cz - ring > 0)
+                {
+                    border = std::min(border, xyz.getZ() - m_grid_min_z -
+                        (cz - ring) * m_grid_cell_size);
+                }
+                if (cz + ring < m_grid_size_z - 1)
+                {
+                    border = std::min(border, m_grid_min_z +
+                        (cz + ring + 1) * m_grid_cell_size - xyz.getZ());
+                }
+                if (border == std::numeric_limits<float>::max() ||
+                    (border > 0.0f && border * border >= min_dist_2))
+                    break;
+            }   // for ring
+        }
         // If any sector was found after a phase, return it.
         if(min_sector!=UNKNOWN_SECTOR)
             return min_sector;
@@ -764,11 +1050,11 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
 void Graph::loadBoundingBoxNodes()
 {
     m_bb_nodes[0] = findOutOfRoadSector(Vec3(m_bb_min.x(), 0, m_bb_min.z()),
-        -1/*curr_sector*/, NULL/*all_sectors*/, true/*ignore_vertical*/);
+        NULL/*all_sectors*/, true/*ignore_vertical*/);
     m_bb_nodes[1] = findOutOfRoadSector(Vec3(m_bb_min.x(), 0, m_bb_max.z()),
-        -1/*curr_sector*/, NULL/*all_sectors*/, true/*ignore_vertical*/);
+        NULL/*all_sectors*/, true/*ignore_vertical*/);
     m_bb_nodes[2] = findOutOfRoadSector(Vec3(m_bb_max.x(), 0, m_bb_min.z()),
-        -1/*curr_sector*/, NULL/*all_sectors*/, true/*ignore_vertical*/);
+        NULL/*all_sectors*/, true/*ignore_vertical*/);
     m_bb_nodes[3] = findOutOfRoadSector(Vec3(m_bb_max.x(), 0, m_bb_max.z()),
-        -1/*curr_sector*/, NULL/*all_sectors*/, true/*ignore_vertical*/);
+        NULL/*all_sectors*/, true/*ignore_vertical*/);
 }   // loadBoundingBoxNodes
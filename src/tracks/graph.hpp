@@ -24,6 +24,9 @@
 
 #include <dimension2d.h>
 
+#include <algorithm>
+#include <cmath>
+#include <list>
 #include <memory>
 #include <string>
 #include <vector>
@@ -54,6 +57,10 @@ class Graph : public NoCopy
 protected:
     static Graph* m_graph;
 
+    /** Graphs of recently played tracks, most recently used first. This is
+     *  the only track data kept between races, see destroy(). */
+    static std::list<Graph*> m_cached_graphs;
+
     std::vector<Quad*> m_all_nodes;
 
     // ------------------------------------------------------------------------
@@ -66,6 +73,8 @@ protected:
     // ------------------------------------------------------------------------
     /** Map 4 bounding box points to 4 closest graph nodes. */
     void loadBoundingBoxNodes();
+    // ------------------------------------------------------------------------
+    void buildSpatialIndex();
 
 private:
     /** The 2d bounding box, used for hashing. */
@@ -75,6 +84,32 @@ private:
     /** The 4 closest graph nodes to the bounding box. */
     int m_bb_nodes[4];
 
+    /** Identifies the track files and settings this graph was built from,
+     *  empty if the graph must not be cached. */
+    std::string m_cache_key;
+
+    /** Bounds of a quad in the x/z plane, used by the spatial index. */
+    struct NodeBounds
+    {
+        float m_min_x, m_min_z, m_max_x, m_max_z;
+    };
+
+    /** The x/z bounds of each quad, indexed like m_all_nodes. */
+    std::vector<NodeBounds> m_node_bounds;
+
+    /** A uniform grid in the x/z plane over all quads, used to speed up
+     *  findRoadSector and findOutOfRoadSector. The quads overlapping cell
+     *  i are m_grid_nodes[m_grid_cell_start[i]] till (excluding)
+     *  m_grid_nodes[m_grid_cell_start[i+1]]. */
+    std::vector<unsigned int> m_grid_cell_start;
+    std::vector<int> m_grid_nodes;
+
+    /** Minimum x/z coordinates and size of a grid cell. */
+    float m_grid_min_x, m_grid_min_z, m_grid_cell_size;
+
+    /** Number of grid cells in x and z direction. */
+    int m_grid_size_x, m_grid_size_z;
+
     /** The node of the graph mesh. */
     scene::ISceneNode *m_node;
 
@@ -103,6 +138,42 @@ private:
     // ------------------------------------------------------------------------
     void cleanupDebugMesh();
     // ------------------------------------------------------------------------
+    int getGridX(float x) const
+    {
+        int i = (int)floorf((x - m_grid_min_x) / m_grid_cell_size);
+        return i < 0 ? 0 : i >= m_grid_size_x ? m_grid_size_x - 1 : i;
+    }   // getGridX
+    // ------------------------------------------------------------------------
+    int getGridZ(float z) const
+    {
+        int i = (int)floorf((z - m_grid_min_z) / m_grid_cell_size);
+        return i < 0 ? 0 : i >= m_grid_size_z ? m_grid_size_z - 1 : i;
+    }   // getGridZ
+    // ------------------------------------------------------------------------
+    /** Returns true if the point is inside the x/z bounds of a quad. */
+    bool insideNodeBounds(int node, const Vec3& xyz) const
+    {
+        const NodeBounds& b = m_node_bounds[node];
+        return xyz.getX() >= b.m_min_x && xyz.getX() <= b.m_max_x &&
+               xyz.getZ() >= b.m_min_z && xyz.getZ() <= b.m_max_z;
+    }   // insideNodeBounds
+    // ------------------------------------------------------------------------
+    /** Returns the square of the x/z distance of a point to the bounds of a
+     *  quad, which is never more than getDistance2FromPoint of that quad. */
+    float getDistance2FromNodeBounds(int node, const Vec3& xyz) const
+    {
+        const NodeBounds& b = m_node_bounds[node];
+        float dx = std::max(0.0f, std::max(b.m_min_x - xyz.getX(),
+                                           xyz.getX() - b.m_max_x));
+        float dz = std::max(0.0f, std::max(b.m_min_z - xyz.getZ(),
+                                           xyz.getZ() - b.m_max_z));
+        return dx * dx + dz * dz;
+    }   // getDistance2FromNodeBounds
+    // ------------------------------------------------------------------------
+    bool testOutOfRoadSector(const Vec3& xyz, int node, int phase,
+                             bool ignore_vertical, float *min_dist_2,
+                             int *min_sector) const;
+    // ------------------------------------------------------------------------
     virtual bool hasLapLine() const = 0;
     // ------------------------------------------------------------------------
     virtual void differentNodeColor(int n, video::SColor* c) const = 0;
@@ -125,17 +196,16 @@ public:
         m_graph = graph;
     }   // setGraph
     // ------------------------------------------------------------------------
-    /** Cleans up the graph. It is possible that this function is called even
-     *  if no instance exists (e.g. arena without navmesh). So it is not an
-     *  error if there is no instance. */
-    static void destroy()
-    {
-        if (m_graph)
-        {
-            delete m_graph;
-            m_graph = NULL;
-        }
-    }   // destroy
+    static void destroy();
+    // ------------------------------------------------------------------------
+    static Graph* reuseCachedGraph(const std::string &key);
+    // ------------------------------------------------------------------------
+    static void clearCache();
+    // ------------------------------------------------------------------------
+    /** Sets the key to find this graph in the cache after the race. */
+    void setCacheKey(const std::string &key)             { m_cache_key = key; }
+    // ------------------------------------------------------------------------
+    virtual size_t getMemoryUsage() const;
     // ------------------------------------------------------------------------
     Graph();
     // ------------------------------------------------------------------------
@@ -163,10 +233,12 @@ public:
                         bool ignore_vertical = false) const;
     // ------------------------------------------------------------------------
     int findOutOfRoadSector(const Vec3& xyz,
-                            const int curr_sector = UNKNOWN_SECTOR,
                             std::vector<int> *all_sectors = NULL,
                             bool ignore_vertical = false) const;
     // ------------------------------------------------------------------------
+    void findNodesInRadius(const Vec3& xyz, float radius,
+                           std::vector<int> *nodes) const;
+    // ------------------------------------------------------------------------
     const Vec3& getBBMin() const                           { return m_bb_min; }
     // ------------------------------------------------------------------------
     const Vec3& getBBMax() const                           { return m_bb_max; }
@@ -0,0 +1,49 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "tracks/raycast_batch.hpp"
+
+#include "tracks/terrain_info.hpp"
+#include "utils/profiler.hpp"
+#include "utils/worker_pool.hpp"
+
+// ----------------------------------------------------------------------------
+/** Casts all rays added, and clears the batch. The raycasts only read the
+ *  track data, so they can be done in parallel.
+ *  \param pool The threads to use, or NULL to cast all rays in this thread.
+ */
+void RaycastBatch::run(WorkerPool* pool)
+{
+    if (m_terrain_infos.empty())
+        return;
+    PROFILER_PUSH_CPU_MARKER("RaycastBatch", 0x40, 0x40, 0x7F);
+    if (pool)
+    {
+        pool->run((unsigned)m_terrain_infos.size(), [this](unsigned i)
+            {
+                m_terrain_infos[i]->castBatchRay();
+            });
+    }
+    else
+    {
+        for (TerrainInfo* ti : m_terrain_infos)
+            ti->castBatchRay();
+    }
+    m_terrain_infos.clear();
+    PROFILER_POP_CPU_MARKER();
+}   // run
@@ -0,0 +1,55 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_RAYCAST_BATCH_HPP
+#define HEADER_RAYCAST_BATCH_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <vector>
+
+class TerrainInfo;
+class WorkerPool;
+
+/** \ingroup tracks
+ *  Collects the terrain raycasts of several objects (karts, flyables) for
+ *  one time step and does them all at once, distributed over the threads
+ *  of a worker pool. Each TerrainInfo keeps the result of its raycast, and
+ *  uses it in its next update() if that update casts the same ray. If not
+ *  (e.g. because the object was moved in between), update() does the
+ *  raycast again, so the results never differ from single raycasts.
+ */
+class RaycastBatch : public NoCopy
+{
+private:
+    /** All terrain infos which have a ray to cast. */
+    std::vector<TerrainInfo*> m_terrain_infos;
+
+public:
+    // ------------------------------------------------------------------------
+    /** Adds a terrain info whose ray was set with TerrainInfo::addToBatch. */
+    void add(TerrainInfo* ti)                  { m_terrain_infos.push_back(ti); }
+    // ------------------------------------------------------------------------
+    /** Returns the number of rays to cast. */
+    unsigned size() const          { return (unsigned)m_terrain_infos.size(); }
+    // ------------------------------------------------------------------------
+    void run(WorkerPool* pool);
+
+};   // class RaycastBatch
+
+#endif // HEADER_RAYCAST_BATCH_HPP
@@ -20,6 +20,7 @@
 
 #include "physics/triangle_mesh.hpp"
 #include "race/race_manager.hpp"
+#include "tracks/raycast_batch.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "tracks/track_object_manager.hpp"
@@ -33,6 +34,7 @@ TerrainInfo::TerrainInfo()
 {
     m_last_material = NULL;
     m_material      = NULL;
+    m_has_batch_ray = false;
 }   // TerrainInfo
 
 //-----------------------------------------------------------------------------
@@ -44,6 +46,7 @@ TerrainInfo::TerrainInfo(const Vec3 &pos)
     // initialise HoT
     m_last_material = NULL;
     m_material = NULL;
+    m_has_batch_ray = false;
     update(pos);
 }   // TerrainInfo
 
@@ -56,14 +59,7 @@ void TerrainInfo::update(const Vec3 &from)
     m_last_material = m_material;
     btVector3 to(from);
     to.setY(-10000.0f);
-
-    const TriangleMesh &tm = Track::getCurrentTrack()->getTriangleMesh();
-    tm.castRay(from, to, &m_hit_point, &m_material, &m_normal,
-               /*interpolate*/false);
-    // Now also raycast against all track objects (that are driveable).
-    Track::getCurrentTrack()->getTrackObjectManager()
-                     ->castRay(from, to, &m_hit_point, &m_material,
-                               &m_normal, /*interpolate*/false);
+    castRay(from, to, /*track_objects*/true, /*interpolate*/false);
 }   // update
 
 //-----------------------------------------------------------------------------
@@ -81,16 +77,7 @@ void TerrainInfo::update(const btMatrix3x3 &rotation, const Vec3 &from)
     // kart rotation, and adding the start point to it.
     btVector3 to(0, -10000.0f, 0);
     to = from + rotation*to;
-
-    const TriangleMesh &tm = Track::getCurrentTrack()->getTriangleMesh();
-    tm.castRay(from, to, &m_hit_point, &m_material, &m_normal,
-               /*interpolate*/true);
-    // Now also raycast against all track objects (that are driveable). If
-    // there should be a closer result (than the one against the main track 
-    // mesh), its data will be returned.
-    Track::getCurrentTrack()->getTrackObjectManager()
-                            ->castRay(from, to, &m_hit_point, &m_material,
-                                      &m_normal, /*interpolate*/true);
+    castRay(from, to, /*track_objects*/true, /*interpolate*/true);
 }   // update
 //-----------------------------------------------------------------------------
 /** Update the terrain information based on the latest position.
@@ -101,10 +88,98 @@ void TerrainInfo::update(const Vec3 &from, const Vec3 &towards)
     m_last_material = m_material;
     Vec3 direction = towards.normalized();
     btVector3 to = from + 10000.0f*direction;
+    castRay(from, to, /*track_objects*/false, /*interpolate*/false);
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Does a raycast and stores the result. If the same ray was already cast
+ *  by a RaycastBatch, its result is used instead.
+ *  \param from/to The from and to position for the raycast.
+ *  \param track_objects If the driveable track objects should be tested
+ *         in addition to the main track mesh.
+ *  \param interpolate If the normal should be interpolated.
+ */
+void TerrainInfo::castRay(const Vec3 &from, const Vec3 &to,
+                          bool track_objects, bool interpolate)
+{
+    if (m_has_batch_ray)
+    {
+        m_has_batch_ray = false;
+        const BatchRay &br = m_batch_ray;
+        if (br.m_from == from && br.m_to == to &&
+            br.m_track_objects == track_objects &&
+            br.m_interpolate == interpolate)
+        {
+            // Like a raycast, keep the old hit point if nothing was hit
+            if (br.m_hit)
+                m_hit_point = br.m_hit_point;
+            m_material  = br.m_material;
+            m_normal    = br.m_normal;
+            return;
+        }
+    }
 
     const TriangleMesh &tm = Track::getCurrentTrack()->getTriangleMesh();
-    tm.castRay(from, to, &m_hit_point, &m_material, &m_normal);
-}   // update
+    tm.castRay(from, to, &m_hit_point, &m_material, &m_normal, interpolate);
+    if (!track_objects)
+        return;
+    // Now also raycast against all track objects (that are driveable). If
+    // there should be a closer result (than the one against the main track 
+    // mesh), its data will be returned.
+    Track::getCurrentTrack()->getTrackObjectManager()
+                            ->castRay(from, to, &m_hit_point, &m_material,
+                                      &m_normal, interpolate);
+}   // castRay
+
+//-----------------------------------------------------------------------------
+/** Adds the ray which update(rotation, from) will cast to a batch.
+ */
+void TerrainInfo::addToBatch(RaycastBatch *batch, const btMatrix3x3 &rotation,
+                             const Vec3 &from)
+{
+    btVector3 to(0, -10000.0f, 0);
+    m_batch_ray.m_from = from;
+    m_batch_ray.m_to = from + rotation*to;
+    m_batch_ray.m_track_objects = true;
+    m_batch_ray.m_interpolate = true;
+    m_has_batch_ray = true;
+    batch->add(this);
+}   // addToBatch
+
+//-----------------------------------------------------------------------------
+/** Adds the ray which update(from, towards) will cast to a batch.
+ */
+void TerrainInfo::addToBatch(RaycastBatch *batch, const Vec3 &from,
+                             const Vec3 &towards)
+{
+    Vec3 direction = towards.normalized();
+    m_batch_ray.m_from = from;
+    m_batch_ray.m_to = from + 10000.0f*direction;
+    m_batch_ray.m_track_objects = false;
+    m_batch_ray.m_interpolate = false;
+    m_has_batch_ray = true;
+    batch->add(this);
+}   // addToBatch
+
+//-----------------------------------------------------------------------------
+/** Casts the ray added to a batch. Called by RaycastBatch, possibly in
+ *  another thread, so only the batch data is changed.
+ */
+void TerrainInfo::castBatchRay()
+{
+    BatchRay &br = m_batch_ray;
+    br.m_material = NULL;
+    const TriangleMesh &tm = Track::getCurrentTrack()->getTriangleMesh();
+    br.m_hit = tm.castRay(br.m_from, br.m_to, &br.m_hit_point, &br.m_material,
+                          &br.m_normal, br.m_interpolate);
+    if (br.m_track_objects &&
+        Track::getCurrentTrack()->getTrackObjectManager()
+            ->castRay(br.m_from, br.m_to, &br.m_hit_point, &br.m_material,
+                      &br.m_normal, br.m_interpolate))
+    {
+        br.m_hit = true;
+    }
+}   // castBatchRay
 
 // -----------------------------------------------------------------------------
 /** Does a raycast upwards from the given position
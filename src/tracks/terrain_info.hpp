@@ -23,6 +23,7 @@
 
 class btTransform;
 class Material;
+class RaycastBatch;
 
 /** This class stores information about the triangle that's under an object, i.e.:
  *  the normal, a pointer to the material, and the height above th
@@ -43,6 +44,22 @@ private:
     /** DEBUG only: origin of raycast. */
     Vec3 m_origin_ray;
 
+    /** A raycast which was done in advance by a RaycastBatch. */
+    struct BatchRay
+    {
+        Vec3            m_from, m_to;
+        Vec3            m_hit_point, m_normal;
+        const Material *m_material;
+        bool            m_track_objects, m_interpolate, m_hit;
+    };
+    BatchRay m_batch_ray;
+
+    /** True if m_batch_ray was added to a batch and not used yet. */
+    bool m_has_batch_ray;
+
+    void castRay(const Vec3 &from, const Vec3 &to, bool track_objects,
+                 bool interpolate);
+
 public:
              TerrainInfo();
              TerrainInfo(const Vec3 &pos);
@@ -53,6 +70,11 @@ public:
     virtual void update(const btMatrix3x3 &rotation, const Vec3 &from);
     virtual void update(const Vec3 &from);
     virtual void update(const Vec3 &from, const Vec3 &towards);
+    void     addToBatch(RaycastBatch *batch, const btMatrix3x3 &rotation,
+                        const Vec3 &from);
+    void     addToBatch(RaycastBatch *batch, const Vec3 &from,
+                        const Vec3 &towards);
+    void     castBatchRay();
 
     // ------------------------------------------------------------------------
     /** Simple wrapper with no offset. */
@@ -60,6 +60,7 @@
 #include "modes/linear_world.hpp"
 #include "modes/easter_egg_hunt.hpp"
 #include "modes/profile_world.hpp"
+#include "network/bit_network_string.hpp"
 #include "network/network_config.hpp"
 #include "network/protocols/server_lobby.hpp"
 #include "physics/physical_object.hpp"
@@ -749,8 +750,19 @@ void Track::loadArenaGraph(const XMLNode &node)
         }
     }
 
-    ArenaGraph* graph = new ArenaGraph(m_root+"navmesh.xml", &node);
-    Graph::setGraph(graph);
+    // The navmesh only depends on the track files, but the goal nodes are
+    // only loaded in soccer mode, so a graph of an earlier race on this
+    // track can only be used again if both races are soccer or not
+    const bool soccer =
+        race_manager->getMinorMode() == RaceManager::MINOR_MODE_SOCCER;
+    const std::string key = m_root + "navmesh.xml" +
+        (soccer ? "|soccer" : "");
+    if (!Graph::reuseCachedGraph(key))
+    {
+        ArenaGraph* graph = new ArenaGraph(m_root+"navmesh.xml", &node);
+        Graph::setGraph(graph);
+        graph->setCacheKey(key);
+    }
 
     if(Graph::get()->getNumNodes()==0)
     {
@@ -793,12 +805,18 @@ btQuaternion Track::getArenaStartRotation(const Vec3& xyz, float heading)
  */
 void Track::loadDriveGraph(unsigned int mode_id, const bool reverse)
 {
-    new DriveGraph(m_root+m_all_modes[mode_id].m_quad_name,
-        m_root+m_all_modes[mode_id].m_graph_name, reverse);
+    const std::string key = m_root + m_all_modes[mode_id].m_quad_name + "|" +
+        m_all_modes[mode_id].m_graph_name + (reverse ? "|reverse" : "");
+    if (!Graph::reuseCachedGraph(key))
+    {
+        new DriveGraph(m_root+m_all_modes[mode_id].m_quad_name,
+            m_root+m_all_modes[mode_id].m_graph_name, reverse);
 
-    // setGraph is done in DriveGraph constructor
-    assert(DriveGraph::get());
-    DriveGraph::get()->setupPaths();
+        // setGraph is done in DriveGraph constructor
+        assert(DriveGraph::get());
+        DriveGraph::get()->setupPaths();
+        DriveGraph::get()->setCacheKey(key);
+    }
 #ifdef DEBUG
     for(unsigned int i=0; i<DriveGraph::get()->getNumNodes(); i++)
     {
@@ -909,7 +927,12 @@ void Track::createPhysicsModel(unsigned int main_track_count)
         uploadNodeVertexBuffer(m_all_nodes[i]);
     }
     main_loop->renderGUI(5580);
-    m_track_mesh->createPhysicalBody(m_friction);
+    // Building the bvh of the whole track is expensive, so it is cached
+    const std::string bvh_cache_file =
+        file_manager->getCachedDataDir() + "bvh-" + m_ident + ".bin";
+    m_track_mesh->createPhysicalBody(m_friction,
+                                     (btCollisionObject::CollisionFlags)0,
+                                     bvh_cache_file.c_str());
     main_loop->renderGUI(5585);
     m_gfx_effect_mesh->createCollisionShape();
     main_loop->renderGUI(5590);
@@ -1278,6 +1301,10 @@ bool Track::loadMainTrack(const XMLNode &root)
     // will handle items that are out of the AABB
     m_aabb_max.setY(m_aabb_max.getY()+30.0f);
     Physics::getInstance()->init(m_aabb_min, m_aabb_max);
+    // Positions in bit packed game states are relative to the bounding box,
+    // a network client replaces it with the range sent by the server
+    BitNetworkWriter::setPositionRange(m_aabb_min, m_aabb_max,
+        stk_config->m_network_position_resolution);
 
     ModelDefinitionLoader lodLoader(this);
 
@@ -2244,6 +2271,11 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     {
         DriveGraph::get()->computeChecklineRequirements();
     }
+    else if (DriveGraph::get())
+    {
+        // Remove the requirements of an earlier race if the graph is cached
+        DriveGraph::get()->clearChecklineRequirements();
+    }
     main_loop->renderGUI(6000);
 
     EasterEggHunt *easter_world = dynamic_cast<EasterEggHunt*>(world);
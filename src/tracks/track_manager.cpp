@@ -21,6 +21,7 @@
 #include "config/stk_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "io/file_manager.hpp"
+#include "tracks/graph.hpp"
 #include "tracks/track.hpp"
 
 #include <algorithm>
@@ -44,6 +45,7 @@ TrackManager::~TrackManager()
 {
     for(Tracks::iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
         delete *i;
+    Graph::clearCache();
 }   // ~TrackManager
 
 //-----------------------------------------------------------------------------
@@ -142,6 +144,8 @@ std::vector<std::string> TrackManager::getAllTrackIdentifiers()
  */
 void TrackManager::loadTrackList()
 {
+    // Tracks might have been updated, so the cached graphs can be outdated
+    Graph::clearCache();
     m_all_track_dirs.clear();
     m_track_group_names.clear();
     m_track_groups.clear();
@@ -168,12 +172,26 @@ void TrackManager::loadTrackList()
         // ------------------------------------------------
         std::set<std::string> dirs;
         file_manager->listFiles(dirs, dir);
+
+        // Read the xml files of all tracks in parallel, or from the manifest
+        // of this directory if they didn't change
+        std::vector<std::string> xml_files;
+        for (const std::string& subdir : dirs)
+        {
+            if (subdir == "." || subdir == "..")
+                continue;
+            xml_files.push_back(dir + subdir + "/track.xml");
+            xml_files.push_back(dir + subdir + "/easter_eggs.xml");
+        }
+        file_manager->preloadXMLTrees(xml_files, "tracks:" + dir);
+
         for(std::set<std::string>::iterator subdir = dirs.begin();
             subdir != dirs.end(); subdir++)
         {
             if(*subdir=="." || *subdir=="..") continue;
             loadTrack(dir+*subdir+"/");
         }   // for dir in dirs
+        file_manager->clearPreloadedXMLTrees();
     }   // for i <m_track_search_path.size()
 }  // loadTrackList
 
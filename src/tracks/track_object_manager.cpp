@@ -100,6 +100,7 @@ void TrackObjectManager::init()
             moveable_objects++;
         }
     }
+    updateDriveableTree();
 }   // init
 
 // ----------------------------------------------------------------------------
@@ -112,6 +113,7 @@ void TrackObjectManager::reset()
         curr->reset();
         curr->resetEnabled();
     }
+    updateDriveableTree();
 }   // reset
 
 // ----------------------------------------------------------------------------
@@ -193,6 +195,7 @@ void TrackObjectManager::update(float dt)
     {
         curr->update(dt);
     }
+    updateDriveableTree();
 }   // update
 
 // ----------------------------------------------------------------------------
@@ -203,16 +206,45 @@ void TrackObjectManager::resetAfterRewind()
     {
         curr->resetAfterRewind();
     }
+    updateDriveableTree();
 }   // resetAfterRewind
 
+// ----------------------------------------------------------------------------
+/** Updates the bounding boxes of all driveable objects in the AABB tree,
+ *  since driveable objects can be animated or moved by physics. Objects
+ *  are only moved in the tree if they left their (slightly enlarged) box.
+ */
+void TrackObjectManager::updateDriveableTree()
+{
+    for (const TrackObject* curr : m_driveable_objects)
+    {
+        const PhysicalObject* po = curr->getPhysicalObject();
+        if (!po || !po->getBody())
+            continue;
+        btVector3 min, max;
+        po->getBody()->getCollisionShape()->getAabb(
+            po->getBody()->getWorldTransform(), min, max);
+        btDbvtVolume volume = btDbvtVolume::FromMM(min, max);
+        auto it = m_driveable_leaves.find(curr);
+        if (it == m_driveable_leaves.end())
+        {
+            m_driveable_leaves[curr] =
+                m_driveable_tree.insert(volume, (void*)curr);
+        }
+        else
+            m_driveable_tree.update(it->second, volume, 0.5f);
+    }
+}   // updateDriveableTree
+
 // ----------------------------------------------------------------------------
 /** Does a raycast against all driveable objects. This way part of the track
  *  can be a physical object, and can e.g. be animated. A separate list of all
  *  driveable objects is maintained (in one case there were over 2000 bodies,
- *  but only one is driveable). The result of the raycast against the track
- *  mesh are the input parameter. It is then tested if the raycast against 
- *  a track object gives a 'closer' result. If so, the parameters hit_point,
- *  normal, and material will be updated.
+ *  but only one is driveable), and only objects whose bounding box in the
+ *  AABB tree of driveable objects is hit by the ray are tested. The result
+ *  of the raycast against the track mesh are the input parameter. It is then
+ *  tested if the raycast against a track object gives a 'closer' result. If
+ *  so, the parameters hit_point, normal, and material will be updated.
  *  \param from/to The from and to position for the raycast.
  *  \param xyz The position in world where the ray hit.
  *  \param material The material of the mesh that was hit.
@@ -231,40 +263,66 @@ bool TrackObjectManager::castRay(const btVector3 &from,
                                  btVector3 *normal,
                                  bool interpolate_normal) const
 {
-    bool result = false;
-    float distance = 9999.9f;
+    /** Raycasts against each object whose box is hit by the ray, and
+     *  keeps the closest hit. */
+    struct RayCallback : public btDbvt::ICollide
+    {
+        const btVector3 &m_from, &m_to;
+        btVector3 *m_hit_point, *m_normal;
+        const Material **m_material;
+        bool m_interpolate_normal;
+        float m_distance;
+        bool m_result;
+        // --------------------------------------------------------------------
+        RayCallback(const btVector3 &from, const btVector3 &to)
+            : m_from(from), m_to(to) {}
+        // --------------------------------------------------------------------
+        virtual void Process(const btDbvtNode* leaf)
+        {
+            const TrackObject* curr = (const TrackObject*)leaf->data;
+            if (!curr->isEnabled())
+            {
+                // For example jumping pad in cocoa temple
+                return;
+            }
+            btVector3 new_hit_point;
+            const Material *new_material;
+            btVector3 new_normal;
+            if(curr->castRay(m_from, m_to, &new_hit_point, &new_material,
+                             &new_normal, m_interpolate_normal))
+            {
+                float new_distance = new_hit_point.distance(m_from);
+                // If the new hit is closer than the current hit, save
+                // the data.
+                if (new_distance < m_distance)
+                {
+                    *m_material  = new_material;
+                    *m_hit_point = new_hit_point;
+                    *m_normal    = new_normal;
+                    m_distance   = new_distance;
+                    m_result = true;
+                }   // if new_distance < distance
+            }   // if hit
+        }   // Process
+    };   // RayCallback
+
+    RayCallback callback(from, to);
+    callback.m_hit_point = hit_point;
+    callback.m_normal = normal;
+    callback.m_material = material;
+    callback.m_interpolate_normal = interpolate_normal;
+    callback.m_result = false;
+    callback.m_distance = 9999.9f;
     // If there was a hit already, compute the current distance
     if(*material)
     {
-        distance = hit_point->distance(from);
+        callback.m_distance = hit_point->distance(from);
     }
-    for (const TrackObject* curr : m_driveable_objects)
+    if (!m_driveable_tree.empty())
     {
-        if (!curr->isEnabled())
-        {
-            // For example jumping pad in cocoa temple
-            continue;
-        }
-        btVector3 new_hit_point;
-        const Material *new_material;
-        btVector3 new_normal;
-        if(curr->castRay(from, to, &new_hit_point, &new_material, &new_normal,
-                      interpolate_normal))
-        {
-            float new_distance = new_hit_point.distance(from);
-            // If the new hit is closer than the current hit, save
-            // the data.
-            if (new_distance < distance)
-            {
-                *material  = new_material;
-                *hit_point = new_hit_point;
-                *normal    = new_normal;
-                distance   = new_distance;
-                result = true;
-            }   // if new_distance < distance
-        }   // if hit
-    }   // for all track objects.
-    return result;
+        btDbvt::rayTest(m_driveable_tree.m_root, from, to, callback);
+    }
+    return callback.m_result;
 }   // castRay
 
 // ----------------------------------------------------------------------------
@@ -280,6 +338,24 @@ void TrackObjectManager::insertObject(TrackObject* object)
  */
 void TrackObjectManager::removeObject(TrackObject* obj)
 {
+    if (obj->isDriveable())
+        removeDriveableObject(obj);
     m_all_objects.remove(obj);
     delete obj;
 }   // removeObject
+
+// ----------------------------------------------------------------------------
+/** Removes an object from the list of driveable objects, e.g. after it was
+ *  joined to the main track mesh.
+ *  \param obj The object to remove.
+ */
+void TrackObjectManager::removeDriveableObject(TrackObject* obj)
+{
+    m_driveable_objects.remove(obj);
+    auto it = m_driveable_leaves.find(obj);
+    if (it != m_driveable_leaves.end())
+    {
+        m_driveable_tree.remove(it->second);
+        m_driveable_leaves.erase(it);
+    }
+}   // removeDriveableObject
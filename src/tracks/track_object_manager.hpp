@@ -23,6 +23,8 @@
 #include "tracks/track_object.hpp"
 #include "utils/ptr_vector.hpp"
 
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+
 class Track;
 class Vec3;
 class XMLNode;
@@ -51,6 +53,15 @@ protected:
     /** A second list which holds all objects that karts can drive on. */
     PtrVector<TrackObject, REF> m_driveable_objects;
 
+    /** A dynamic AABB tree of all driveable objects, used to only raycast
+     *  against objects close to the ray. */
+    btDbvt m_driveable_tree;
+
+    /** The leaf of each driveable object in m_driveable_tree. */
+    std::map<const TrackObject*, btDbvtNode*> m_driveable_leaves;
+
+    void updateDriveableTree();
+
 public:
          TrackObjectManager();
         ~TrackObjectManager();
@@ -72,7 +83,7 @@ public:
     void insertObject(TrackObject* object);
 
     void removeObject(TrackObject* who);
-    void removeDriveableObject(TrackObject* obj) { m_driveable_objects.remove(obj); }
+    void removeDriveableObject(TrackObject* obj);
     TrackObject* getTrackObject(const std::string& libraryInstance, const std::string& name);
 
           PtrVector<TrackObject>& getObjects()       { return m_all_objects; }
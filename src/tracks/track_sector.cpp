@@ -73,7 +73,7 @@ void TrackSector::update(const Vec3 &xyz, bool ignore_vertical)
     if (m_current_graph_node == Graph::UNKNOWN_SECTOR)
     {
         m_current_graph_node = Graph::get()->findOutOfRoadSector(xyz,
-            prev_sector, test_nodes, ignore_vertical);
+            test_nodes, ignore_vertical);
     }
 
     // Keep the last valid graph node for arena mode
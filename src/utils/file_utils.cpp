@@ -19,10 +19,17 @@
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 
+#include <atomic>
 #include <stdio.h>
 #include <string>
 #include <sys/stat.h>
 
+#if defined(WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
 // ----------------------------------------------------------------------------
 #if defined(WIN32)
 #include <windows.h>
@@ -166,3 +173,149 @@ int FileUtils::renameU8Path(const std::string& u8_path_old,
     return rename(u8_path_old.c_str(), u8_path_new.c_str());
 #endif
 }   // renameU8Path
+
+// ----------------------------------------------------------------------------
+/** Renames a file, replacing the new path if it exists already, which
+ *  rename() doesn't do on windows.
+ */
+int FileUtils::replaceU8Path(const std::string& u8_path_old,
+                             const std::string& u8_path_new)
+{
+#if defined(WIN32)
+    return MoveFileExW(StringUtils::utf8ToWide(u8_path_old).c_str(),
+        StringUtils::utf8ToWide(u8_path_new).c_str(),
+        MOVEFILE_REPLACE_EXISTING) != 0 ? 0 : -1;
+#else
+    return rename(u8_path_old.c_str(), u8_path_new.c_str());
+#endif
+}   // replaceU8Path
+
+// ----------------------------------------------------------------------------
+/** Returns a path to write a file to before it is moved to u8_path with
+ *  replaceU8Path. The path is unique to this process and call, so that
+ *  processes writing the same file at the same time don't mix their data.
+ */
+std::string FileUtils::getTempPath(const std::string& u8_path)
+{
+    static std::atomic<unsigned> count(0);
+#if defined(WIN32)
+    const int pid = _getpid();
+#else
+    const int pid = (int)getpid();
+#endif
+    return u8_path + "." + StringUtils::toString(pid) + "-" +
+        StringUtils::toString(count++) + ".tmp";
+}   // getTempPath
+
+// ----------------------------------------------------------------------------
+/** Returns a FNV-1a hash of some data, used to identify the source of
+ *  cached data and to detect corrupted or truncated cache files before their
+ *  content is used. Data in several parts can be hashed by passing the
+ *  result for the previous parts as hash.
+ *  \param data The data to hash.
+ *  \param size Size of the data in bytes.
+ *  \param hash The hash of the data before, or CHECKSUM_START.
+ */
+uint64_t FileUtils::checksum(const void* data, size_t size, uint64_t hash)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}   // checksum
+
+// ----------------------------------------------------------------------------
+/** Writes a cache file. The file starts with a header of the magic number,
+ *  the version, the hash of the source of the cached data, the size and the
+ *  checksum of the data (32 bytes in total), followed by the data. It is
+ *  written under a temporary name unique to this process first, so that no
+ *  other process can read a partially written file.
+ *  \param u8_path Name of the cache file.
+ *  \param magic Identifies the type of cache file.
+ *  \param version Version of the cache file layout.
+ *  \param hash Hash of the source of the data, see readCacheFile.
+ *  \param data, size The data to cache.
+ *  \return True if the file was written.
+ */
+bool FileUtils::writeCacheFile(const std::string& u8_path, uint32_t magic,
+                               uint32_t version, uint64_t hash,
+                               const void* data, size_t size)
+{
+    const std::string tmp_path = getTempPath(u8_path);
+    FILE* fp = fopenU8Path(tmp_path, "wb");
+    if (!fp)
+    {
+        Log::warn("FileUtils", "Can't write cache file '%s'.",
+                  tmp_path.c_str());
+        return false;
+    }
+    const uint32_t header[2] = { magic, version };
+    const uint64_t data_size = size;
+    const uint64_t data_checksum = checksum(data, size);
+    bool success = fwrite(header, sizeof(header), 1, fp) == 1 &&
+        fwrite(&hash, sizeof(hash), 1, fp) == 1 &&
+        fwrite(&data_size, sizeof(data_size), 1, fp) == 1 &&
+        fwrite(&data_checksum, sizeof(data_checksum), 1, fp) == 1 &&
+        (size == 0 || fwrite(data, size, 1, fp) == 1);
+    success = fclose(fp) == 0 && success;
+    if (!success || replaceU8Path(tmp_path, u8_path) != 0)
+    {
+        Log::warn("FileUtils", "Can't write cache file '%s'.",
+                  u8_path.c_str());
+#if defined(WIN32)
+        _wremove(StringUtils::utf8ToWide(tmp_path).c_str());
+#else
+        remove(tmp_path.c_str());
+#endif
+        return false;
+    }
+    return true;
+}   // writeCacheFile
+
+// ----------------------------------------------------------------------------
+/** Reads the data of a cache file written by writeCacheFile. The data is
+ *  only returned if the header matches and the checksum of the data is
+ *  correct.
+ *  \param u8_path Name of the cache file.
+ *  \param magic Identifies the type of cache file.
+ *  \param version Version of the cache file layout.
+ *  \param hash Hash of the source of the data, the file is ignored if it
+ *         was written for a different hash.
+ *  \param max_size Larger data is considered corrupted.
+ *  \param data On return the cached data.
+ *  \return True if the data was read, false if the file doesn't exist or is
+ *          invalid (which is logged).
+ */
+bool FileUtils::readCacheFile(const std::string& u8_path, uint32_t magic,
+                              uint32_t version, uint64_t hash,
+                              uint64_t max_size, std::string* data)
+{
+    FILE* fp = fopenU8Path(u8_path, "rb");
+    if (!fp)
+        return false;
+    uint32_t header[2];
+    uint64_t file_hash = 0, size = 0, data_checksum = 0;
+    bool success = fread(header, sizeof(header), 1, fp) == 1 &&
+                   fread(&file_hash, sizeof(file_hash), 1, fp) == 1 &&
+                   fread(&size, sizeof(size), 1, fp) == 1 &&
+                   fread(&data_checksum, sizeof(data_checksum), 1, fp) == 1 &&
+                   header[0] == magic && header[1] == version &&
+                   file_hash == hash && size <= max_size;
+    if (success)
+    {
+        data->resize((size_t)size);
+        success = (size == 0 || fread(&(*data)[0], data->size(), 1, fp) == 1)
+            && checksum(data->data(), data->size()) == data_checksum;
+    }
+    fclose(fp);
+    if (!success)
+    {
+        Log::warn("FileUtils", "Ignoring invalid cache file '%s'.",
+                  u8_path.c_str());
+        data->clear();
+    }
+    return success;
+}   // readCacheFile
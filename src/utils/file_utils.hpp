@@ -18,6 +18,7 @@
 #ifndef HEADER_FILE_UTILS_HPP
 #define HEADER_FILE_UTILS_HPP
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string>
 #include <sys/stat.h>
@@ -39,6 +40,25 @@ namespace FileUtils
     int renameU8Path(const std::string& u8_path_old,
                      const std::string& u8_path_new);
     // ------------------------------------------------------------------------
+    int replaceU8Path(const std::string& u8_path_old,
+                      const std::string& u8_path_new);
+    // ------------------------------------------------------------------------
+    std::string getTempPath(const std::string& u8_path);
+    // ------------------------------------------------------------------------
+    /** Start value of checksum(). */
+    const uint64_t CHECKSUM_START = 14695981039346656037ULL;
+    // ------------------------------------------------------------------------
+    uint64_t checksum(const void* data, size_t size,
+                      uint64_t hash = CHECKSUM_START);
+    // ------------------------------------------------------------------------
+    bool writeCacheFile(const std::string& u8_path, uint32_t magic,
+                        uint32_t version, uint64_t hash, const void* data,
+                        size_t size);
+    // ------------------------------------------------------------------------
+    bool readCacheFile(const std::string& u8_path, uint32_t magic,
+                       uint32_t version, uint64_t hash, uint64_t max_size,
+                       std::string* data);
+    // ------------------------------------------------------------------------
     /* Return a path which can be opened for writing in all systems, as long as
      * u8_path is unicode encoded. */
     inline std::string getPortableWritingPath(const std::string& u8_path)
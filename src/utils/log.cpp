@@ -21,10 +21,17 @@
 #include "config/user_config.hpp"
 #include "network/network_config.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/vs.hpp"
 
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <ctime>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
 #include <stdio.h>
+#include <thread>
 
 #ifdef ANDROID
 #  include <android/log.h>
@@ -42,6 +49,235 @@ std::string   Log::m_prefix        = "";
 size_t        Log::m_buffer_size = 1;
 bool          Log::m_console_log = true;
 Synchronised<std::vector<struct Log::LineInfo> > Log::m_line_buffer;
+std::atomic<Log::AsyncWriter*> Log::m_async_writer(NULL);
+
+// ============================================================================
+/** Stores preformatted log lines in a lock-free ring buffer, which are
+ *  written by a separate thread. Each record has a sequence number which
+ *  tells if it can be filled by a thread logging a line or read by the
+ *  writer thread, so several threads can add lines without a lock. Adding
+ *  a line never waits: if the ring is full, the line is dropped, and the
+ *  number of dropped lines is logged later.
+ */
+class Log::AsyncWriter
+{
+private:
+    struct Record
+    {
+        /** Equal to the position the record can be filled at, or one more
+         *  than that if the record is filled and can be written. */
+        std::atomic<size_t> m_sequence;
+        /** Log level of the line. */
+        int m_level;
+        /** Time the line was logged at, or 0 if no time is printed. */
+        std::time_t m_time;
+        /** Offset in the line where the time is inserted. */
+        size_t m_time_offset;
+        /** The line. The string keeps its capacity when the record is
+         *  reused, so no memory is allocated once the ring was filled. */
+        std::string m_line;
+    };
+
+    /** The ring of records, the size is a power of two. */
+    std::unique_ptr<Record[]> m_records;
+
+    /** Number of records - 1, to compute the record of a position. */
+    size_t m_mask;
+
+    /** Position at which the next line is added. */
+    std::atomic<size_t> m_add_pos;
+
+    /** Position of the next line to write, only changed by the writer. */
+    std::atomic<size_t> m_write_pos;
+
+    /** Number of lines dropped because the ring was full. */
+    std::atomic<unsigned> m_num_dropped;
+
+    /** True if the writer thread is waiting for new lines. */
+    std::atomic<bool> m_sleeping;
+
+    std::atomic<bool> m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_lines_added;
+    std::thread m_thread;
+
+    /** The time string last used by the writer, and its time. */
+    std::time_t m_last_time;
+    char m_time_string[32];
+
+    /** Buffer to insert the time into a line. */
+    std::string m_output;
+
+    // ------------------------------------------------------------------------
+    /** Returns the time in the format of asctime (without the new line). The
+     *  string is only created again if the time changes. */
+    const char* getTimeString(std::time_t t)
+    {
+        if (t == m_last_time)
+            return m_time_string;
+        m_last_time = t;
+        static const char *days[] = { "Sun", "Mon", "Tue", "Wed", "Thu",
+                                      "Fri", "Sat" };
+        static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May",
+                                        "Jun", "Jul", "Aug", "Sep", "Oct",
+                                        "Nov", "Dec" };
+        struct tm tm;
+#ifdef WIN32
+        localtime_s(&tm, &t);
+#else
+        localtime_r(&t, &tm);
+#endif
+        snprintf(m_time_string, sizeof(m_time_string),
+                 "%.3s %.3s%3d %.2d:%.2d:%.2d %d", days[tm.tm_wday],
+                 months[tm.tm_mon], tm.tm_mday, tm.tm_hour, tm.tm_min,
+                 tm.tm_sec, 1900 + tm.tm_year);
+        return m_time_string;
+    }   // getTimeString
+
+    // ------------------------------------------------------------------------
+    /** Writes all lines added so far. Only called by the writer thread (or
+     *  after it was stopped).
+     *  \return True if at least one line was written. */
+    bool writeLines()
+    {
+        bool written = false;
+        size_t pos = m_write_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Record& r = m_records[pos & m_mask];
+            if (r.m_sequence.load(std::memory_order_acquire) != pos + 1)
+                break;
+            if (r.m_time != 0)
+            {
+                m_output.assign(r.m_line, 0, r.m_time_offset);
+                m_output += getTimeString(r.m_time);
+                m_output += ' ';
+                m_output.append(r.m_line, r.m_time_offset,
+                                std::string::npos);
+                writeLine(m_output.c_str(), r.m_level);
+            }
+            else
+                writeLine(r.m_line.c_str(), r.m_level);
+            // Make the record available for a later position
+            r.m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+            pos++;
+            m_write_pos.store(pos, std::memory_order_release);
+            written = true;
+        }
+        const unsigned num_dropped = m_num_dropped.exchange(0);
+        if (num_dropped > 0)
+        {
+            char line[128];
+            snprintf(line, sizeof(line), "[warn   ] Log: %u log messages "
+                     "were dropped, the log buffer was full.\n", num_dropped);
+            writeLine(line, LL_WARN);
+        }
+        return written;
+    }   // writeLines
+
+    // ------------------------------------------------------------------------
+    void mainLoop()
+    {
+        VS::setThreadName("Log");
+        while (!m_stop.load())
+        {
+            if (writeLines())
+                continue;
+            // Lines added between writeLines() and setting m_sleeping are
+            // only noticed after the timeout, which limits the delay.
+            std::unique_lock<std::mutex> ul(m_mutex);
+            m_sleeping.store(true);
+            m_lines_added.wait_for(ul, std::chrono::milliseconds(100));
+            m_sleeping.store(false);
+        }
+        writeLines();
+    }   // mainLoop
+
+public:
+    // ------------------------------------------------------------------------
+    AsyncWriter(unsigned num_lines)
+    {
+        size_t size = 2;
+        while (size < num_lines)
+            size *= 2;
+        m_records.reset(new Record[size]);
+        for (size_t i = 0; i < size; i++)
+            m_records[i].m_sequence.store(i);
+        m_mask = size - 1;
+        m_add_pos.store(0);
+        m_write_pos.store(0);
+        m_num_dropped.store(0);
+        m_sleeping.store(false);
+        m_stop.store(false);
+        m_last_time = 0;
+        m_time_string[0] = 0;
+        m_thread = std::thread(&AsyncWriter::mainLoop, this);
+    }   // AsyncWriter
+
+    // ------------------------------------------------------------------------
+    /** Adds a line to be written, or drops it if there is no free record.
+     *  \param line The line.
+     *  \param length Length of the line.
+     *  \param level Log level of the line.
+     *  \param t Time to insert into the line, 0 if no time is printed.
+     *  \param time_offset Offset in the line where the time is inserted. */
+    void addLine(const char *line, size_t length, int level, std::time_t t,
+                 size_t time_offset)
+    {
+        size_t pos = m_add_pos.load(std::memory_order_relaxed);
+        Record* r;
+        while (true)
+        {
+            r = &m_records[pos & m_mask];
+            const size_t seq = r->m_sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                // The record is free, try to reserve it
+                if (m_add_pos.compare_exchange_weak(pos, pos + 1,
+                                                    std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // The ring is full
+                m_num_dropped.fetch_add(1);
+                return;
+            }
+            else
+                pos = m_add_pos.load(std::memory_order_relaxed);
+        }
+        r->m_level = level;
+        r->m_time = t;
+        r->m_time_offset = time_offset < length ? time_offset : length;
+        r->m_line.assign(line, length);
+        r->m_sequence.store(pos + 1, std::memory_order_release);
+        if (m_sleeping.load())
+            m_lines_added.notify_one();
+    }   // addLine
+
+    // ------------------------------------------------------------------------
+    /** Waits till all lines added so far are written. */
+    void flush()
+    {
+        const size_t pos = m_add_pos.load();
+        m_lines_added.notify_one();
+        while (m_write_pos.load() < pos && !m_stop.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }   // flush
+
+    // ------------------------------------------------------------------------
+    /** Writes all remaining lines and stops the writer thread. */
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop.store(true);
+        }
+        m_lines_added.notify_one();
+        m_thread.join();
+    }   // stop
+};   // class Log::AsyncWriter
 
 // ----------------------------------------------------------------------------
 /** Selects background/foreground colors for the message depending on
@@ -128,7 +364,8 @@ void Log::resetTerminalColor()
 }   // resetTerminalColor
 
 // ----------------------------------------------------------------------------
-/** This actually creates a log message. If the messages are to be buffered,
+/** This actually creates a log message. If a writer thread was started, the
+ *  message is handed to it. If the messages are to be buffered,
  *  it will be appended to the output buffer. If the buffer is full, it will
  *  be flushed. If the message is not to be buffered, it will be immediately
  *  written using writeLine().
@@ -157,9 +394,15 @@ void Log::printMessage(int level, const char *component, const char *format,
         remaining = MAX_LENGTH - index > 0 ? MAX_LENGTH - index : 0;
     }
 
+    bool print_time = false;
 #ifndef ANDROID
-    if (NetworkConfig::get()->isNetworking() &&
-        NetworkConfig::get()->isServer())
+    print_time = NetworkConfig::get()->isNetworking() &&
+                 NetworkConfig::get()->isServer();
+#endif
+    AsyncWriter* async_writer = m_async_writer.load();
+    // The writer thread inserts the time, it only formats it once a second
+    const size_t time_offset = index;
+    if (print_time && !async_writer)
     {
         std::time_t result = std::time(nullptr);
         index += snprintf (line + index, remaining,
@@ -167,7 +410,6 @@ void Log::printMessage(int level, const char *component, const char *format,
             names[level], component);
     }
     else
-#endif
     {
         index += snprintf (line + index, remaining,
             "[%s] %s: ", names[level], component);
@@ -180,6 +422,17 @@ void Log::printMessage(int level, const char *component, const char *format,
     index = index > MAX_LENGTH - 1 ? MAX_LENGTH - 1 : index;
     sprintf(line + index, "\n");
 
+    if (async_writer)
+    {
+        async_writer->addLine(line, index + 1, level,
+                              print_time ? std::time(nullptr) : 0,
+                              time_offset);
+        // The program is aborted after a fatal message
+        if (level == LL_FATAL)
+            async_writer->flush();
+        return;
+    }
+
     // If the data is not buffered, immediately print it:
     if (m_buffer_size <= 1)
     {
@@ -274,9 +527,17 @@ void Log::toggleConsoleLog(bool val)
 
 // ----------------------------------------------------------------------------
 /** Flushes all stored log messages to the various output devices (thread safe).
+ *  If the lines are written by a separate thread, waits till all lines are
+ *  written.
  */
 void Log::flushBuffers()
 {
+    AsyncWriter* async_writer = m_async_writer.load();
+    if (async_writer)
+    {
+        async_writer->flush();
+        return;
+    }
     m_line_buffer.lock();
     for (unsigned int i = 0; i < m_line_buffer.getData().size(); i++)
     {
@@ -287,6 +548,36 @@ void Log::flushBuffers()
     m_line_buffer.unlock();
 }   // flushBuffers
 
+// ----------------------------------------------------------------------------
+/** Lets a separate thread write all log lines, so that threads logging a
+ *  message don't wait for the output or for each other. This must only be
+ *  called after the server rooms are forked, since a forked process has no
+ *  copy of the thread.
+ *  \param num_lines Maximum number of lines waiting to be written, further
+ *         lines are dropped.
+ */
+void Log::startAsyncWriter(unsigned num_lines)
+{
+    if (m_async_writer.load())
+        return;
+    flushBuffers();
+    m_async_writer.store(new AsyncWriter(num_lines));
+}   // startAsyncWriter
+
+// ----------------------------------------------------------------------------
+/** Writes all remaining lines and stops the writer thread. Later lines are
+ *  written immediately again.
+ */
+void Log::stopAsyncWriter()
+{
+    AsyncWriter* async_writer = m_async_writer.exchange(NULL);
+    if (!async_writer)
+        return;
+    async_writer->stop();
+    // The writer is not deleted, since another thread could still be
+    // adding a line to it.
+}   // stopAsyncWriter
+
 // ----------------------------------------------------------------------------
 /** This function opens the files that will contain the output.
  *  \param logout : name of the file that will contain stdout output
@@ -23,6 +23,7 @@
 #include "utils/synchronised.hpp"
 
 #include <assert.h>
+#include <atomic>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -78,6 +79,10 @@ private:
      ** the maximum number of lines the buffer should hold. */
     static size_t m_buffer_size;
 
+    /** Writes log lines in a separate thread, see startAsyncWriter(). */
+    class AsyncWriter;
+    static std::atomic<AsyncWriter*> m_async_writer;
+
     /** An optional prefix to be printed. */
     static std::string m_prefix;
 
@@ -121,6 +126,8 @@ public:
     static void closeOutputFiles();
     static void flushBuffers();
     static void toggleConsoleLog(bool val);
+    static void startAsyncWriter(unsigned num_lines = 4096);
+    static void stopAsyncWriter();
 
     // ------------------------------------------------------------------------
     /** Sets the number of lines to buffer. Setting the buffer size to a 
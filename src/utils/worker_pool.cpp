@@ -0,0 +1,140 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/worker_pool.hpp"
+
+#include "utils/vs.hpp"
+
+#include <assert.h>
+
+// ----------------------------------------------------------------------------
+/** Starts the worker threads.
+ *  \param num_threads Number of threads started in addition to the thread
+ *         which calls run(), if 0 all calls are done by that thread.
+ *  \param name Name of the worker threads, for debugging.
+ */
+WorkerPool::WorkerPool(unsigned num_threads, const std::string& name)
+{
+    m_name = name;
+    m_function = NULL;
+    m_count = 0;
+    m_next.store(0);
+    m_busy_threads = 0;
+    m_job_id = 0;
+    m_stop = false;
+    for (unsigned i = 0; i < num_threads; i++)
+        m_threads.emplace_back(&WorkerPool::mainLoop, this);
+}   // WorkerPool
+
+// ----------------------------------------------------------------------------
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_added.notify_all();
+    for (std::thread& t : m_threads)
+        t.join();
+}   // ~WorkerPool
+
+// ----------------------------------------------------------------------------
+void WorkerPool::mainLoop()
+{
+    VS::setThreadName(m_name.c_str());
+    uint64_t job_id = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> ul(m_mutex);
+            m_work_added.wait(ul, [this, job_id]()
+                { return m_stop || m_job_id != job_id; });
+            if (m_stop)
+                return;
+            job_id = m_job_id;
+        }
+        work();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy_threads == 0)
+            m_work_done.notify_one();
+    }
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Does calls of the current job till all of them have been started. */
+void WorkerPool::work()
+{
+    unsigned i = m_next.fetch_add(1);
+    while (i < m_count)
+    {
+        (*m_function)(i);
+        i = m_next.fetch_add(1);
+    }
+}   // work
+
+// ----------------------------------------------------------------------------
+/** Calls f with all indices from 0 to count-1, distributed over all threads,
+ *  and returns after all calls have finished. The calls must be independent
+ *  of each other.
+ */
+void WorkerPool::run(unsigned count, const std::function<void(unsigned)>& f)
+{
+    if (m_threads.empty() || count < 2)
+    {
+        for (unsigned i = 0; i < count; i++)
+            f(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = &f;
+        m_count = count;
+        m_next.store(0);
+        m_busy_threads = (unsigned)m_threads.size();
+        m_job_id++;
+    }
+    m_work_added.notify_all();
+    work();
+
+    std::unique_lock<std::mutex> ul(m_mutex);
+    m_work_done.wait(ul, [this]() { return m_busy_threads == 0; });
+    m_function = NULL;
+    m_count = 0;
+}   // run
+
+// ----------------------------------------------------------------------------
+void WorkerPool::unitTesting()
+{
+    WorkerPool pool(3, "UnitTestPool");
+    assert(pool.getNumThreads() == 4);
+    for (unsigned job = 0; job < 100; job++)
+    {
+        const unsigned count = job % 7 == 0 ? 1 : job * 3;
+        std::vector<unsigned> result(count, 0);
+        pool.run(count, [&result](unsigned i) { result[i] += i + 1; });
+        for (unsigned i = 0; i < count; i++)
+            assert(result[i] == i + 1);
+    }
+    WorkerPool single(0, "UnitTestPool");
+    std::vector<unsigned> result(10, 0);
+    single.run(10, [&result](unsigned i) { result[i] = i; });
+    for (unsigned i = 0; i < 10; i++)
+        assert(result[i] == i);
+}   // unitTesting
@@ -0,0 +1,93 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_WORKER_POOL_HPP
+#define HEADER_WORKER_POOL_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** A small set of threads which run many independent calls of one function
+ *  in parallel. The thread calling run() takes part in the work and returns
+ *  once all calls have finished, so the function can use data owned by the
+ *  caller without any further synchronisation.
+ */
+class WorkerPool : public NoCopy
+{
+private:
+    std::vector<std::thread> m_threads;
+
+    /** Name of the worker threads. */
+    std::string m_name;
+
+    /** Only one run() can use the workers at a time. */
+    std::mutex m_run_mutex;
+
+    /** Protects the job data below. */
+    std::mutex m_mutex;
+
+    std::condition_variable m_work_added;
+
+    std::condition_variable m_work_done;
+
+    /** The function of the current job. */
+    const std::function<void(unsigned)>* m_function;
+
+    /** Number of calls of the current job. */
+    unsigned m_count;
+
+    /** Index of the next call which is not started yet. */
+    std::atomic<unsigned> m_next;
+
+    /** Number of worker threads still working on the current job. */
+    unsigned m_busy_threads;
+
+    /** Increased for each job, so workers know a new job was added. */
+    uint64_t m_job_id;
+
+    bool m_stop;
+
+    // ------------------------------------------------------------------------
+    void mainLoop();
+    // ------------------------------------------------------------------------
+    void work();
+
+public:
+    // ------------------------------------------------------------------------
+    WorkerPool(unsigned num_threads, const std::string& name);
+    // ------------------------------------------------------------------------
+    ~WorkerPool();
+    // ------------------------------------------------------------------------
+    void run(unsigned count, const std::function<void(unsigned)>& f);
+    // ------------------------------------------------------------------------
+    /** Returns the number of threads working on a job, including the
+     *  thread calling run(). */
+    unsigned getNumThreads() const { return (unsigned)m_threads.size() + 1; }
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+
+};   // class WorkerPool
+
+#endif // HEADER_WORKER_POOL_HPP